@@ -0,0 +1,238 @@
+#include "ClockEngine.h"
+#include "MidiRouter.h"
+
+ClockEngine* ClockEngine::instance = nullptr;
+
+// Input period low-pass: each tick moves the estimate 1/N of the way
+static const float PERIOD_FILTER = 16.0f;
+
+// Share (1/N) of an input tick's phase error corrected on the next output tick
+static const float PHASE_GAIN = 8.0f;
+
+// Source counts as stopped after this many periods without a tick
+static const float TIMEOUT_TICKS = 4.0f;
+
+// MIDI clock runs at 24 ticks per quarter note
+static const float TICKS_PER_BEAT = 24.0f;
+
+static float cyclesPerMicro() {
+    return F_CPU_ACTUAL / 1000000.0f;
+}
+
+static uint32_t absCycles(float value) {
+    return (uint32_t)(value < 0 ? -value : value);
+}
+
+ClockEngine::ClockEngine(MidiRouter& router, MidiStats& stats)
+    : router(router), stats(stats), mode(ClockMode::THRU), bpm(CLOCK_INTERNAL_BPM),
+      source(-1), sourceCable(0), inputCount(0), locked(false), resync(false), lastIn(0),
+      period(0), phaseError(0), lead(0), lastOut(0), currentInterval(0), nextInterval(0),
+      deferred(0) {}
+
+void ClockEngine::setMode(ClockMode newMode) {
+    if (newMode == mode) return;
+
+    router.lock();
+    if (mode == ClockMode::INTERNAL) {
+        router.sendRealtime(0xFC);  // Stop
+    }
+    release();
+    mode = newMode;
+    if (mode == ClockMode::INTERNAL) {
+        router.sendRealtime(0xFA);  // Start
+        setBpm(bpm);
+        align(MidiStats::cycles());
+    }
+    router.unlock();
+}
+
+void ClockEngine::setBpm(float newBpm) {
+    if (newBpm < CLOCK_MIN_BPM) newBpm = CLOCK_MIN_BPM;
+    if (newBpm > CLOCK_MAX_BPM) newBpm = CLOCK_MAX_BPM;
+    bpm = newBpm;
+    if (mode == ClockMode::INTERNAL) {
+        period = F_CPU_ACTUAL * 60.0f / (bpm * TICKS_PER_BEAT);
+        nextInterval = period;
+        if (locked) timer.update(period / cyclesPerMicro());
+    }
+}
+
+float ClockEngine::getBpm() const {
+    if (mode == ClockMode::INTERNAL) return bpm;
+    if (!locked || period <= 0) return 0;
+    return F_CPU_ACTUAL * 60.0f / (period * TICKS_PER_BEAT);
+}
+
+bool ClockEngine::onClockIn(int srcSlot, uint8_t cable, uint32_t readCycles) {
+    if (mode == ClockMode::THRU) return false;
+    if (mode == ClockMode::INTERNAL) return true;
+
+    if (source < 0) {
+        source = (int8_t)srcSlot;
+        sourceCable = cable;
+        inputCount = 0;
+    }
+    if (srcSlot != source) return false;
+
+    uint32_t interval = readCycles - lastIn;
+    lastIn = readCycles;
+    if (inputCount < 2) inputCount++;
+
+    if (!locked) {
+        // The first tick has no period yet: pass it on as it came.
+        // The second gives one, and starts the timer in phase with it.
+        if (inputCount < 2) {
+            router.sendClock(source, sourceCable);
+            return true;
+        }
+        if ((float)interval > F_CPU_ACTUAL * 60.0f / (CLOCK_MIN_BPM * TICKS_PER_BEAT)) {
+            // Too slow to be a running clock: start over from this tick
+            inputCount = 1;
+            router.sendClock(source, sourceCable);
+            return true;
+        }
+        period = (float)interval;
+        align(readCycles);
+        return true;
+    }
+
+    // Period: skip dropped or doubled ticks, low-pass the rest
+    float deviation = (float)interval - period;
+    stats.recordClockIn(absCycles(deviation));
+    if (interval > period / 2 && interval < period * 2) {
+        period += deviation / PERIOD_FILTER;
+    }
+
+    if (resync) {
+        // First tick after start/continue goes out now so the count restarts
+        // together at both ends
+        resync = false;
+        align(readCycles);
+        return true;
+    }
+
+    // Phase: compare with the output tick this input matches, already sent
+    // (lead >= 0) or the next one due
+    lead--;
+    if (lead < -1 || lead > 1) {
+        align(readCycles);  // Lost track of the count
+        return true;
+    }
+    int32_t offset = (lead >= 0) ? -(int32_t)(lead * period) : (int32_t)currentInterval;
+    phaseError = (float)(int32_t)(readCycles - (lastOut + offset));
+    return true;
+}
+
+void ClockEngine::onTransport(int srcSlot, uint8_t status) {
+    if (mode == ClockMode::REGENERATE && srcSlot == source && (status == 0xFA || status == 0xFB)) {
+        resync = true;
+    }
+}
+
+void ClockEngine::service() {
+    uint32_t at[DEFERRED_TICKS];
+    noInterrupts();
+    int count = deferred;
+    for (int i = 0; i < count && i < DEFERRED_TICKS; i++) {
+        at[i] = deferredAt[i];
+    }
+    deferred = 0;
+    interrupts();
+
+    // Each in turn, so none is lost however long the router was held
+    for (int i = 0; i < count; i++) {
+        tick(at[i < DEFERRED_TICKS ? i : DEFERRED_TICKS - 1]);
+    }
+}
+
+void ClockEngine::resetSlot(int slot) {
+    if (slot == source) {
+        release();
+    }
+}
+
+void ClockEngine::timerISR() {
+    ClockEngine* engine = instance;
+    if (!engine) return;
+    uint32_t now = MidiStats::cycles();
+    if (engine->router.isLocked()) {
+        // Sent by the routing pass that holds the router
+        uint8_t count = engine->deferred;
+        engine->deferredAt[count < DEFERRED_TICKS ? count : DEFERRED_TICKS - 1] = now;
+        if (count < 255) engine->deferred = count + 1;
+        return;
+    }
+    engine->tick(now);
+}
+
+void ClockEngine::tick(uint32_t due) {
+    if (!locked) return;
+
+    if (mode == ClockMode::REGENERATE) {
+        // Source stopped sending clock
+        if ((float)(due - lastIn) > period * TIMEOUT_TICKS) {
+            release();
+            return;
+        }
+    }
+
+    // Keep the timer's schedule even when a tick is held back
+    float actual = (float)(due - lastOut);
+    stats.recordClockOut(absCycles(actual - currentInterval) + (MidiStats::cycles() - due));
+    lastOut = due;
+    currentInterval = nextInterval;
+
+    // Correct a share of the last phase error over the next interval
+    float correction = phaseError / PHASE_GAIN;
+    phaseError -= correction;
+    nextInterval = period + correction;
+    if (nextInterval < period / 2) nextInterval = period / 2;
+    if (nextInterval > period * 3 / 2) nextInterval = period * 3 / 2;
+    timer.update(nextInterval / cyclesPerMicro());
+
+    if (mode == ClockMode::INTERNAL) {
+        router.sendRealtime(0xF8);
+        return;
+    }
+
+    // Never run ahead of the source by more than the tick in flight, and
+    // hold off after start/continue until the source's first tick
+    if (lead >= 1 || resync) return;
+    lead++;
+    router.sendClock(source, sourceCable);
+}
+
+void ClockEngine::align(uint32_t now) {
+    locked = true;
+    lead = 0;
+    phaseError = 0;
+    lastOut = now;
+    currentInterval = period;
+    nextInterval = period;
+    if (mode == ClockMode::REGENERATE) {
+        router.sendClock(source, sourceCable);
+    } else {
+        router.sendRealtime(0xF8);
+    }
+    startTimer(period);
+}
+
+void ClockEngine::startTimer(float intervalCycles) {
+    instance = this;
+    timer.end();
+    deferred = 0;
+
+    // Same priority as routing dispatch, so neither interrupts the other
+    timer.priority(DISPATCH_PRIORITY);
+    timer.begin(timerISR, intervalCycles / cyclesPerMicro());
+}
+
+void ClockEngine::release() {
+    timer.end();
+    deferred = 0;
+    locked = false;
+    resync = false;
+    source = -1;
+    inputCount = 0;
+    period = 0;
+}
@@ -0,0 +1,100 @@
+#ifndef CLOCK_ENGINE_H
+#define CLOCK_ENGINE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "MidiStats.h"
+
+class MidiRouter;
+
+// How MIDI clock (0xF8) is distributed
+enum class ClockMode : uint8_t {
+    THRU,        // Routed like any other message, with the source's timing
+    REGENERATE,  // Followed and re-sent from a timer, arrival jitter filtered out
+    INTERNAL     // The hub is the clock master at a set tempo
+};
+
+// Tracks incoming MIDI clock with a software PLL and regenerates it from a
+// hardware timer, or generates it at a set tempo.
+//
+// In REGENERATE mode the first source to send clock is followed. Each of
+// its ticks updates a low-passed period estimate and the phase error
+// against the output tick it matches; the timer runs at the estimated
+// period nudged by a share of that error, so the output keeps the
+// source's tempo and tick count but not its arrival jitter (which
+// includes up to one routing pass of polling delay). Output goes wherever
+// the source's routes send clock. Clock from other sources is routed as
+// usual.
+//
+// In INTERNAL mode clock goes to every connected device, with Start when
+// the mode is entered and Stop when it's left. Incoming clock is dropped.
+class ClockEngine {
+public:
+    ClockEngine(MidiRouter& router, MidiStats& stats);
+
+    // Change mode (from loop(), not while routing)
+    void setMode(ClockMode newMode);
+    ClockMode getMode() const { return mode; }
+
+    // Internal master tempo (takes effect immediately)
+    void setBpm(float newBpm);
+
+    // Tempo being sent: the internal tempo, or the followed source's
+    // measured tempo (0 until locked)
+    float getBpm() const;
+
+    // Slot whose clock is being followed, -1 if none
+    int getSource() const { return source; }
+
+    // Router hooks, called during a routing pass:
+    // A clock tick was read; returns true if the engine takes it over
+    bool onClockIn(int srcSlot, uint8_t cable, uint32_t readCycles);
+
+    // Start, continue or stop was read
+    void onTransport(int srcSlot, uint8_t status);
+
+    // Send the ticks that fell due while the router was busy
+    void service();
+
+    // Device in a slot connected or disconnected
+    void resetSlot(int slot);
+
+private:
+    MidiRouter& router;
+    MidiStats& stats;
+    ClockMode mode;
+    float bpm;
+
+    // Followed source
+    int8_t source;
+    uint8_t sourceCable;
+    uint8_t inputCount;  // Ticks seen since picking the source (saturates at 2)
+    bool locked;         // Period known, timer running
+    bool resync;         // Start/continue seen: re-phase on the next tick
+    uint32_t lastIn;     // Read time of the last input tick
+
+    // PLL state, in CPU cycles
+    float period;           // Filtered input tick period
+    float phaseError;       // Input minus matching output tick time
+    int32_t lead;           // Output ticks sent minus input ticks received
+    uint32_t lastOut;       // When the last output tick was due
+    float currentInterval;  // Timer interval running now
+    float nextInterval;     // Loaded for the one after
+
+    // Output timer
+    IntervalTimer timer;
+    // Ticks due while the router was locked, and when. Past
+    // DEFERRED_TICKS the last entry holds the latest time.
+    static const int DEFERRED_TICKS = 8;
+    volatile uint8_t deferred;
+    volatile uint32_t deferredAt[DEFERRED_TICKS];
+    static ClockEngine* instance;
+    static void timerISR();
+
+    void tick(uint32_t due);
+    void align(uint32_t now);
+    void startTimer(float intervalCycles);
+    void release();
+};
+
+#endif
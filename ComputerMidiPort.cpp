@@ -0,0 +1,81 @@
+#include "ComputerMidiPort.h"
+#include "Config.h"
+
+#ifdef COMPUTER_MIDI_PORT
+
+#ifndef MIDI_INTERFACE
+#error "COMPUTER_MIDI_PORT needs Tools > USB Type set to Serial + MIDI (or MIDIx4/MIDIx16)"
+#endif
+
+ComputerMidiPort* ComputerMidiPort::reading = nullptr;
+
+ComputerMidiPort::ComputerMidiPort()
+    : chunkHandler(nullptr), chunkContext(nullptr), txHead(0), txTail(0), stagedSinceFlush(0) {}
+
+bool ComputerMidiPort::isConnected() const {
+    return usb_configuration != 0;
+}
+
+bool ComputerMidiPort::queuePacket(uint32_t packet) {
+    if (!canQueue()) return false;
+    uint16_t head = txHead;
+    txRing[head & (COMPUTER_TX_PACKETS - 1)] = packet;
+    __sync_synchronize();  // Packet stored before service() can see it
+    txHead = head + 1;
+    stagedSinceFlush++;
+    return true;
+}
+
+int ComputerMidiPort::flush() {
+    int count = stagedSinceFlush;
+    stagedSinceFlush = 0;
+    return count;
+}
+
+void ComputerMidiPort::service() {
+    uint16_t head = txHead;
+    uint16_t tail = txTail;
+    if (tail == head) return;
+    __sync_synchronize();  // Read packets only after seeing txHead
+
+    while (tail != head) {
+        usb_midi_write_packed(txRing[tail & (COMPUTER_TX_PACKETS - 1)]);
+        txTail = ++tail;
+    }
+    usb_midi_flush_output();
+}
+
+void ComputerMidiPort::setSysExChunkHandler(SysExChunkHandler handler, void* context) {
+    chunkHandler = handler;
+    chunkContext = context;
+    usbMIDI.setHandleSystemExclusive(onSysExPartial);
+}
+
+bool ComputerMidiPort::read() {
+    reading = this;
+    bool result = usbMIDI.read();
+    reading = nullptr;
+    return result;
+}
+
+uint8_t ComputerMidiPort::getType() const { return usbMIDI.getType(); }
+uint8_t ComputerMidiPort::getData1() const { return usbMIDI.getData1(); }
+uint8_t ComputerMidiPort::getData2() const { return usbMIDI.getData2(); }
+uint8_t ComputerMidiPort::getChannel() const { return usbMIDI.getChannel(); }
+uint8_t ComputerMidiPort::getCable() const { return usbMIDI.getCable(); }
+
+uint8_t ComputerMidiPort::getInputCables() const {
+#ifdef MIDI_NUM_CABLES
+    return MIDI_NUM_CABLES;
+#else
+    return 1;
+#endif
+}
+
+void ComputerMidiPort::onSysExPartial(const uint8_t* data, uint16_t length, bool complete) {
+    if (reading && reading->chunkHandler) {
+        reading->chunkHandler(reading->chunkContext, data, length, complete);
+    }
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef COMPUTER_MIDI_PORT_H
+#define COMPUTER_MIDI_PORT_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "HubMidiDevice.h"
+
+// Identity routes bind the computer port with. USB reserves vendor ID 0,
+// so no host-side device can match it.
+const uint16_t COMPUTER_PORT_VID = 0x0000;
+const uint16_t COMPUTER_PORT_PID = 0x0000;
+
+// The Teensy's own USB device port as a MIDI endpoint, with the same
+// packet-level interface as HubMidiDevice so the router treats the
+// computer like any other device slot. Needs Tools > USB Type set to a
+// "Serial + MIDI" type; "Serial + MIDIx16" gives 16 cables each way.
+//
+// The core's write waits (calling yield()) while its transmit buffers are
+// busy, so it must not run from the routing interrupt. Routing stages
+// packets in a ring here instead, and service(), called from loop(), hands
+// them to the core and sends the partly filled bulk packet. A full ring
+// leaves packets in the router's output queue under its drop policy, like
+// a host device with both transfers on the wire. If the computer stops
+// reading, the core waits out its transmit timeout once and discards
+// until it reads again.
+class ComputerMidiPort {
+public:
+    ComputerMidiPort();
+
+    // Whether the computer has configured the port
+    bool isConnected() const;
+
+    // Stage a pre-packed USB-MIDI event packet for service(). Returns
+    // false, staging nothing, if the ring is full.
+    bool queuePacket(uint32_t packet);
+
+    // Whether queuePacket() has room
+    bool canQueue() const { return (uint16_t)(txHead - txTail) < COMPUTER_TX_PACKETS; }
+
+    // Staged packets are already out of the router's hands
+    int stagedPackets() const { return 0; }
+
+    // End of a routing pass: returns the number of packets staged since
+    // the last flush (they go out from service())
+    int flush();
+
+    // Hand staged packets to the core and send them (call from loop(),
+    // never from an interrupt)
+    void service();
+
+    // Stream SysEx to a handler instead of buffering whole messages.
+    // The handler runs inside read().
+    void setSysExChunkHandler(SysExChunkHandler handler, void* context);
+
+    // Read one message from the computer
+    bool read();
+
+    uint8_t getType() const;
+    uint8_t getData1() const;
+    uint8_t getData2() const;
+    uint8_t getChannel() const;
+    uint8_t getCable() const;
+
+    // Virtual cables the USB type declares, the same both ways
+    uint8_t getInputCables() const;
+    uint8_t getOutputCables() const { return getInputCables(); }
+
+private:
+    SysExChunkHandler chunkHandler;
+    void* chunkContext;
+
+    // Single-producer (routing) single-consumer (service()) ring
+    static_assert((COMPUTER_TX_PACKETS & (COMPUTER_TX_PACKETS - 1)) == 0 && COMPUTER_TX_PACKETS <= 32768,
+                  "COMPUTER_TX_PACKETS must be a power of two up to 32768");
+    uint32_t txRing[COMPUTER_TX_PACKETS];
+    volatile uint16_t txHead;  // Next slot queuePacket() writes
+    volatile uint16_t txTail;  // Next slot service() sends
+    int stagedSinceFlush;
+
+    // usbMIDI is a single instance with a context-free SysEx callback
+    static ComputerMidiPort* reading;
+    static void onSysExPartial(const uint8_t* data, uint16_t length, bool complete);
+};
+
+#endif
@@ -5,24 +5,121 @@
 #define INPUT_QWIIC_TWIST
 // #define INPUT_SERIAL
 
+// Qwiic Twist INT line (active low, needs its own wire; the Qwiic cable
+// doesn't carry it). -1 polls the Twist over I2C every UI tick; set the
+// pin (e.g. 2) once the INT wire is connected.
+const int TWIST_INT_PIN = -1;
+
+// Twist turn interrupt fires once the knob pauses this long (ms)
+const int TWIST_INT_TIMEOUT_MS = 10;
+
+// Encoder acceleration: every TWIST_ACCEL_RATE detents per second adds a
+// step per detent, up to TWIST_ACCEL_MAX steps per detent
+const int TWIST_ACCEL_RATE = 20;
+const int TWIST_ACCEL_MAX = 4;
+
+// Twist LED (uncomment one). SELECTION is red while the highlighted
+// route has a device missing; SUMMARY is red while any route does.
+#define LED_ROUTE_SELECTION
+// #define LED_ROUTE_SUMMARY
+
 // UI driver selection (uncomment one)
 #define UI_OLED
 // #define UI_SERIAL
 
-// Maximum MIDI devices supported
-#define MAX_MIDI_DEVICES 8
+// Maximum MIDI devices supported (up to 32, one SlotMask bit each)
+#define MAX_MIDI_DEVICES 16
+
+// Route the computer like a device: the Teensy's own USB port becomes a
+// MIDI endpoint in the last device slot (so one fewer host device fits).
+// Needs Tools > USB Type "Serial + MIDIx16" (or "Serial + MIDI"); off by
+// default so a plain "Serial" build keeps every slot for host devices.
+// #define COMPUTER_MIDI_PORT
+
+// USB hub drivers (one per physical hub in the chain, up to 7 ports each)
+const int USB_HUB_COUNT = 4;
+
+// Maximum MIDI messages routed per loop() pass, shared round-robin across
+// source slots. 1 restores the old one-message-per-pass behaviour.
+const int MIDI_DRAIN_BUDGET = 64;
+
+// Route from a timer interrupt every N microseconds, independent of
+// loop() cadence (UI and I2C work). 0 routes from loop() instead.
+const unsigned long MIDI_DISPATCH_US = 250;
+
+// Output queue per destination, in USB-MIDI packets (4 bytes each) shared
+// by every source routed there, plus a separate queue for realtime
+const int OUTPUT_QUEUE_PACKETS = 128;
+const int OUTPUT_REALTIME_PACKETS = 16;
+
+// Packets staged for the computer port (COMPUTER_MIDI_PORT) between
+// loop() passes, which hand them to the USB core; a power of two
+const int COMPUTER_TX_PACKETS = 256;
 
-// Maximum number of routes that can be stored
-const int MAX_ROUTES = 16;
+// Packets written to each destination per routing pass; the rest stays
+// queued for the next pass (so does anything that finds both of the
+// device's transmit batches still on the wire).
+const int OUTPUT_PACKETS_PER_PASS = 32;
+
+// USB transmit batching: a destination's staged packets go out as one
+// transfer when this many are staged (16 = one full 64-byte USB packet),
+// and whatever is staged at the end of each routing pass. Lower sends
+// sooner under heavy traffic at the cost of more, smaller transfers.
+const int USB_TX_FLUSH_PACKETS = 16;
+
+// What a full output queue does (uncomment one). HOLD_SOURCE leaves
+// sources unread, so their own receive buffers take up the burst. SysEx
+// is never cut into under any policy: a message that no longer fits is
+// dropped for that destination from there on, and DROP_OLDEST only
+// discards single-packet messages.
+#define OUTPUT_DROP_OLDEST
+// #define OUTPUT_DROP_NEWEST
+// #define OUTPUT_HOLD_SOURCE
+
+// MIDI clock (uncomment one). THRU routes clock like any other message;
+// REGENERATE follows the first source sending clock and re-sends it from
+// a timer with the arrival jitter filtered out; INTERNAL makes the hub the
+// master at CLOCK_INTERNAL_BPM. THRU is the default; REGENERATE follows
+// tempo changes through a filter, so it is opt-in.
+#define CLOCK_THRU
+// #define CLOCK_REGENERATE
+// #define CLOCK_INTERNAL
+
+const float CLOCK_INTERNAL_BPM = 120.0f;
+const float CLOCK_MIN_BPM = 20.0f;
+const float CLOCK_MAX_BPM = 300.0f;
+
+// Controllers tracked at once for route thinning (RouteThin); beyond
+// this, values pass through unthinned
+const int THIN_ENTRIES = 64;
+
+// Velocity lookup tables for route transforms (RouteTransform), shared by
+// routes with the same curve; beyond this, curves are computed per note
+const int VELOCITY_TABLES = 8;
+
+// Maximum number of routes held in RAM. How many of them persist is
+// bounded by EEPROM size (see RouteManager::getSavedCapacity()); the rest
+// are marked unsaved in the route list.
+const int MAX_ROUTES = 256;
 
 // EEPROM storage
 const int EEPROM_MAGIC = 0x4D52;  // "MR" for MIDI Routes
-const int EEPROM_VERSION = 2;  // v2: added device names to routes
+const int EEPROM_VERSION = 3;  // v2: flat layout with device names, v3: journaled store
 const int EEPROM_START_ADDR = 0;
 
 // UI refresh rate
 const unsigned long UI_REFRESH_MS = 100;
 
+// Stats screen refresh interval
+const unsigned long STATS_REFRESH_MS = 1000;
+
+// Periodic stats report on Serial (ms) - 0 to disable. Not printed with
+// UI_SERIAL, whose screen it would break.
+const unsigned long STATS_REPORT_MS = 0;
+
+// Print the routing fan-out benchmark on Serial at startup
+// #define BENCH_FANOUT
+
 // Sleep/screensaver timeout (ms) - 0 to disable
 const unsigned long SLEEP_TIMEOUT_MS = 30000;  // 30 seconds
 
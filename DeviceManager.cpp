@@ -1,36 +1,63 @@
 #include "DeviceManager.h"
 #include <Arduino.h>
+#include <string.h>
 
-DeviceManager::DeviceManager() : deviceCount(0), connectionCallback(nullptr) {
+DeviceManager::DeviceManager()
+    : deviceCount(0), computer(nullptr), hubs(nullptr), hubCount(0), connectionCallback(nullptr) {
     for (int i = 0; i < MAX_MIDI_DEVICES; i++) {
         devices[i].connected = false;
         devices[i].vid = 0;
         devices[i].pid = 0;
         devices[i].name[0] = '\0';
+        devices[i].idLabel[0] = '\0';
+        devices[i].serialTag = 0;
+        devices[i].portTag = 0;
         devices[i].device = nullptr;
     }
+    memset(identities, 0, sizeof(identities));
 }
 
-void DeviceManager::init(MIDIDevice_BigBuffer* devicePtrs[], int count) {
+void DeviceManager::init(HubMidiDevice* devicePtrs[], int count) {
     deviceCount = min(count, MAX_MIDI_DEVICES);
     for (int i = 0; i < deviceCount; i++) {
         devices[i].device = devicePtrs[i];
     }
 }
 
-void DeviceManager::update() {
-    // Check all hardware slots for connect/disconnect
+void DeviceManager::setComputerPort(ComputerMidiPort* port) {
+    if (COMPUTER_SLOT < 0) return;
+    computer = port;
+    deviceCount = MAX_MIDI_DEVICES;
+}
+
+void DeviceManager::setHubs(TopologyHub* hubPtrs[], int count) {
+    hubs = hubPtrs;
+    hubCount = count;
+}
+
+bool DeviceManager::update() {
+    bool changed = false;
+
+    // Check all slots (host devices and the computer port) for connect/disconnect
     for (int i = 0; i < deviceCount; i++) {
-        MIDIDevice_BigBuffer* dev = devices[i].device;
+        HubMidiDevice* dev = devices[i].device;
         bool wasConnected = devices[i].connected;
-        bool isNowConnected = (*dev);
+#ifdef COMPUTER_MIDI_PORT
+        bool isComputer = (i == COMPUTER_SLOT && computer);
+        bool isNowConnected = isComputer ? computer->isConnected() : (dev && *dev);
+#else
+        bool isComputer = false;
+        bool isNowConnected = dev && *dev;
+#endif
 
         if (isNowConnected && !wasConnected) {
             // Device connected
             devices[i].connected = true;
-            devices[i].vid = dev->idVendor();
-            devices[i].pid = dev->idProduct();
+            devices[i].vid = isComputer ? COMPUTER_PORT_VID : dev->idVendor();
+            devices[i].pid = isComputer ? COMPUTER_PORT_PID : dev->idProduct();
             updateDeviceName(i);
+            updateDeviceIdentity(i);
+            changed = true;
 
             if (connectionCallback) {
                 connectionCallback(i, true);
@@ -46,8 +73,17 @@ void DeviceManager::update() {
             devices[i].vid = 0;
             devices[i].pid = 0;
             devices[i].name[0] = '\0';
+            devices[i].idLabel[0] = '\0';
+            devices[i].serialTag = 0;
+            devices[i].portTag = 0;
+            changed = true;
         }
     }
+
+    if (changed) {
+        rebuildIdentities();
+    }
+    return changed;
 }
 
 int DeviceManager::getConnectedCount() const {
@@ -64,15 +100,39 @@ const MidiDeviceInfo* DeviceManager::getDeviceBySlot(int slot) const {
 }
 
 int DeviceManager::findDeviceByVidPid(uint16_t vid, uint16_t pid) const {
-    for (int i = 0; i < deviceCount; i++) {
-        if (devices[i].connected && devices[i].vid == vid && devices[i].pid == pid) {
-            return i;
+    SlotMask slots = findSlots(vid, pid, DEVICE_TAG_ANY);
+    return slots ? __builtin_ctz(slots) : -1;
+}
+
+SlotMask DeviceManager::findSlots(uint16_t vid, uint16_t pid, uint32_t tag) const {
+    for (int i = identityHash(vid, pid, tag); identities[i].slots; i = (i + 1) % IDENTITY_TABLE_SIZE) {
+        const IdentityEntry& e = identities[i];
+        if (e.vid == vid && e.pid == pid && e.tag == tag) {
+            return e.slots;
         }
     }
-    return -1;
+    return 0;
+}
+
+uint32_t DeviceManager::getBindingTag(int slot) const {
+    if (!isConnected(slot) || !hasDuplicate(slot)) return DEVICE_TAG_ANY;
+    return hasUniqueSerial(slot) ? devices[slot].serialTag : devices[slot].portTag;
+}
+
+// Units sharing a serial number (or a placeholder such as "0000") can
+// only be told apart by port
+bool DeviceManager::hasUniqueSerial(int slot) const {
+    const MidiDeviceInfo& info = devices[slot];
+    return info.serialTag && findSlots(info.vid, info.pid, info.serialTag) == (SlotMask)(1u << slot);
 }
 
-MIDIDevice_BigBuffer* DeviceManager::getMidiDevice(int slot) const {
+bool DeviceManager::hasDuplicate(int slot) const {
+    if (!isConnected(slot)) return false;
+    SlotMask same = findSlots(devices[slot].vid, devices[slot].pid, DEVICE_TAG_ANY);
+    return (same & (same - 1)) != 0;
+}
+
+HubMidiDevice* DeviceManager::getMidiDevice(int slot) const {
     if (slot < 0 || slot >= deviceCount) return nullptr;
     return devices[slot].device;
 }
@@ -82,12 +142,46 @@ bool DeviceManager::isConnected(int slot) const {
     return devices[slot].connected;
 }
 
+uint8_t DeviceManager::getInputCables(int slot) const {
+    if (!isConnected(slot)) return 1;
+#ifdef COMPUTER_MIDI_PORT
+    if (slot == COMPUTER_SLOT) return computer->getInputCables();
+#endif
+    return devices[slot].device->getInputCables();
+}
+
+uint8_t DeviceManager::getOutputCables(int slot) const {
+    if (!isConnected(slot)) return 1;
+#ifdef COMPUTER_MIDI_PORT
+    if (slot == COMPUTER_SLOT) return computer->getOutputCables();
+#endif
+    return devices[slot].device->getOutputCables();
+}
+
+SlotMask DeviceManager::getOutputSlots() const {
+    SlotMask slots = 0;
+    for (int i = 0; i < deviceCount; i++) {
+        if (!devices[i].connected) continue;
+        if (!devices[i].device || devices[i].device->hasOutput()) {
+            slots |= (SlotMask)(1u << i);
+        }
+    }
+    return slots;
+}
+
 void DeviceManager::setConnectionCallback(void (*callback)(int slot, bool connected)) {
     connectionCallback = callback;
 }
 
 void DeviceManager::updateDeviceName(int slot) {
-    MIDIDevice_BigBuffer* dev = devices[slot].device;
+#ifdef COMPUTER_MIDI_PORT
+    if (slot == COMPUTER_SLOT) {
+        strcpy(devices[slot].name, "computer");
+        return;
+    }
+#endif
+
+    HubMidiDevice* dev = devices[slot].device;
     const uint8_t* prod = dev->product();
 
     if (prod && prod[0]) {
@@ -106,3 +200,102 @@ void DeviceManager::updateDeviceName(int slot) {
         }
     }
 }
+
+void DeviceManager::updateDeviceIdentity(int slot) {
+    MidiDeviceInfo& info = devices[slot];
+#ifdef COMPUTER_MIDI_PORT
+    if (slot == COMPUTER_SLOT) {
+        // Its VID:PID is unique, so routes bind it with DEVICE_TAG_ANY
+        info.serialTag = 0;
+        info.portTag = DEVICE_TAG_PORT;
+        return;
+    }
+#endif
+
+    HubMidiDevice* dev = info.device;
+
+    // Serial number: FNV-1a hash
+    const uint8_t* serial = dev->serialNumber();
+    info.serialTag = 0;
+    if (serial && serial[0]) {
+        uint32_t hash = 2166136261u;
+        for (const uint8_t* p = serial; *p; p++) {
+            hash = (hash ^ *p) * 16777619u;
+        }
+        info.serialTag = DEVICE_TAG_SERIAL | (hash & ~DEVICE_TAG_SERIAL);
+    }
+
+    info.portTag = DEVICE_TAG_PORT | usbPortPath(dev->hubAddress(), dev->hubPort(), hubs, hubCount);
+}
+
+// Label for the tag getBindingTag() uses, so it depends on the other
+// connected devices (after rebuildIdentities())
+void DeviceManager::updateIdLabel(int slot) {
+    MidiDeviceInfo& info = devices[slot];
+#ifdef COMPUTER_MIDI_PORT
+    if (slot == COMPUTER_SLOT) {
+        strcpy(info.idLabel, "usb");
+        return;
+    }
+#endif
+
+    // The last 4 characters of the serial number
+    if (hasUniqueSerial(slot)) {
+        const char* serial = (const char*)info.device->serialNumber();
+        int length = strlen(serial);
+        strncpy(info.idLabel, serial + (length > 4 ? length - 4 : 0), sizeof(info.idLabel) - 1);
+        info.idLabel[sizeof(info.idLabel) - 1] = '\0';
+        return;
+    }
+
+    // Port path, as dotted ports from the root ("2.3")
+    uint32_t path = info.portTag & ~DEVICE_TAG_PORT;
+    char* out = info.idLabel;
+    char* end = info.idLabel + sizeof(info.idLabel) - 1;
+    for (int shift = 24; shift >= 0; shift -= 4) {
+        uint8_t port = (path >> shift) & 0x0F;
+        if (!port && out == info.idLabel) continue;
+        if (out != info.idLabel && out < end) *out++ = '.';
+        if (out < end) *out++ = (char)('0' + (port % 10));
+    }
+    if (out == info.idLabel) *out++ = '0';
+    *out = '\0';
+}
+
+void DeviceManager::rebuildIdentities() {
+    memset(identities, 0, sizeof(identities));
+    for (int i = 0; i < deviceCount; i++) {
+        const MidiDeviceInfo& info = devices[i];
+        if (!info.connected) continue;
+        addIdentity(info.vid, info.pid, DEVICE_TAG_ANY, i);
+        addIdentity(info.vid, info.pid, info.portTag, i);
+        if (info.serialTag) {
+            addIdentity(info.vid, info.pid, info.serialTag, i);
+        }
+    }
+
+    // Labels follow the binding tags, which depend on the other devices
+    for (int i = 0; i < deviceCount; i++) {
+        if (devices[i].connected) {
+            updateIdLabel(i);
+        }
+    }
+}
+
+void DeviceManager::addIdentity(uint16_t vid, uint16_t pid, uint32_t tag, int slot) {
+    int i = identityHash(vid, pid, tag);
+    while (identities[i].slots &&
+           !(identities[i].vid == vid && identities[i].pid == pid && identities[i].tag == tag)) {
+        i = (i + 1) % IDENTITY_TABLE_SIZE;
+    }
+    identities[i].vid = vid;
+    identities[i].pid = pid;
+    identities[i].tag = tag;
+    identities[i].slots |= (SlotMask)(1u << slot);
+}
+
+int DeviceManager::identityHash(uint16_t vid, uint16_t pid, uint32_t tag) {
+    uint32_t h = ((uint32_t)vid << 16 | pid) * 2654435761u;
+    h ^= tag * 2246822519u;
+    return (int)((h ^ (h >> 15)) % IDENTITY_TABLE_SIZE);
+}
@@ -1,16 +1,40 @@
 #ifndef DEVICE_MANAGER_H
 #define DEVICE_MANAGER_H
 
-#include <USBHost_t36.h>
+#include "HubMidiDevice.h"
+#include "ComputerMidiPort.h"
+#include "UsbTopology.h"
 #include "Config.h"
 
+// Bitmask of device slots (bit N = slot N)
+typedef uint32_t SlotMask;
+static_assert(MAX_MIDI_DEVICES <= 8 * sizeof(SlotMask), "SlotMask too narrow for MAX_MIDI_DEVICES");
+
+// The computer port, when enabled, takes the last slot; host devices get
+// the rest
+#ifdef COMPUTER_MIDI_PORT
+const int COMPUTER_SLOT = MAX_MIDI_DEVICES - 1;
+const int HOST_DEVICE_SLOTS = MAX_MIDI_DEVICES - 1;
+#else
+const int COMPUTER_SLOT = -1;
+const int HOST_DEVICE_SLOTS = MAX_MIDI_DEVICES;
+#endif
+
+// Device tags tell apart devices that share a VID:PID
+const uint32_t DEVICE_TAG_ANY = 0;              // Every device with the VID:PID
+const uint32_t DEVICE_TAG_SERIAL = 0x80000000;  // | hash of the USB serial string
+const uint32_t DEVICE_TAG_PORT = 0x40000000;    // | hub port path
+
 // Information about a connected MIDI device
 struct MidiDeviceInfo {
     bool connected;
     uint16_t vid;
     uint16_t pid;
     char name[32];
-    MIDIDevice_BigBuffer* device;
+    char idLabel[8];         // Serial tail, or port path if no serial or a shared one
+    uint32_t serialTag;      // DEVICE_TAG_SERIAL | hash, or 0 without a serial number
+    uint32_t portTag;        // DEVICE_TAG_PORT | port path
+    HubMidiDevice* device;   // nullptr for the computer port
 };
 
 // Manages USB MIDI device connections and provides device info
@@ -19,10 +43,17 @@ public:
     DeviceManager();
 
     // Initialize with USB host MIDI device pointers
-    void init(MIDIDevice_BigBuffer* devices[], int count);
+    void init(HubMidiDevice* devices[], int count);
+
+    // Put the computer port in COMPUTER_SLOT (after init)
+    void setComputerPort(ComputerMidiPort* port);
+
+    // Hub drivers used to work out each device's port path
+    void setHubs(TopologyHub* hubs[], int count);
 
     // Call in main loop to check for connect/disconnect
-    void update();
+    // Returns true if any device connected or disconnected
+    bool update();
 
     // Get number of currently connected devices
     int getConnectedCount() const;
@@ -33,21 +64,70 @@ public:
     // Find device slot by VID:PID, returns -1 if not found
     int findDeviceByVidPid(uint16_t vid, uint16_t pid) const;
 
-    // Get the underlying MIDIDevice for a slot (for sending MIDI)
-    MIDIDevice_BigBuffer* getMidiDevice(int slot) const;
+    // Connected slots matching a device identity: the device with this
+    // tag (serial or port), or every device with the VID:PID for
+    // DEVICE_TAG_ANY. O(1) lookup in the identity cache.
+    SlotMask findSlots(uint16_t vid, uint16_t pid, uint32_t tag) const;
+
+    // Tag a new route should bind a slot's device with: DEVICE_TAG_ANY for
+    // a lone device (any unit with the VID:PID, on any port); when another
+    // connected device shares the VID:PID, its serial number if no other
+    // unit has the same one, else its port
+    uint32_t getBindingTag(int slot) const;
+
+    // Whether another connected device has the same VID:PID
+    bool hasDuplicate(int slot) const;
+
+    // Get the underlying MIDIDevice for a slot (for sending MIDI);
+    // nullptr for the computer port
+    HubMidiDevice* getMidiDevice(int slot) const;
+
+    // The computer port, if one was set
+    ComputerMidiPort* getComputerPort() const { return computer; }
+
+    // Virtual cables (ports) a connected slot's device has each way
+    uint8_t getInputCables(int slot) const;
+    uint8_t getOutputCables(int slot) const;
 
     // Check if a specific slot is connected
     bool isConnected(int slot) const;
 
+    // Connected slots that take output: the computer port, and host
+    // devices with an OUT pipe
+    SlotMask getOutputSlots() const;
+
     // Callback for connection changes (optional)
     void setConnectionCallback(void (*callback)(int slot, bool connected));
 
 private:
+    // Identity cache entry: connected slots for (VID, PID, tag)
+    struct IdentityEntry {
+        uint16_t vid;
+        uint16_t pid;
+        uint32_t tag;
+        SlotMask slots;  // 0 = empty entry
+    };
+
+    // Open addressing; every device is entered under its serial tag,
+    // port tag and DEVICE_TAG_ANY, so keep it well under full
+    static const int IDENTITY_TABLE_SIZE = 128;
+    static_assert(IDENTITY_TABLE_SIZE >= 4 * MAX_MIDI_DEVICES, "identity table too small");
+
     MidiDeviceInfo devices[MAX_MIDI_DEVICES];
     int deviceCount;
+    ComputerMidiPort* computer;
+    TopologyHub** hubs;
+    int hubCount;
     void (*connectionCallback)(int slot, bool connected);
+    IdentityEntry identities[IDENTITY_TABLE_SIZE];
 
     void updateDeviceName(int slot);
+    void updateDeviceIdentity(int slot);
+    void updateIdLabel(int slot);
+    bool hasUniqueSerial(int slot) const;
+    void rebuildIdentities();
+    void addIdentity(uint16_t vid, uint16_t pid, uint32_t tag, int slot);
+    static int identityHash(uint16_t vid, uint16_t pid, uint32_t tag);
 };
 
 #endif
@@ -0,0 +1,112 @@
+#include "HubMidiDevice.h"
+
+HubMidiDevice* HubMidiDevice::reading = nullptr;
+
+HubMidiDevice::HubMidiDevice(USBHost &host)
+    : MIDIDevice_BigBuffer(host), chunkHandler(nullptr), chunkContext(nullptr),
+      inputCables(1), outputCables(1), txPipe(nullptr), txFill(0) {
+    txCount[0] = txCount[1] = 0;
+    txBusy[0] = txBusy[1] = false;
+    contribute_Pipes(&txPipeStorage, 1);
+    contribute_Transfers(txTransferStorage, 2);
+}
+
+bool HubMidiDevice::queuePacket(uint32_t packet) {
+    if (!canQueue()) return false;
+    txBatch[txFill][txCount[txFill]++] = packet;
+    return true;
+}
+
+int HubMidiDevice::flush() {
+    uint8_t batch = txFill;
+    int count = txCount[batch];
+    if (!txPipe || txBusy[batch] || count == 0) return 0;
+
+    txBusy[batch] = true;
+    if (!queue_Data_Transfer(txPipe, txBatch[batch], count * USB_MIDI_PACKET_BYTES, this)) {
+        txBusy[batch] = false;
+        return 0;
+    }
+    txFill = batch ^ 1;
+    return count;
+}
+
+void HubMidiDevice::txCallback(const Transfer_t* transfer) {
+    HubMidiDevice* dev = (HubMidiDevice*)transfer->driver;
+    if (!dev) return;
+    int batch = (transfer->buffer == dev->txBatch[0]) ? 0 : 1;
+    dev->txCount[batch] = 0;
+    dev->txBusy[batch] = false;
+}
+
+void HubMidiDevice::setSysExChunkHandler(SysExChunkHandler handler, void* context) {
+    chunkHandler = handler;
+    chunkContext = context;
+    setHandleSystemExclusive(onSysExPartial);
+}
+
+bool HubMidiDevice::read(uint8_t channel) {
+    reading = this;
+    bool result = MIDIDevice_BigBuffer::read(channel);
+    reading = nullptr;
+    return result;
+}
+
+bool HubMidiDevice::claim(Device_t* dev, int type, const uint8_t* descriptors, uint32_t len) {
+    if (!MIDIDevice_BigBuffer::claim(dev, type, descriptors, len)) {
+        return false;
+    }
+
+    // Each MIDIStreaming endpoint is followed by a class-specific
+    // descriptor listing its embedded jacks, one per cable:
+    // [bLength, CS_ENDPOINT (0x25), MS_GENERAL (0x01), bNumEmbMIDIJack, ...]
+    inputCables = 1;
+    outputCables = 1;
+    bool inEndpoint = false;
+    const uint8_t* outEndpoint = nullptr;
+    uint32_t offset = descriptors[0];  // Skip our own interface descriptor
+    while (offset + 2 <= len) {
+        const uint8_t* d = descriptors + offset;
+        if (d[0] < 2 || offset + d[0] > len || d[1] == 4) break;  // Next interface
+        if (d[1] == 5 && d[0] >= 3) {
+            inEndpoint = d[2] & 0x80;
+            if (!inEndpoint && d[0] >= 7 && !outEndpoint) outEndpoint = d;
+        } else if (d[1] == 0x25 && d[0] >= 4 && d[2] == 0x01 && d[3] > 0) {
+            uint8_t cables = d[3] > 16 ? 16 : d[3];
+            if (inEndpoint) {
+                inputCables = cables;
+            } else {
+                outputCables = cables;
+            }
+        }
+        offset += d[0];
+    }
+
+    // Our own pipe to the OUT endpoint (bulk or interrupt) for batches:
+    // [bLength, ENDPOINT, bEndpointAddress, bmAttributes, wMaxPacketSize, bInterval]
+    txPipe = nullptr;
+    txCount[0] = txCount[1] = 0;
+    txBusy[0] = txBusy[1] = false;
+    txFill = 0;
+    if (outEndpoint) {
+        uint32_t endpointType = outEndpoint[3] & 0x03;
+        uint32_t maxPacket = outEndpoint[4] | (outEndpoint[5] << 8);
+        if (endpointType == 2 || endpointType == 3) {
+            txPipe = new_Pipe(dev, endpointType, outEndpoint[2] & 0x0F, 0, maxPacket, outEndpoint[6]);
+            if (txPipe) txPipe->callback_function = txCallback;
+        }
+    }
+    return true;
+}
+
+void HubMidiDevice::disconnect() {
+    // The host frees the device's pipes
+    txPipe = nullptr;
+    MIDIDevice_BigBuffer::disconnect();
+}
+
+void HubMidiDevice::onSysExPartial(const uint8_t* data, uint16_t length, bool complete) {
+    if (reading && reading->chunkHandler) {
+        reading->chunkHandler(reading->chunkContext, data, length, complete);
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef HUB_MIDI_DEVICE_H
+#define HUB_MIDI_DEVICE_H
+
+#include <USBHost_t36.h>
+
+// Build a 32-bit USB-MIDI event packet (as stored by USBHost_t36) from a
+// decoded message. Channel is 1-16. Returns 0 for types that can't be
+// sent as a single packet (SysEx).
+inline uint32_t packMidiPacket(uint8_t type, uint8_t data1, uint8_t data2, uint8_t channel, uint8_t cable) {
+    uint32_t header = (uint32_t)(cable & 0x0F) << 4;
+    if (type >= 0x80 && type <= 0xE0) {
+        // Channel voice: CIN is the status high nibble
+        return header | (type >> 4) | ((uint32_t)(type | ((channel - 1) & 0x0F)) << 8) |
+               ((uint32_t)(data1 & 0x7F) << 16) | ((uint32_t)(data2 & 0x7F) << 24);
+    }
+    if (type >= 0xF8 || type == 0xF6) {
+        // Realtime and tune request: single byte
+        return header | 0x0F | ((uint32_t)type << 8);
+    }
+    if (type == 0xF1 || type == 0xF3) {
+        // Two-byte system common
+        return header | 0x02 | ((uint32_t)type << 8) | ((uint32_t)(data1 & 0x7F) << 16);
+    }
+    if (type == 0xF2) {
+        // Song position
+        return header | 0x03 | ((uint32_t)type << 8) |
+               ((uint32_t)(data1 & 0x7F) << 16) | ((uint32_t)(data2 & 0x7F) << 24);
+    }
+    return 0;
+}
+
+// Build a SysEx USB-MIDI packet from 1-3 bytes. With last=false the
+// packet continues the message (always 3 bytes); otherwise it ends it.
+inline uint32_t packSysExPacket(const uint8_t* bytes, uint8_t count, bool last, uint8_t cable) {
+    uint32_t cin = last ? (uint32_t)(0x04 + count) : 0x04;  // 5/6/7 = ends with 1/2/3 bytes
+    uint32_t packet = ((uint32_t)(cable & 0x0F) << 4) | cin;
+    for (uint8_t i = 0; i < count; i++) {
+        packet |= (uint32_t)bytes[i] << (8 * (i + 1));
+    }
+    return packet;
+}
+
+// Move a packed USB-MIDI event to another cable
+inline uint32_t setPacketCable(uint32_t packet, uint8_t cable) {
+    return (packet & ~(uint32_t)0xF0) | ((uint32_t)(cable & 0x0F) << 4);
+}
+
+// USB-MIDI event packets are 4 bytes; a transmit batch fills one 64-byte
+// full-speed USB packet
+const int USB_MIDI_PACKET_BYTES = 4;
+const int USB_TX_BATCH_BYTES = 64;
+const int USB_TX_BATCH_PACKETS = USB_TX_BATCH_BYTES / USB_MIDI_PACKET_BYTES;
+
+// Receives SysEx as it arrives, in chunks of up to SYSEX_MAX_LEN bytes.
+// complete is true for the chunk that ends the message.
+typedef void (*SysExChunkHandler)(void* context, const uint8_t* data, uint16_t length, bool complete);
+
+// Host MIDI device with a packet-level send path, so a message packed
+// once can be written to any number of destinations without re-encoding.
+//
+// Packets are staged into 64-byte batches and each batch goes out as one
+// USB transfer on the device's OUT endpoint, double-buffered so one batch
+// fills while the other is on the wire. (The library's own write path
+// starts a transfer per packet and waits when both of its buffers are
+// busy.) A device whose OUT pipe can't be set up takes no output:
+// canQueue() stays false, and the router doesn't route to it.
+class HubMidiDevice : public MIDIDevice_BigBuffer {
+public:
+    HubMidiDevice(USBHost &host);
+
+    // Stage a pre-packed USB-MIDI event packet for the next batch.
+    // Returns false, staging nothing, if there's no room (see canQueue()).
+    bool queuePacket(uint32_t packet);
+
+    // Whether queuePacket() has room: false while the batch being filled
+    // is full or both batches are still on the wire, and always without
+    // an OUT pipe
+    bool canQueue() const {
+        return txPipe && !txBusy[txFill] && txCount[txFill] < USB_TX_BATCH_PACKETS;
+    }
+
+    // Whether the device takes output at all (its OUT pipe is set up)
+    bool hasOutput() const { return txPipe != nullptr; }
+
+    // Packets staged and not yet sent
+    int stagedPackets() const { return txPipe ? txCount[txFill] : 0; }
+
+    // Send the staged batch as one transfer. Returns the number of
+    // packets sent (0 if nothing was staged or the batch is still busy).
+    int flush();
+
+    // Stream SysEx to a handler instead of buffering whole messages.
+    // The handler runs inside read().
+    void setSysExChunkHandler(SysExChunkHandler handler, void* context);
+
+    // Same as MIDIDevice::read(), dispatching SysEx chunks to this
+    // device's chunk handler
+    bool read(uint8_t channel = 0);
+
+    // Virtual cables (ports) the device declares on its IN and OUT
+    // endpoints, from its descriptors (1 if it doesn't say)
+    uint8_t getInputCables() const { return inputCables; }
+    uint8_t getOutputCables() const { return outputCables; }
+
+    // Where the device is plugged in: hub address (0 = root port) and port
+    uint8_t hubAddress() const { return device ? device->hub_address : 0; }
+    uint8_t hubPort() const { return device ? device->hub_port : 0; }
+
+protected:
+    bool claim(Device_t* dev, int type, const uint8_t* descriptors, uint32_t len) override;
+    void disconnect() override;
+
+private:
+    SysExChunkHandler chunkHandler;
+    void* chunkContext;
+    uint8_t inputCables;
+    uint8_t outputCables;
+
+    // Batched transmit on our own pipe to the OUT endpoint (the library's
+    // pipe is left idle once this one exists)
+    Pipe_t txPipeStorage __attribute__((aligned(32)));
+    Transfer_t txTransferStorage[2] __attribute__((aligned(32)));
+    Pipe_t* txPipe;
+    uint32_t txBatch[2][USB_TX_BATCH_PACKETS];
+    volatile uint8_t txCount[2];  // Packets in each batch
+    volatile bool txBusy[2];      // Batch on the wire
+    uint8_t txFill;               // Batch being filled
+    static void txCallback(const Transfer_t* transfer);
+
+    // The library's SysEx callback has no device argument, so read()
+    // records which device is being read for the shared callback
+    static HubMidiDevice* reading;
+    static void onSysExPartial(const uint8_t* data, uint16_t length, bool complete);
+};
+
+#endif
@@ -1,12 +1,14 @@
 #ifndef LISTITEM_H
 #define LISTITEM_H
 
-// Maximum items in a list view
-const int MAX_LIST_ITEMS = 16;
+#include <stdint.h>
 
 // Maximum visible items on OLED (4 rows fit on 64px height)
 const int VISIBLE_ITEMS = 4;
 
+// Text buffer each visible row can format into
+const int LIST_ROW_TEXT = 64;
+
 // A single list item with optional left, center, right text
 struct ListItem {
     const char* left;    // Optional left-aligned text
@@ -16,56 +18,83 @@ struct ListItem {
     ListItem() : left(nullptr), center(nullptr), right(nullptr) {}
 };
 
-// A list of items with selection state
+// Fills in one row of a list. Text that isn't static can be formatted
+// into buf (LIST_ROW_TEXT bytes); it stays valid while the row is visible.
+typedef void (*ListRowProvider)(int index, ListItem& item, char* buf);
+
+// A list with selection state. Only the visible window of rows is ever
+// built: rows come from a provider, fetched as the window moves, so the
+// list can be any length.
 struct ListView {
-    ListItem items[MAX_LIST_ITEMS];
+    ListItem items[VISIBLE_ITEMS];  // Rows windowStart .. windowStart + VISIBLE_ITEMS - 1
     int count;
     int selectedIndex;
+    int windowStart;
+    uint16_t revision;  // Bumped whenever contents change
 
-    ListView() : count(0), selectedIndex(0) {}
+    ListView() : count(0), selectedIndex(0), windowStart(0), revision(0), provider(nullptr) {}
 
     void clear() {
-        count = 0;
-        selectedIndex = 0;
-        for (int i = 0; i < MAX_LIST_ITEMS; i++) {
-            items[i].left = nullptr;
-            items[i].center = nullptr;
-            items[i].right = nullptr;
-        }
+        setRows(nullptr, 0, 0);
     }
 
-    // Add item with center text only
-    void add(const char* center) {
-        if (count < MAX_LIST_ITEMS) {
-            items[count].left = nullptr;
-            items[count].center = center;
-            items[count].right = nullptr;
-            count++;
+    // Replace the contents: count rows from provider, selection clamped
+    void setRows(ListRowProvider rowProvider, int rowCount, int selected) {
+        provider = rowProvider;
+        count = rowProvider ? rowCount : 0;
+        selectedIndex = clampIndex(selected);
+        windowStart = windowFor(selectedIndex);
+        refresh();
+    }
+
+    // Re-fetch the visible rows (contents changed, same row count)
+    void refresh() {
+        revision++;
+        for (int i = 0; i < VISIBLE_ITEMS; i++) {
+            items[i] = ListItem();
+            if (provider && windowStart + i < count) {
+                provider(windowStart + i, items[i], text[i]);
+            }
         }
     }
 
-    // Add item with left, center, right text
-    void add(const char* left, const char* center, const char* right) {
-        if (count < MAX_LIST_ITEMS) {
-            items[count].left = left;
-            items[count].center = center;
-            items[count].right = right;
-            count++;
+    // A visible row (index must be within the window)
+    const ListItem& item(int index) const {
+        return items[index - windowStart];
+    }
+
+    // Move the selection, scrolling the window to keep it visible
+    void select(int index) {
+        selectedIndex = clampIndex(index);
+        int start = windowFor(selectedIndex);
+        if (start != windowStart) {
+            windowStart = start;
+            refresh();
         }
     }
 
     // Move selection up
     void selectPrev() {
-        if (selectedIndex > 0) {
-            selectedIndex--;
-        }
+        select(selectedIndex - 1);
     }
 
     // Move selection down
     void selectNext() {
-        if (selectedIndex < count - 1) {
-            selectedIndex++;
-        }
+        select(selectedIndex + 1);
+    }
+
+private:
+    ListRowProvider provider;
+    char text[VISIBLE_ITEMS][LIST_ROW_TEXT];
+
+    int clampIndex(int index) const {
+        if (index >= count) index = count - 1;
+        return index < 0 ? 0 : index;
+    }
+
+    // Selection sits on the bottom row once it's past the first screen
+    static int windowFor(int selected) {
+        return selected >= VISIBLE_ITEMS ? selected - VISIBLE_ITEMS + 1 : 0;
     }
 };
 
@@ -0,0 +1,95 @@
+#include "MessageThinner.h"
+
+MessageThinner::MessageThinner() : heldCount(0) {
+    for (int i = 0; i < THIN_ENTRIES; i++) {
+        entries[i].key = EMPTY;
+        entries[i].held = false;
+    }
+}
+
+uint32_t MessageThinner::makeKey(int srcSlot, int dstSlot, uint32_t packet) {
+    // Source and destination slot (5 bits each), cable, status byte with
+    // channel, and the CC or note number for types that have one (pitch
+    // bend's first data byte is its LSB, not a number)
+    uint32_t status = (packet >> 8) & 0xFF;
+    uint32_t type = status & 0xF0;
+    uint32_t number = (type == 0xA0 || type == 0xB0) ? (packet >> 16) & 0x7F : 0;
+    return ((uint32_t)srcSlot << 24) | ((uint32_t)dstSlot << 19) |
+           (((packet >> 4) & 0x0F) << 15) | (status << 7) | number;
+}
+
+ThinResult MessageThinner::offer(int srcSlot, int dstSlot, uint32_t packet, uint32_t readCycles,
+                                 uint32_t intervalCycles, uint32_t now) {
+    uint32_t key = makeKey(srcSlot, dstSlot, packet);
+
+    int spare = -1;
+    for (int i = 0; i < THIN_ENTRIES; i++) {
+        Entry& e = entries[i];
+        if (e.key == key) {
+            e.interval = intervalCycles;
+            if (!e.held && now - e.sentAt >= e.interval) {
+                e.sentAt = now;
+                return ThinResult::SEND;
+            }
+
+            // Too soon: hold it, newest value wins
+            ThinResult result = e.held ? ThinResult::REPLACED : ThinResult::HELD;
+            e.packet = packet;
+            e.readCycles = readCycles;
+            if (!e.held) {
+                e.held = true;
+                heldCount++;
+            }
+            return result;
+        }
+
+        // Unused, or quiet for a whole interval (its next value would be
+        // sent straight away anyway)
+        if (spare < 0 && (e.key == EMPTY || (!e.held && now - e.sentAt >= e.interval))) {
+            spare = i;
+        }
+    }
+
+    // New controller: send and start its interval. With no entry free it
+    // just isn't thinned.
+    if (spare >= 0) {
+        Entry& e = entries[spare];
+        e.key = key;
+        e.sentAt = now;
+        e.interval = intervalCycles;
+        e.held = false;
+    }
+    return ThinResult::SEND;
+}
+
+bool MessageThinner::nextDue(uint32_t now, int& srcSlot, int& dstSlot, uint32_t& packet, uint32_t& readCycles) {
+    if (heldCount == 0) return false;
+
+    for (int i = 0; i < THIN_ENTRIES; i++) {
+        Entry& e = entries[i];
+        if (!e.held || now - e.sentAt < e.interval) continue;
+
+        srcSlot = (e.key >> 24) & 0x1F;
+        dstSlot = (e.key >> 19) & 0x1F;
+        packet = e.packet;
+        readCycles = e.readCycles;
+        e.sentAt = now;
+        e.held = false;
+        heldCount--;
+        return true;
+    }
+    return false;
+}
+
+void MessageThinner::resetSlot(int slot) {
+    for (int i = 0; i < THIN_ENTRIES; i++) {
+        Entry& e = entries[i];
+        if (e.key == EMPTY) continue;
+        int src = (e.key >> 24) & 0x1F;
+        int dst = (e.key >> 19) & 0x1F;
+        if (src != slot && dst != slot) continue;
+        if (e.held) heldCount--;
+        e.key = EMPTY;
+        e.held = false;
+    }
+}
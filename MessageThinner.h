@@ -0,0 +1,56 @@
+#ifndef MESSAGE_THINNER_H
+#define MESSAGE_THINNER_H
+
+#include <stdint.h>
+#include "Config.h"
+
+// Result of MessageThinner::offer()
+enum class ThinResult : uint8_t {
+    SEND,     // Send it now
+    HELD,     // Held as the controller's latest value
+    REPLACED  // Held, replacing an older held value (which is never sent)
+};
+
+// Rate limits controller values on thinned routes (see RouteThin).
+//
+// Keeps a small pool of recently sent controllers, keyed by source,
+// destination, cable, status byte (so channel) and CC/note number. A value
+// inside its controller's interval is held, last value wins, until
+// nextDue() releases it. Controllers idle for a whole interval free their
+// entry; if the pool is still full, values pass through unthinned.
+class MessageThinner {
+public:
+    MessageThinner();
+
+    // A USB-MIDI packet from srcSlot to dstSlot on a thinned route
+    ThinResult offer(int srcSlot, int dstSlot, uint32_t packet, uint32_t readCycles,
+                     uint32_t intervalCycles, uint32_t now);
+
+    // Take the next held value whose interval is up. Returns false when
+    // there are none.
+    bool nextDue(uint32_t now, int& srcSlot, int& dstSlot, uint32_t& packet, uint32_t& readCycles);
+
+    bool hasHeld() const { return heldCount > 0; }
+
+    // Drop held values and entries to or from a slot
+    void resetSlot(int slot);
+
+private:
+    static const uint32_t EMPTY = 0xFFFFFFFF;
+
+    struct Entry {
+        uint32_t key;         // EMPTY if unused
+        uint32_t packet;      // Held value
+        uint32_t readCycles;  // When the held value was read
+        uint32_t sentAt;      // When this controller last went out
+        uint32_t interval;    // In cycles
+        bool held;
+    };
+
+    Entry entries[THIN_ENTRIES];
+    int heldCount;
+
+    static uint32_t makeKey(int srcSlot, int dstSlot, uint32_t packet);
+};
+
+#endif
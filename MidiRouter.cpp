@@ -0,0 +1,530 @@
+#include "MidiRouter.h"
+#include "ClockEngine.h"
+
+MidiRouter* MidiRouter::dispatchRouter = nullptr;
+
+static_assert(USB_TX_FLUSH_PACKETS >= 1 && USB_TX_FLUSH_PACKETS <= USB_TX_BATCH_PACKETS,
+              "USB_TX_FLUSH_PACKETS must fit one transmit batch");
+
+// Most packets one read() can queue per destination: a full SysEx chunk
+// (MIDIDevice_BigBuffer buffers 290 bytes) plus the up to 3 bytes held
+// back from the chunk before, at 3 bytes per packet
+static const int READ_MAX_PACKETS = (290 + 3 + 2) / 3;
+static_assert(OUTPUT_QUEUE_PACKETS > READ_MAX_PACKETS, "Output queues need room for a SysEx chunk");
+
+// SysEx packets packed before being handed to the destinations as one run
+static const int SYSEX_RUN_PACKETS = 32;
+
+#if defined(OUTPUT_HOLD_SOURCE)
+static const OutputDropPolicy DEFAULT_DROP_POLICY = OutputDropPolicy::HOLD_SOURCE;
+#elif defined(OUTPUT_DROP_NEWEST)
+static const OutputDropPolicy DEFAULT_DROP_POLICY = OutputDropPolicy::DROP_NEWEST;
+#else
+static const OutputDropPolicy DEFAULT_DROP_POLICY = OutputDropPolicy::DROP_OLDEST;
+#endif
+
+MidiRouter::MidiRouter(DeviceManager& devices, RouteManager& routes, MidiStats& stats)
+    : devices(devices), routes(routes), stats(stats), clock(nullptr), startSlot(0), readingSlot(-1),
+      queued(0), dispatching(false), lockDepth(0) {
+    for (int i = 0; i < MAX_MIDI_DEVICES; i++) {
+        dropPolicy[i] = DEFAULT_DROP_POLICY;
+        sysex[i].active = false;
+        sysex[i].dests = 0;
+        sysex[i].pendingLength = 0;
+        sysex[i].totalLength = 0;
+        sysexOwner[i] = -1;
+    }
+}
+
+void MidiRouter::begin() {
+    for (int slot = 0; slot < MAX_MIDI_DEVICES; slot++) {
+        HubMidiDevice* dev = devices.getMidiDevice(slot);
+        if (dev) {
+            dev->setSysExChunkHandler(onSysExChunk, this);
+        }
+    }
+#ifdef COMPUTER_MIDI_PORT
+    if (devices.getComputerPort()) {
+        devices.getComputerPort()->setSysExChunkHandler(onSysExChunk, this);
+    }
+#endif
+}
+
+void MidiRouter::route() {
+    // Hold off the clock engine's timer for the pass (matters when this
+    // runs from loop(); its ticks are sent at the end instead)
+    lockDepth++;
+
+    uint16_t drained[MAX_MIDI_DEVICES] = {0};
+    SlotMask pending = 0;
+    for (int slot = 0; slot < MAX_MIDI_DEVICES; slot++) {
+        if (devices.isConnected(slot)) {
+            pending |= (SlotMask)(1u << slot);
+        }
+    }
+
+    // Drain round-robin, one message per slot per round, until every queue
+    // is empty or the budget is spent
+    int budget = MIDI_DRAIN_BUDGET;
+    while (pending && budget > 0) {
+        for (int n = 0; n < MAX_MIDI_DEVICES && budget > 0; n++) {
+            int srcSlot = (startSlot + n) % MAX_MIDI_DEVICES;
+            SlotMask bit = (SlotMask)(1u << srcSlot);
+            if (!(pending & bit)) continue;
+
+            if (isHeld(srcSlot) || !routeMessage(srcSlot)) {
+                pending &= (SlotMask)~bit;
+                continue;
+            }
+            drained[srcSlot]++;
+            budget--;
+        }
+    }
+    startSlot = (startSlot + 1) % MAX_MIDI_DEVICES;
+
+    for (int slot = 0; slot < MAX_MIDI_DEVICES; slot++) {
+        if (drained[slot]) {
+            // Still pending after the budget ran out counts as one more
+            bool backlog = pending & (SlotMask)(1u << slot);
+            stats.recordDrained(slot, drained[slot] + (backlog ? 1 : 0));
+        }
+    }
+
+    releaseThinned();
+    flushOutputs();
+    if (clock) clock->service();
+    lockDepth--;
+}
+
+void MidiRouter::releaseThinned() {
+    if (!thinner.hasHeld()) return;
+
+    uint32_t now = MidiStats::cycles();
+    int srcSlot;
+    int dstSlot;
+    uint32_t packet;
+    uint32_t readCycles;
+    while (thinner.nextDue(now, srcSlot, dstSlot, packet, readCycles)) {
+        enqueue(srcSlot, dstSlot, packet, readCycles);
+    }
+}
+
+void MidiRouter::sendClock(int srcSlot, uint8_t cable) {
+    forward(srcSlot, cable, 0xF8, 0, 0, 0, MidiStats::cycles());
+    flushOutputs();
+}
+
+void MidiRouter::sendRealtime(uint8_t status) {
+    fanOut(-1, devices.getOutputSlots(), packMidiPacket(status, 0, 0, 0, 0), MidiStats::cycles());
+    flushOutputs();
+}
+
+void MidiRouter::setDropPolicy(int slot, OutputDropPolicy policy) {
+    if (slot < 0 || slot >= MAX_MIDI_DEVICES) return;
+    dropPolicy[slot] = policy;
+}
+
+bool MidiRouter::isHeld(int srcSlot) {
+    // A SysEx message in progress counts the destinations it started
+    // with, even if their route has gone since
+    bool held = false;
+    SlotMask dests = routes.getSourceDests(srcSlot) | sysex[srcSlot].dests;
+    for (SlotMask d = dests & queued; d; d &= d - 1) {
+        int dstSlot = __builtin_ctz(d);
+        if (dropPolicy[dstSlot] == OutputDropPolicy::HOLD_SOURCE &&
+            outputs[dstSlot].space() < READ_MAX_PACKETS) {
+            stats.recordOutputHeld(dstSlot);
+            held = true;
+        }
+    }
+    return held;
+}
+
+void MidiRouter::enqueue(int srcSlot, int dstSlot, uint32_t packet, uint32_t readCycles) {
+    OutputPush result = outputs[dstSlot].push(srcSlot, packet, readCycles, dropPolicy[dstSlot]);
+    if (result != OutputPush::QUEUED) {
+        stats.recordOutputDropped(dstSlot);
+    }
+    queued |= (SlotMask)(1u << dstSlot);
+}
+
+void MidiRouter::fanOut(int srcSlot, SlotMask dests, uint32_t packet, uint32_t readCycles) {
+    for (; dests; dests &= dests - 1) {
+        enqueue(srcSlot, __builtin_ctz(dests), packet, readCycles);
+    }
+}
+
+void MidiRouter::flushOutputs() {
+    SlotMask pending = queued;
+    while (pending) {
+        int dstSlot = __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        bool idle;
+        if (!devices.isConnected(dstSlot)) {
+            outputs[dstSlot].clear();
+            idle = true;
+#ifdef COMPUTER_MIDI_PORT
+        } else if (dstSlot == COMPUTER_SLOT) {
+            idle = drainOutput(dstSlot, devices.getComputerPort());
+#endif
+        } else {
+            idle = drainOutput(dstSlot, devices.getMidiDevice(dstSlot));
+        }
+        if (idle) {
+            queued &= (SlotMask)~(1u << dstSlot);
+        }
+    }
+}
+
+template <class Port>
+bool MidiRouter::drainOutput(int dstSlot, Port* dest) {
+    OutputQueue& queue = outputs[dstSlot];
+
+    // Stage packets into the device's transmit batch, sending a batch
+    // each time it reaches the flush boundary, until the pass budget
+    // is spent or the device's buffers are all on the wire
+    int srcSlot;
+    uint32_t packet;
+    uint32_t readCycles;
+    for (int n = 0; n < OUTPUT_PACKETS_PER_PASS && dest->canQueue() &&
+                    queue.pop(srcSlot, packet, readCycles); n++) {
+        dest->queuePacket(packet);
+        if (dest->stagedPackets() >= USB_TX_FLUSH_PACKETS) {
+            sendBatch(dstSlot, dest);
+        }
+
+        // SysEx (CIN 4-7) is counted once per message when it ends;
+        // generated realtime has no source
+        uint8_t cin = packet & 0x0F;
+        if (srcSlot < 0) {
+            stats.recordGenerated(dstSlot, 1);
+        } else if (cin < 0x04 || cin > 0x07) {
+            uint8_t status = (packet >> 8) & 0xFF;
+            uint16_t length = MidiStats::messageLength(status >= 0xF0 ? status : (status & 0xF0));
+            stats.recordForwarded(srcSlot, dstSlot, length, MidiStats::cycles() - readCycles);
+        }
+    }
+
+    // Whatever is left goes out at the end of the pass
+    sendBatch(dstSlot, dest);
+
+    stats.recordOutputDepth(dstSlot, queue.depth());
+    return queue.isEmpty() && dest->stagedPackets() == 0;
+}
+
+template <class Port>
+void MidiRouter::sendBatch(int dstSlot, Port* dest) {
+    int packets = dest->flush();
+    if (packets) {
+        stats.recordTransfer(dstSlot, packets);
+    }
+}
+
+bool MidiRouter::routeMessage(int srcSlot) {
+#ifdef COMPUTER_MIDI_PORT
+    if (srcSlot == COMPUTER_SLOT) {
+        return routeFrom(srcSlot, devices.getComputerPort());
+    }
+#endif
+    return routeFrom(srcSlot, devices.getMidiDevice(srcSlot));
+}
+
+template <class Port>
+bool MidiRouter::routeFrom(int srcSlot, Port* source) {
+    uint32_t readStart = MidiStats::cycles();
+    readingSlot = srcSlot;
+    bool received = source->read();
+    readingSlot = -1;
+    if (!received) return false;
+
+    // Get MIDI message data
+    uint8_t type = source->getType();
+
+    // SysEx was already forwarded chunk by chunk from inside read()
+    if (type == 0xF0) return true;
+
+    uint8_t data1 = source->getData1();
+    uint8_t data2 = source->getData2();
+    uint8_t channel = source->getChannel();
+    uint8_t cable = source->getCable();
+
+    uint16_t length = MidiStats::messageLength(type);
+    stats.recordReceived(srcSlot, length, false);
+
+    // The clock engine may take over clock from this source
+    if (clock && type >= 0xF8) {
+        if (type == 0xF8) {
+            if (clock->onClockIn(srcSlot, cable, readStart)) return true;
+        } else {
+            clock->onTransport(srcSlot, type);
+        }
+    }
+
+    forward(srcSlot, cable, type, data1, data2, channel, readStart);
+    return true;
+}
+
+void MidiRouter::forward(int srcSlot, uint8_t cable, uint8_t type, uint8_t data1, uint8_t data2,
+                         uint8_t channel, uint32_t readStart) {
+    // Destinations come from the precompiled route table
+    SlotMask destMask = routes.getDestMask(srcSlot, cable);
+    if (destMask & routes.getFilteredMask(srcSlot, cable)) {
+        SlotMask passed = routes.applyFilters(srcSlot, cable, destMask, type, channel, data1);
+        if (passed != destMask) {
+            stats.recordFiltered(srcSlot);
+        }
+        destMask = passed;
+    }
+    if (!destMask) {
+        stats.recordDropped(srcSlot);
+        return;
+    }
+
+    // Pack once; every destination queues the same USB-MIDI packet, with
+    // the cable patched for routes that remap it and the channel, note,
+    // velocity or CC changed for routes that transform it. Undefined system
+    // messages (0xF4, 0xF5) have no packet form and are dropped.
+    uint32_t packet = packMidiPacket(type, data1, data2, channel, cable);
+    if (!packet) {
+        stats.recordDropped(srcSlot);
+        return;
+    }
+    SlotMask remapMask = routes.getRemapMask(srcSlot, cable);
+    SlotMask thinnedMask = RouteThin::typeBit(type) ? routes.getThinnedMask(srcSlot, cable) : 0;
+    SlotMask transformedMask = (type < 0xF0) ? routes.getTransformedMask(srcSlot, cable) : 0;
+
+    // Nothing per destination to look at: the same packet to all of them
+    if (!(destMask & (remapMask | thinnedMask | transformedMask))) {
+        fanOut(srcSlot, destMask, packet, readStart);
+        return;
+    }
+
+    // Walk destination bits, lowest slot first
+    while (destMask) {
+        int dstSlot = __builtin_ctz(destMask);
+        destMask &= destMask - 1;
+        SlotMask bit = (SlotMask)(1u << dstSlot);
+
+        // Route the message
+        uint8_t outCable = cable;
+        if (remapMask & bit) {
+            outCable = routes.getOutputCable(srcSlot, cable, dstSlot);
+        }
+        uint32_t out = (outCable == cable) ? packet : setPacketCable(packet, outCable);
+        if (transformedMask & bit) {
+            out = routes.applyTransform(srcSlot, cable, dstSlot, out);
+        }
+
+        // Thinned routes hold controller values that come too fast
+        if (thinnedMask & bit) {
+            const RouteThin& thin = routes.getThin(srcSlot, cable, dstSlot);
+            if (thin.thins(type)) {
+                uint32_t interval = thin.intervalMs * (F_CPU_ACTUAL / 1000);
+                ThinResult result = thinner.offer(srcSlot, dstSlot, out, readStart, interval, readStart);
+                if (result == ThinResult::REPLACED) {
+                    stats.recordThinned(dstSlot);
+                }
+                if (result != ThinResult::SEND) continue;
+            }
+        }
+        enqueue(srcSlot, dstSlot, out, readStart);
+    }
+}
+
+bool MidiRouter::beginDispatch(unsigned long periodUs) {
+    dispatchRouter = this;
+
+    dispatchTimer.priority(DISPATCH_PRIORITY);
+    dispatching = dispatchTimer.begin(dispatchISR, periodUs);
+    return dispatching;
+}
+
+void MidiRouter::dispatchISR() {
+    MidiRouter* router = dispatchRouter;
+    if (router && router->lockDepth == 0) {
+        router->route();
+    }
+}
+
+void MidiRouter::resetSlot(int slot) {
+    if (slot < 0 || slot >= MAX_MIDI_DEVICES) return;
+
+    // Abandon a half-sent SysEx from this source: end it where it was
+    // going and free those outputs
+    SysExStream& stream = sysex[slot];
+    uint32_t now = MidiStats::cycles();
+    for (SlotMask d = stream.dests; d; d &= d - 1) {
+        int dstSlot = __builtin_ctz(d);
+        sysexOwner[dstSlot] = -1;
+        outputs[dstSlot].endSysEx(slot, now);
+        queued |= (SlotMask)(1u << dstSlot);
+    }
+    stream.active = false;
+    stream.dests = 0;
+    stream.pendingLength = 0;
+    stream.totalLength = 0;
+
+    // Nothing more can be sent to a departed device
+    outputs[slot].clear();
+    thinner.resetSlot(slot);
+}
+
+void MidiRouter::onSysExChunk(void* context, const uint8_t* data, uint16_t length, bool complete) {
+    MidiRouter* router = (MidiRouter*)context;
+    if (router->readingSlot >= 0) {
+        router->streamSysEx(router->readingSlot, data, length, complete);
+    }
+}
+
+void MidiRouter::streamSysEx(int srcSlot, const uint8_t* data, uint16_t length, bool complete) {
+    SysExStream& stream = sysex[srcSlot];
+#ifdef COMPUTER_MIDI_PORT
+    uint8_t cable = (srcSlot == COMPUTER_SLOT) ? devices.getComputerPort()->getCable()
+                                               : devices.getMidiDevice(srcSlot)->getCable();
+#else
+    uint8_t cable = devices.getMidiDevice(srcSlot)->getCable();
+#endif
+
+    if (!stream.active) {
+        // New message: pick destinations and output cables now and keep
+        // them for the whole message, skipping outputs already carrying
+        // another source's SysEx (streaming, or still queued)
+        SlotMask dests = routes.getDestMask(srcSlot, cable);
+        if (dests & routes.getFilteredMask(srcSlot, cable)) {
+            dests = routes.applyFilters(srcSlot, cable, dests, 0xF0, 0, 0);
+        }
+        for (SlotMask d = dests; d; d &= d - 1) {
+            int dstSlot = __builtin_ctz(d);
+            if (sysexOwner[dstSlot] >= 0 || outputs[dstSlot].hasOtherSysEx(srcSlot)) {
+                dests &= (SlotMask)~(1u << dstSlot);
+                stats.recordSysExBlocked(dstSlot);
+            } else {
+                sysexOwner[dstSlot] = (int8_t)srcSlot;
+                stream.destCables[dstSlot] = routes.getOutputCable(srcSlot, cable, dstSlot);
+            }
+        }
+
+        stream.active = true;
+        stream.dests = dests;
+        stream.pendingLength = 0;
+        stream.totalLength = 0;
+    }
+
+    // Pack the chunk once, in runs handed to every destination. Hold back
+    // up to 3 bytes so the final packet can carry the end marker.
+    uint32_t run[SYSEX_RUN_PACKETS];
+    int runLength = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        if (stream.pendingLength == 3) {
+            run[runLength++] = packSysExPacket(stream.pending, 3, false, 0);
+            stream.pendingLength = 0;
+            if (runLength == SYSEX_RUN_PACKETS) {
+                fanOutSysEx(srcSlot, run, runLength);
+                runLength = 0;
+            }
+        }
+        stream.pending[stream.pendingLength++] = data[i];
+    }
+    stream.totalLength += length;
+
+    if (complete && stream.pendingLength > 0) {
+        run[runLength++] = packSysExPacket(stream.pending, stream.pendingLength, true, 0);
+    }
+    if (runLength > 0) {
+        fanOutSysEx(srcSlot, run, runLength);
+    }
+
+    if (!complete) return;
+
+    stats.recordReceived(srcSlot, stream.totalLength, true);
+    if (!stream.dests) {
+        stats.recordDropped(srcSlot);
+    }
+    for (SlotMask d = stream.dests; d; d &= d - 1) {
+        int dstSlot = __builtin_ctz(d);
+        sysexOwner[dstSlot] = -1;
+        stats.recordForwardedSysEx(srcSlot, dstSlot, stream.totalLength);
+    }
+
+    stream.active = false;
+    stream.dests = 0;
+    stream.pendingLength = 0;
+}
+
+void MidiRouter::fanOutSysEx(int srcSlot, const uint32_t* run, int length) {
+    SysExStream& stream = sysex[srcSlot];
+    uint32_t now = MidiStats::cycles();
+    for (SlotMask d = stream.dests; d; d &= d - 1) {
+        int dstSlot = __builtin_ctz(d);
+        OutputQueue& queue = outputs[dstSlot];
+        queued |= (SlotMask)(1u << dstSlot);
+
+        if (queue.space() < length && dropPolicy[dstSlot] == OutputDropPolicy::DROP_OLDEST) {
+            int evicted = queue.makeRoom(length);
+            if (evicted) {
+                stats.recordOutputDropped(dstSlot, evicted);
+            }
+        }
+        if (queue.pushRun(srcSlot, run, length, stream.destCables[dstSlot], now)) continue;
+
+        // No room, and packets can't be dropped from the middle of a
+        // message: the rest of this one doesn't go to this destination.
+        // What it already has is ended with an F7 (the queue keeps room
+        // for it), so the device isn't left inside a SysEx.
+        stats.recordOutputDropped(dstSlot, length);
+        queue.endSysEx(srcSlot, now);
+        stream.dests &= (SlotMask)~(1u << dstSlot);
+        sysexOwner[dstSlot] = -1;
+    }
+}
+
+void MidiRouter::benchmarkFanout(Print& out) {
+    // Scratch queues, one per destination, so the live outputs, their
+    // queued bits and the SysEx streams are never touched
+    static const int RUNS = 8;
+    static const int DESTS = 7;
+    static OutputQueue scratch[DESTS];
+    int srcSlot = 0;
+    uint32_t note = packMidiPacket(0x90, 60, 100, 1, 0);
+    uint8_t chunk[3 * SYSEX_RUN_PACKETS];
+    memset(chunk, 0x55, sizeof(chunk));
+
+    out.println("Fan-out cost per destination (cycles):");
+    for (int n = 1; n <= DESTS; n++) {
+        uint32_t noteCycles = 0;
+        uint32_t sysexCycles = 0;
+        for (int r = 0; r < RUNS; r++) {
+            uint32_t start = MidiStats::cycles();
+            for (int d = 0; d < n; d++) {
+                scratch[d].push(srcSlot, note, start, DEFAULT_DROP_POLICY);
+            }
+            noteCycles += MidiStats::cycles() - start;
+
+            // A full run of packets, as from one stretch of a SysEx chunk
+            uint32_t run[SYSEX_RUN_PACKETS];
+            start = MidiStats::cycles();
+            for (int k = 0; k < SYSEX_RUN_PACKETS; k++) {
+                run[k] = packSysExPacket(chunk + 3 * k, 3, false, 0);
+            }
+            for (int d = 0; d < n; d++) {
+                scratch[d].pushRun(srcSlot, run, SYSEX_RUN_PACKETS, 0, start);
+            }
+            sysexCycles += MidiStats::cycles() - start;
+
+            for (int d = 0; d < n; d++) {
+                scratch[d].clear();
+            }
+        }
+
+        out.print("  ");
+        out.print(n);
+        out.print(" dest: note ");
+        out.print(noteCycles / (RUNS * n));
+        out.print(", sysex ");
+        out.print(sysexCycles / (RUNS * n));
+        out.print(" (");
+        out.print(SYSEX_RUN_PACKETS);
+        out.println(" packets)");
+    }
+}
@@ -0,0 +1,163 @@
+#ifndef MIDI_ROUTER_H
+#define MIDI_ROUTER_H
+
+#include "Config.h"
+#include "DeviceManager.h"
+#include "RouteManager.h"
+#include "MidiStats.h"
+#include "OutputQueue.h"
+#include "MessageThinner.h"
+
+class ClockEngine;
+
+// Interrupt priority for routing dispatch and the clock engine's timer.
+// Below the USB host and device interrupts (128 or higher), so a transfer
+// completing is never stuck behind a routing pass waiting on it, but
+// above loop(). The USB drivers are built to be called from code their
+// interrupts preempt, as loop() does when dispatch is off.
+const uint8_t DISPATCH_PRIORITY = 144;
+
+// Forwards MIDI between device slots using the compiled route table.
+// Holds no sketch state, so it can be driven by anything that provides
+// the device, route and stats objects.
+//
+// Messages are queued per destination and written out at the end of each
+// pass by the destination's OutputQueue scheduler, a bounded number of
+// packets at a time, packed into batched USB transfers.
+class MidiRouter {
+public:
+    MidiRouter(DeviceManager& devices, RouteManager& routes, MidiStats& stats);
+
+    // Hook SysEx streaming into every device slot (after DeviceManager::init)
+    void begin();
+
+    // Hand clock (0xF8) and transport messages to a clock engine
+    void setClockEngine(ClockEngine* engine) { clock = engine; }
+
+    // Forget per-source state for a slot (device connected or disconnected)
+    void resetSlot(int slot);
+
+    // Drain pending messages from all sources round-robin, up to
+    // MIDI_DRAIN_BUDGET messages, then send queued output (call every
+    // loop pass unless dispatching)
+    void route();
+
+    // What a destination's full output queue does (default from Config.h)
+    void setDropPolicy(int slot, OutputDropPolicy policy);
+    OutputDropPolicy getDropPolicy(int slot) const { return dropPolicy[slot]; }
+
+    // Packets waiting to be sent to a slot
+    int getOutputDepth(int slot) const { return outputs[slot].depth(); }
+
+    // Call route() from a timer interrupt every periodUs microseconds
+    bool beginDispatch(unsigned long periodUs);
+    bool isDispatching() const { return dispatching; }
+
+    // Hold off interrupt dispatch while loop() changes USB, device or
+    // route state. Nests; keep the locked section short.
+    void lock() { lockDepth++; }
+    void unlock() { lockDepth--; }
+
+    // Locked by loop(), or a routing pass is running
+    bool isLocked() const { return lockDepth != 0; }
+
+    // Send a clock tick wherever srcSlot's routes send clock on that cable,
+    // and flush it out (clock engine; router locked or from its timer)
+    void sendClock(int srcSlot, uint8_t cable);
+
+    // Send a realtime message to every connected device that takes output,
+    // on cable 0 (internal clock master), and flush it out
+    void sendRealtime(uint8_t status);
+
+    // Time queueing a note and a SysEx run for 1 to 7 destinations and
+    // print the cost per destination. Runs on scratch queues, so it can be
+    // called at any time.
+    void benchmarkFanout(Print& out);
+
+private:
+    // In-progress SysEx message from one source, forwarded as it arrives
+    struct SysExStream {
+        bool active;
+        SlotMask dests;       // Destinations fixed when the message started
+        uint8_t destCables[MAX_MIDI_DEVICES];  // Output cable per destination
+        uint8_t pending[3];   // Bytes not yet sent (a packet holds 3)
+        uint8_t pendingLength;
+        uint32_t totalLength;
+    };
+
+    DeviceManager& devices;
+    RouteManager& routes;
+    MidiStats& stats;
+    ClockEngine* clock;
+
+    // Slot that gets first pick next pass (rotates so a spent budget
+    // doesn't always favour the low slots)
+    int startSlot;
+
+    // Slot currently inside read() (for SysEx chunks)
+    int readingSlot;
+
+    SysExStream sysex[MAX_MIDI_DEVICES];
+
+    // Source slot streaming SysEx into each destination, -1 if none.
+    // Keeps two dumps from interleaving on one output.
+    int8_t sysexOwner[MAX_MIDI_DEVICES];
+
+    // Controller values held back by route thinning
+    MessageThinner thinner;
+
+    // Output scheduling per destination slot
+    OutputQueue outputs[MAX_MIDI_DEVICES];
+    OutputDropPolicy dropPolicy[MAX_MIDI_DEVICES];
+    SlotMask queued;  // Destinations with packets waiting
+
+    // Interrupt dispatch
+    IntervalTimer dispatchTimer;
+    bool dispatching;
+    volatile uint8_t lockDepth;
+    static MidiRouter* dispatchRouter;
+    static void dispatchISR();
+
+    static void onSysExChunk(void* context, const uint8_t* data, uint16_t length, bool complete);
+    void streamSysEx(int srcSlot, const uint8_t* data, uint16_t length, bool complete);
+
+    // Queue a run of SysEx packets (cable 0) for every destination of the
+    // source's message, each on its output cable. A destination without
+    // room for the whole run is dropped from the message, ending what it
+    // has already queued with an F7.
+    void fanOutSysEx(int srcSlot, const uint32_t* run, int length);
+
+    // Queue a packet for a destination, applying its drop policy
+    void enqueue(int srcSlot, int dstSlot, uint32_t packet, uint32_t readCycles);
+
+    // Queue the same packet for every destination in dests
+    void fanOut(int srcSlot, SlotMask dests, uint32_t packet, uint32_t readCycles);
+
+    // Whether a source must stay unread because a destination holding
+    // sources (its own routes, or its SysEx message's) has no room for
+    // what one read() can produce
+    bool isHeld(int srcSlot);
+
+    // Queue thinned controller values whose interval is up
+    void releaseThinned();
+
+    // Send up to OUTPUT_PACKETS_PER_PASS packets to each destination,
+    // batched into USB transfers
+    void flushOutputs();
+
+    // Send one destination's share of a pass to its port (a host device
+    // or the computer). Returns true once nothing is left to send.
+    template <class Port> bool drainOutput(int dstSlot, Port* dest);
+    template <class Port> void sendBatch(int dstSlot, Port* dest);
+
+    // Read one message from a source slot and forward it to its routes.
+    // Returns false if the source had nothing pending.
+    bool routeMessage(int srcSlot);
+    template <class Port> bool routeFrom(int srcSlot, Port* source);
+
+    // Forward a decoded message to the routes of its source and cable
+    void forward(int srcSlot, uint8_t cable, uint8_t type, uint8_t data1, uint8_t data2,
+                 uint8_t channel, uint32_t readStart);
+};
+
+#endif
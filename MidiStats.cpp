@@ -0,0 +1,169 @@
+#include "MidiStats.h"
+#include <string.h>
+
+MidiStats::MidiStats() {
+    reset();
+}
+
+void MidiStats::reset() {
+    memset(slots, 0, sizeof(slots));
+    memset(routeMessages, 0, sizeof(routeMessages));
+    memset(loopHistogram, 0, sizeof(loopHistogram));
+    memset(&clockIn, 0, sizeof(clockIn));
+    memset(&clockOut, 0, sizeof(clockOut));
+    loopMaxMicros = 0;
+}
+
+void MidiStats::resetSlot(int slot) {
+    if (slot < 0 || slot >= MAX_MIDI_DEVICES) return;
+    memset(&slots[slot], 0, sizeof(slots[slot]));
+    for (int i = 0; i < MAX_MIDI_DEVICES; i++) {
+        routeMessages[slot][i] = 0;
+        routeMessages[i][slot] = 0;
+    }
+}
+
+uint32_t MidiStats::getLatencyAvgMicros(int slot) const {
+    const SlotStats& s = slots[slot];
+    if (s.latencySamples == 0) return 0;
+    return cyclesToMicros(s.latencyTotalCycles / s.latencySamples);
+}
+
+uint32_t MidiStats::getLatencyMaxMicros(int slot) const {
+    return cyclesToMicros(slots[slot].latencyMaxCycles);
+}
+
+uint32_t MidiStats::getLoopPercentileMicros(int percent) const {
+    uint32_t total = 0;
+    for (int i = 0; i < LOOP_HISTOGRAM_BUCKETS; i++) {
+        total += loopHistogram[i];
+    }
+    if (total == 0) return 0;
+
+    // Report the upper edge of the bucket the percentile falls in
+    uint64_t target = ((uint64_t)total * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < LOOP_HISTOGRAM_BUCKETS - 1; i++) {
+        seen += loopHistogram[i];
+        if (seen >= target) return (2u << i) - 1;
+    }
+    return loopMaxMicros;
+}
+
+uint16_t MidiStats::messageLength(uint8_t type) {
+    switch (type) {
+        case 0xC0:  // Program change
+        case 0xD0:  // Channel pressure
+        case 0xF1:  // Time code quarter frame
+        case 0xF3:  // Song select
+            return 2;
+        case 0x80:
+        case 0x90:
+        case 0xA0:
+        case 0xB0:
+        case 0xE0:
+        case 0xF2:  // Song position
+            return 3;
+        default:    // Tune request and realtime
+            return 1;
+    }
+}
+
+void MidiStats::print(Print& out) const {
+    out.println("--- MIDI stats ---");
+
+    out.print("loop max ");
+    out.print(loopMaxMicros);
+    out.print("us  p50 <");
+    out.print(getLoopPercentileMicros(50));
+    out.print("us  p99 <");
+    out.print(getLoopPercentileMicros(99));
+    out.println("us");
+
+    out.print("loop histogram (us):");
+    for (int i = 0; i < LOOP_HISTOGRAM_BUCKETS; i++) {
+        out.print(" <");
+        if (i == LOOP_HISTOGRAM_BUCKETS - 1) {
+            out.print("inf");
+        } else {
+            out.print(2u << i);
+        }
+        out.print(":");
+        out.print(loopHistogram[i]);
+    }
+    out.println();
+
+    if (clockIn.samples || clockOut.samples) {
+        out.print("clock jitter in avg ");
+        out.print(getClockInJitterAvgMicros());
+        out.print("us max ");
+        out.print(getClockInJitterMaxMicros());
+        out.print("us, out avg ");
+        out.print(getClockOutJitterAvgMicros());
+        out.print("us max ");
+        out.print(getClockOutJitterMaxMicros());
+        out.println("us");
+    }
+
+    for (int slot = 0; slot < MAX_MIDI_DEVICES; slot++) {
+        const SlotStats& s = slots[slot];
+        if (!s.rxMessages && !s.txMessages) continue;
+
+        out.print("slot ");
+        out.print(slot);
+        out.print(": rx ");
+        out.print(s.rxMessages);
+        out.print(" (");
+        out.print(s.rxBytes);
+        out.print("B) tx ");
+        out.print(s.txMessages);
+        out.print(" (");
+        out.print(s.txBytes);
+        out.print("B) sysex ");
+        out.print(s.sysexCount);
+        out.print(" burst ");
+        out.print(s.maxDrained);
+        out.print(" drop ");
+        out.print(s.dropped);
+        out.print(" filt ");
+        out.print(s.filtered);
+        out.print(" thin ");
+        out.print(s.thinned);
+        out.print(" out drop ");
+        out.print(s.outputDropped);
+        out.print(" held ");
+        out.print(s.outputHeld);
+        out.print(" sysex busy ");
+        out.print(s.sysexBlocked);
+        out.print(" max ");
+        out.print(s.outputMaxDepth);
+        out.print(" usb xfer ");
+        out.print(s.usbTransfers);
+        if (s.usbTransfers) {
+            // Packets per transfer, one decimal
+            uint32_t tenths = s.usbPackets * 10 / s.usbTransfers;
+            out.print(" (");
+            out.print(tenths / 10);
+            out.print(".");
+            out.print(tenths % 10);
+            out.print(" pkt/xfer)");
+        }
+        out.print(" lat avg ");
+        out.print(getLatencyAvgMicros(slot));
+        out.print("us max ");
+        out.print(getLatencyMaxMicros(slot));
+        out.println("us");
+    }
+
+    for (int src = 0; src < MAX_MIDI_DEVICES; src++) {
+        for (int dst = 0; dst < MAX_MIDI_DEVICES; dst++) {
+            if (!routeMessages[src][dst]) continue;
+            out.print("route ");
+            out.print(src);
+            out.print(">");
+            out.print(dst);
+            out.print(": ");
+            out.println(routeMessages[src][dst]);
+        }
+    }
+}
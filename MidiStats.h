@@ -0,0 +1,207 @@
+#ifndef MIDI_STATS_H
+#define MIDI_STATS_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Number of loop-time histogram buckets (bucket N counts loops of
+// 2^N..2^(N+1)-1 us, the last bucket catches everything slower)
+const int LOOP_HISTOGRAM_BUCKETS = 12;
+
+// Counters for one device slot
+struct SlotStats {
+    uint32_t rxMessages;      // Messages read from this device
+    uint32_t rxBytes;
+    uint32_t txMessages;      // Messages forwarded to this device
+    uint32_t txBytes;
+    uint32_t sysexCount;      // SysEx messages read from this device
+    uint32_t maxDrained;      // Most messages read from this device in one routing pass
+    uint32_t dropped;         // Messages read with no route to forward them
+    uint32_t filtered;        // Messages blocked by a route filter (per route hit)
+    uint32_t thinned;         // Controller values to this device replaced by a newer one (route thinning)
+    uint32_t outputDropped;   // Packets to this device dropped on a full output queue
+    uint32_t outputHeld;      // Source reads held off while this device's queue was full
+    uint32_t sysexBlocked;    // SysEx messages not sent to this device because another source's was
+    uint32_t outputMaxDepth;  // Most packets queued for this device at once
+    uint32_t usbTransfers;    // USB transfers sent to this device
+    uint32_t usbPackets;      // MIDI packets in those transfers
+    uint32_t latencyMaxCycles;   // Worst read() to send() time into this device
+    uint32_t latencyTotalCycles; // For the average (wraps after ~7s of latency)
+    uint32_t latencySamples;
+};
+
+// Always-on routing statistics. Record functions are inline and cheap
+// enough to call from the routing hot path.
+class MidiStats {
+public:
+    MidiStats();
+
+    // Clear everything
+    void reset();
+
+    // Clear one slot (device connected or disconnected)
+    void resetSlot(int slot);
+
+    // A message was read from a source
+    void recordReceived(int srcSlot, uint32_t bytes, bool sysex) {
+        SlotStats& s = slots[srcSlot];
+        s.rxMessages++;
+        s.rxBytes += bytes;
+        if (sysex) s.sysexCount++;
+    }
+
+    // Messages read from a source in one routing pass (plus one if it
+    // still had more when the drain budget ran out)
+    void recordDrained(int srcSlot, uint32_t count) {
+        if (count > slots[srcSlot].maxDrained) slots[srcSlot].maxDrained = count;
+    }
+
+    // A message was read but had nowhere to go
+    void recordDropped(int srcSlot) {
+        slots[srcSlot].dropped++;
+    }
+
+    // A route filter blocked a message on at least one route
+    void recordFiltered(int srcSlot) {
+        slots[srcSlot].filtered++;
+    }
+
+    // Route thinning replaced a held controller value with a newer one
+    void recordThinned(int dstSlot) {
+        slots[dstSlot].thinned++;
+    }
+
+    // Packets for a destination didn't fit its output queue
+    void recordOutputDropped(int dstSlot, uint32_t packets = 1) {
+        slots[dstSlot].outputDropped += packets;
+    }
+
+    // A source wasn't read because this destination's queue was too full
+    void recordOutputHeld(int dstSlot) {
+        slots[dstSlot].outputHeld++;
+    }
+
+    // A SysEx message skipped a destination already streaming another
+    // source's SysEx
+    void recordSysExBlocked(int dstSlot) {
+        slots[dstSlot].sysexBlocked++;
+    }
+
+    // Packets queued for a destination after a routing pass
+    void recordOutputDepth(int dstSlot, uint32_t depth) {
+        if (depth > slots[dstSlot].outputMaxDepth) slots[dstSlot].outputMaxDepth = depth;
+    }
+
+    // A message was sent to a destination, latencyCycles after its read()
+    void recordForwarded(int srcSlot, int dstSlot, uint32_t bytes, uint32_t latencyCycles) {
+        SlotStats& d = slots[dstSlot];
+        d.txMessages++;
+        d.txBytes += bytes;
+        d.latencyTotalCycles += latencyCycles;
+        d.latencySamples++;
+        if (latencyCycles > d.latencyMaxCycles) d.latencyMaxCycles = latencyCycles;
+        routeMessages[srcSlot][dstSlot]++;
+    }
+
+    // A batch of packets went to a destination as one USB transfer
+    void recordTransfer(int dstSlot, uint32_t packets) {
+        SlotStats& d = slots[dstSlot];
+        d.usbTransfers++;
+        d.usbPackets += packets;
+    }
+
+    // A message generated by the hub (internal clock) was sent
+    void recordGenerated(int dstSlot, uint32_t bytes) {
+        SlotStats& d = slots[dstSlot];
+        d.txMessages++;
+        d.txBytes += bytes;
+    }
+
+    // An incoming clock tick was off the tracked period by this much
+    void recordClockIn(uint32_t deviationCycles) {
+        clockIn.record(deviationCycles);
+    }
+
+    // A regenerated clock tick went out this far from its schedule
+    void recordClockOut(uint32_t deviationCycles) {
+        clockOut.record(deviationCycles);
+    }
+
+    // A streamed SysEx message finished forwarding to a destination
+    // (no single read-to-send time, so latency isn't sampled)
+    void recordForwardedSysEx(int srcSlot, int dstSlot, uint32_t bytes) {
+        SlotStats& d = slots[dstSlot];
+        d.txMessages++;
+        d.txBytes += bytes;
+        routeMessages[srcSlot][dstSlot]++;
+    }
+
+    // One loop() iteration took this many cycles
+    void recordLoop(uint32_t loopCycles) {
+        uint32_t us = cyclesToMicros(loopCycles);
+        int bucket = 31 - __builtin_clz(us | 1);
+        if (bucket >= LOOP_HISTOGRAM_BUCKETS) bucket = LOOP_HISTOGRAM_BUCKETS - 1;
+        loopHistogram[bucket]++;
+        if (us > loopMaxMicros) loopMaxMicros = us;
+    }
+
+    const SlotStats& getSlot(int slot) const { return slots[slot]; }
+
+    // Messages forwarded from one slot to another
+    uint32_t getRouteMessages(int srcSlot, int dstSlot) const { return routeMessages[srcSlot][dstSlot]; }
+
+    uint32_t getLoopBucket(int bucket) const { return loopHistogram[bucket]; }
+    uint32_t getLoopMaxMicros() const { return loopMaxMicros; }
+
+    // Clock jitter (average and worst deviation, in us): ticks as they
+    // arrive, and as the clock engine sends them
+    uint32_t getClockInJitterAvgMicros() const { return cyclesToMicros(clockIn.average()); }
+    uint32_t getClockInJitterMaxMicros() const { return cyclesToMicros(clockIn.max); }
+    uint32_t getClockOutJitterAvgMicros() const { return cyclesToMicros(clockOut.average()); }
+    uint32_t getClockOutJitterMaxMicros() const { return cyclesToMicros(clockOut.max); }
+
+    // Average and worst read() to send() latency into a slot, in us
+    uint32_t getLatencyAvgMicros(int slot) const;
+    uint32_t getLatencyMaxMicros(int slot) const;
+
+    // Smallest loop time (us) that at least the given percent of loops beat
+    uint32_t getLoopPercentileMicros(int percent) const;
+
+    // Wire size of a MIDI message by type (as returned by getType())
+    static uint16_t messageLength(uint8_t type);
+
+    // Free-running CPU cycle counter used for all timing
+    static uint32_t cycles() {
+        return ARM_DWT_CYCCNT;
+    }
+
+    static uint32_t cyclesToMicros(uint32_t count) {
+        return count / (F_CPU_ACTUAL / 1000000);
+    }
+
+    // Print a full report
+    void print(Print& out) const;
+
+private:
+    struct Jitter {
+        uint32_t max;
+        uint32_t total;  // Wraps after ~7s of summed deviation
+        uint32_t samples;
+
+        void record(uint32_t deviation) {
+            if (deviation > max) max = deviation;
+            total += deviation;
+            samples++;
+        }
+        uint32_t average() const { return samples ? total / samples : 0; }
+    };
+
+    SlotStats slots[MAX_MIDI_DEVICES];
+    Jitter clockIn;
+    Jitter clockOut;
+    uint32_t routeMessages[MAX_MIDI_DEVICES][MAX_MIDI_DEVICES];
+    uint32_t loopHistogram[LOOP_HISTOGRAM_BUCKETS];
+    uint32_t loopMaxMicros;
+};
+
+#endif
@@ -5,12 +5,20 @@
 #include <Adafruit_SSD1306.h>
 #include <Fonts/FreeMonoBold9pt7b.h>
 #include "UIDriver.h"
+#include "TextStrip.h"
 
 // OLED UI driver implementation for 128x64 SSD1306
+//
+// Text is measured from the font's glyph advances. The selected row and
+// the toast are rendered once into TextStrips, so scrolling them is a
+// clipped copy into the frame buffer instead of a GFX text redraw.
 class OLEDUIDriver : public UIDriver {
 public:
-    OLEDUIDriver() : oled(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1), initialized(false),
-                     lastSelectedIndex(-1), scrollOffset(0), lastScrollTime(0), scrollPauseUntil(0),
+    OLEDUIDriver() : oled(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1, I2C_CLOCK, I2C_CLOCK),
+                     initialized(false), i2cAddress(I2C_ADDRESS_ALT),
+                     dirtyPages(0), nextChunk(0), panelWriteOffset(-1),
+                     stripRevision(0), stripIndex(-1),
+                     lastSelectedIndex(-1), selectedScrolls(false), scrollOffset(0), lastScrollTime(0), scrollPauseUntil(0),
                      lastToastMessage(nullptr), toastScrollOffset(0), toastScrollComplete(false),
                      lastToastScrollTime(0), toastScrollPauseUntil(0),
                      ballX(20), ballY(20), ballVx(1), ballVy(1), lastBallUpdate(0) {}
@@ -23,6 +31,7 @@ public:
             if (!oled.begin(SSD1306_SWITCHCAPVCC, I2C_ADDRESS)) {
                 return false;
             }
+            i2cAddress = I2C_ADDRESS;
         }
 
         initialized = true;
@@ -32,14 +41,60 @@ public:
         oled.setCursor(8, 36);
         oled.print("MIDI Hub");
         oled.display();
+        memcpy(panel, oled.getBuffer(), sizeof(panel));
         delay(500);
 
         return true;
     }
 
-    void beginFrame() override {
+    UIRect damageRect(uint8_t damage, const ListView& list) override {
+        if (damage & (DAMAGE_LIST | DAMAGE_SELECTION | DAMAGE_SCREENSAVER)) {
+            return UIRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+        }
+
+        UIRect region;
+        if (damage & DAMAGE_SCROLL) {
+            // Only the selected row moves
+            int row = list.selectedIndex - list.windowStart;
+            region.include(UIRect(0, row * ROW_HEIGHT, SCREEN_WIDTH, ROW_HEIGHT));
+        }
+        if (damage & DAMAGE_TOAST) {
+            // Full-width band (the box width depends on the message)
+            region.include(UIRect(0, TOAST_BOX_Y, SCREEN_WIDTH, TOAST_BOX_HEIGHT));
+        }
+        if (damage & DAMAGE_CONFIRM) {
+            int boxWidth = SCREEN_WIDTH * 80 / 100;
+            int boxHeight = SCREEN_HEIGHT * 80 / 100;
+            region.include(UIRect((SCREEN_WIDTH - boxWidth) / 2, (SCREEN_HEIGHT - boxHeight) / 2,
+                                  boxWidth, boxHeight));
+        }
+        return region;
+    }
+
+    uint8_t pendingDamage() override {
+        if (!initialized) return DAMAGE_NONE;
+
+        unsigned long now = millis();
+        uint8_t due = DAMAGE_NONE;
+        if (selectedScrolls && now >= scrollPauseUntil && now - lastScrollTime >= SCROLL_SPEED_MS) {
+            due |= DAMAGE_SCROLL;
+        }
+        if (lastToastMessage && !toastScrollComplete &&
+            now >= toastScrollPauseUntil && now - lastToastScrollTime >= TOAST_SCROLL_SPEED_MS) {
+            due |= DAMAGE_TOAST;
+        }
+        if (now - lastBallUpdate >= BALL_UPDATE_MS) {
+            due |= DAMAGE_SCREENSAVER;
+        }
+        return due;
+    }
+
+    void beginFrame(const UIRect& region) override {
         if (!initialized) return;
-        oled.clearDisplay();
+        // Pixels outside the region are left as-is; redrawing over them is a no-op
+        oled.fillRect(region.x, region.y, region.w, region.h, SSD1306_BLACK);
+        markDirty(region);
+        frameRegion = region;
     }
 
     void drawList(const ListView& list) override {
@@ -59,11 +114,10 @@ public:
             scrollOffset += SCROLL_STEP;
         }
 
-        // Calculate vertical scroll to keep selection visible
-        int viewStart = 0;
-        if (list.selectedIndex >= VISIBLE_ITEMS) {
-            viewStart = list.selectedIndex - VISIBLE_ITEMS + 1;
-        }
+        selectedScrolls = false;
+
+        // The list keeps its window scrolled to the selection
+        int viewStart = list.windowStart;
         int viewEnd = viewStart + VISIBLE_ITEMS;
         if (viewEnd > list.count) viewEnd = list.count;
 
@@ -75,7 +129,12 @@ public:
             int boxTop = rowIndex * ROW_HEIGHT;
             int y = boxTop + FONT_HEIGHT;  // Text baseline
 
-            const ListItem& item = list.items[i];
+            // Rows outside the damaged region are already on screen
+            if (boxTop + ROW_HEIGHT <= frameRegion.y || boxTop >= frameRegion.y + frameRegion.h) {
+                continue;
+            }
+
+            const ListItem& item = list.item(i);
             bool selected = (i == list.selectedIndex);
 
             // Selection highlight
@@ -86,24 +145,32 @@ public:
                 oled.setTextColor(SSD1306_WHITE);
             }
 
-            // Calculate total text width
-            int leftWidth = item.left ? strlen(item.left) * CHAR_WIDTH_APPROX : 0;
-            int centerWidth = item.center ? strlen(item.center) * CHAR_WIDTH_APPROX : 0;
-            int rightWidth = item.right ? strlen(item.right) * CHAR_WIDTH_APPROX : 0;
-
             // For items with left text only (typical list items)
             if (item.left && !item.center && !item.right) {
-                int textWidth = leftWidth;
-                if (selected && textWidth > SCREEN_WIDTH - 4) {
-                    // Scroll: calculate offset, wrap around
-                    int maxScroll = textWidth - SCREEN_WIDTH + 20;  // 20px padding at end
-                    int offset = scrollOffset % (maxScroll + SCROLL_RESET_PAUSE_PIXELS);
-                    if (offset > maxScroll) offset = 0;  // Pause at end
-                    oled.setCursor(LEFT_PADDING - offset, y);
+                if (selected) {
+                    // Rendered again only when the list or the selection changes
+                    if (stripIndex != i || stripRevision != list.revision) {
+                        selectedStrip.render(&FreeMonoBold9pt7b, item.left);
+                        stripIndex = i;
+                        stripRevision = list.revision;
+                    }
+
+                    int textWidth = selectedStrip.getWidth();
+                    int offset = 0;
+                    if (textWidth > SCREEN_WIDTH - 4) {
+                        selectedScrolls = true;
+                        // Scroll: calculate offset, wrap around
+                        int maxScroll = textWidth - SCREEN_WIDTH + 20;  // 20px padding at end
+                        offset = scrollOffset % (maxScroll + SCROLL_RESET_PAUSE_PIXELS);
+                        if (offset > maxScroll) offset = 0;  // Pause at end
+                    }
+                    selectedStrip.blit(oled.getBuffer(), SCREEN_WIDTH, PAGE_COUNT,
+                                       LEFT_PADDING - offset, y - TextStrip::BASELINE,
+                                       0, boxTop, SCREEN_WIDTH, ROW_HEIGHT, true);
                 } else {
                     oled.setCursor(LEFT_PADDING, y);
+                    oled.print(item.left);
                 }
-                oled.print(item.left);
             } else {
                 // Mixed layout (left + center + right)
                 if (item.left) {
@@ -112,6 +179,7 @@ public:
                 }
 
                 if (item.center) {
+                    int centerWidth = TextStrip::textWidth(&FreeMonoBold9pt7b, item.center);
                     int centerX = (SCREEN_WIDTH - centerWidth) / 2;
                     if (centerX < 2) centerX = 2;
                     oled.setCursor(centerX, y);
@@ -119,6 +187,7 @@ public:
                 }
 
                 if (item.right) {
+                    int rightWidth = TextStrip::textWidth(&FreeMonoBold9pt7b, item.right);
                     oled.setCursor(SCREEN_WIDTH - rightWidth - 2, y);
                     oled.print(item.right);
                 }
@@ -136,39 +205,35 @@ public:
         // Check if toast message changed
         if (message != lastToastMessage) {
             lastToastMessage = message;
+            toastStrip.render(&FreeMonoBold9pt7b, message);
             toastScrollOffset = 0;
             toastScrollComplete = false;
             toastScrollPauseUntil = millis() + TOAST_SCROLL_INITIAL_PAUSE;
             lastToastScrollTime = millis();
         }
 
-        oled.setFont(&FreeMonoBold9pt7b);
-        oled.setTextWrap(false);
-
         // Box is 95% of screen width max
         int maxBoxWidth = SCREEN_WIDTH * 95 / 100;
-        int textWidth = strlen(message) * CHAR_WIDTH_APPROX;
+        int textWidth = toastStrip.getWidth();
         int boxWidth = textWidth + 8;
         if (boxWidth > maxBoxWidth) boxWidth = maxBoxWidth;
 
-        int boxHeight = FONT_HEIGHT + 8;
+        int boxHeight = TOAST_BOX_HEIGHT;
         int boxX = (SCREEN_WIDTH - boxWidth) / 2;
-        int boxY = (SCREEN_HEIGHT - boxHeight) / 2;
+        int boxY = TOAST_BOX_Y;
         int innerWidth = boxWidth - 8;  // Text area width
 
         // Draw box background
         oled.fillRect(boxX, boxY, boxWidth, boxHeight, SSD1306_BLACK);
         oled.drawRect(boxX, boxY, boxWidth, boxHeight, SSD1306_WHITE);
 
-        // Draw message (with scrolling if needed)
-        oled.setTextColor(SSD1306_WHITE);
+        // Draw message (with scrolling if needed), clipped to the box
         int textY = boxY + FONT_HEIGHT + 2;
+        int textX;
 
         if (textWidth <= innerWidth) {
             // Text fits - center it
-            int textX = boxX + (boxWidth - textWidth) / 2;
-            oled.setCursor(textX, textY);
-            oled.print(message);
+            textX = boxX + (boxWidth - textWidth) / 2;
             toastScrollComplete = true;
         } else {
             // Text needs scrolling
@@ -184,19 +249,11 @@ public:
                 toastScrollComplete = true;
             }
 
-            // Draw text (may overflow box)
-            int textX = boxX + 4 - toastScrollOffset;
-            oled.setCursor(textX, textY);
-            oled.print(message);
-
-            // Clip by redrawing box edges to mask overflow
-            // Left edge
-            oled.fillRect(0, boxY, boxX + 1, boxHeight, SSD1306_BLACK);
-            // Right edge
-            oled.fillRect(boxX + boxWidth - 1, boxY, SCREEN_WIDTH - boxX - boxWidth + 1, boxHeight, SSD1306_BLACK);
-            // Redraw border
-            oled.drawRect(boxX, boxY, boxWidth, boxHeight, SSD1306_WHITE);
+            textX = boxX + 4 - toastScrollOffset;
         }
+        toastStrip.blit(oled.getBuffer(), SCREEN_WIDTH, PAGE_COUNT,
+                        textX, textY - TextStrip::BASELINE,
+                        boxX + 1, boxY + 1, boxWidth - 2, boxHeight - 2, false);
 
         return !toastScrollComplete;
     }
@@ -215,9 +272,9 @@ public:
         int boxX = (SCREEN_WIDTH - boxWidth) / 2;
         int boxY = (SCREEN_HEIGHT - boxHeight) / 2;
 
-        int qWidth = strlen(question) * CHAR_WIDTH_APPROX;
-        int yWidth = strlen(yesLabel) * CHAR_WIDTH_APPROX;
-        int nWidth = strlen(noLabel) * CHAR_WIDTH_APPROX;
+        int qWidth = TextStrip::textWidth(&FreeMonoBold9pt7b, question);
+        int yWidth = TextStrip::textWidth(&FreeMonoBold9pt7b, yesLabel);
+        int nWidth = TextStrip::textWidth(&FreeMonoBold9pt7b, noLabel);
 
         // Draw box background
         oled.fillRect(boxX, boxY, boxWidth, boxHeight, SSD1306_BLACK);
@@ -283,7 +340,7 @@ public:
         // Draw
         oled.clearDisplay();
         oled.fillRect(ballX, ballY, BALL_SIZE, BALL_SIZE, SSD1306_WHITE);
-        oled.display();
+        markDirty(UIRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT));
     }
 
     void resetScreensaver() {
@@ -305,16 +362,94 @@ public:
     }
 
     void endFrame() override {
-        if (!initialized) return;
-        oled.display();
+        // Damaged pages are transferred in slices by service() so routing
+        // isn't blocked
+    }
+
+    // Send the next changed chunk of the damaged pages, if any.
+    // Each call blocks for at most one TX_CHUNK_BYTES I2C transfer.
+    void service() override {
+        if (!initialized || !dirtyPages) return;
+
+        const uint8_t* buffer = oled.getBuffer();
+        for (int n = 0; n < CHUNK_COUNT; n++) {
+            int chunk = (nextChunk + n) % CHUNK_COUNT;
+            int offset = chunk * TX_CHUNK_BYTES;
+            if (!(dirtyPages & (1 << (offset / SCREEN_WIDTH)))) continue;
+            if (memcmp(buffer + offset, panel + offset, TX_CHUNK_BYTES) != 0) {
+                sendChunk(offset, buffer + offset);
+                nextChunk = (chunk + 1) % CHUNK_COUNT;
+                return;
+            }
+        }
+
+        // Panel matches the frame buffer
+        dirtyPages = 0;
+        nextChunk = 0;
     }
 
 private:
+    // Queue the SSD1306 pages (8-pixel rows) covering a region for transfer
+    void markDirty(const UIRect& region) {
+        if (region.isEmpty()) return;
+        int first = constrain(region.y / 8, 0, PAGE_COUNT - 1);
+        int last = constrain((region.y + region.h - 1) / 8, 0, PAGE_COUNT - 1);
+        for (int page = first; page <= last; page++) {
+            dirtyPages |= (uint8_t)(1 << page);
+        }
+    }
+
+    // Write one chunk of display RAM. The address window runs to the end of
+    // the panel, so consecutive chunks skip the address command.
+    void sendChunk(int offset, const uint8_t* data) {
+        if (offset != panelWriteOffset) {
+            Wire.beginTransmission(i2cAddress);
+            Wire.write((uint8_t)0x00);  // Command stream
+            Wire.write((uint8_t)SSD1306_COLUMNADDR);
+            Wire.write((uint8_t)(offset % SCREEN_WIDTH));
+            Wire.write((uint8_t)(SCREEN_WIDTH - 1));
+            Wire.write((uint8_t)SSD1306_PAGEADDR);
+            Wire.write((uint8_t)(offset / SCREEN_WIDTH));
+            Wire.write((uint8_t)(PAGE_COUNT - 1));
+            Wire.endTransmission();
+        }
+
+        Wire.beginTransmission(i2cAddress);
+        Wire.write((uint8_t)0x40);  // Data stream
+        Wire.write(data, TX_CHUNK_BYTES);
+        Wire.endTransmission();
+
+        memcpy(panel + offset, data, TX_CHUNK_BYTES);
+        panelWriteOffset = offset + TX_CHUNK_BYTES;
+        if (panelWriteOffset >= FRAME_BYTES) panelWriteOffset = -1;
+    }
+
     Adafruit_SSD1306 oled;
     bool initialized;
+    uint8_t i2cAddress;
+
+    // Sliced frame transfer state
+    static const int PAGE_COUNT = 64 / 8;
+    static const int FRAME_BYTES = 128 * PAGE_COUNT;
+    static const int TX_CHUNK_BYTES = 16;  // ~0.5ms per slice at 400kHz
+    static const int CHUNK_COUNT = FRAME_BYTES / TX_CHUNK_BYTES;
+    uint8_t panel[FRAME_BYTES];  // What the panel currently shows
+    uint8_t dirtyPages;  // Bit per page not yet confirmed on the panel
+    int nextChunk;
+    int panelWriteOffset;  // Where the panel's write pointer is, -1 if unknown
+
+    // Region being redrawn this frame
+    UIRect frameRegion;
+
+    // Pre-rendered text, re-rendered when the list, selection or toast changes
+    TextStrip selectedStrip;
+    uint16_t stripRevision;  // list.revision when selectedStrip was rendered
+    int stripIndex;          // Item selectedStrip holds, -1 if none
+    TextStrip toastStrip;
 
     // List item scroll state
     int lastSelectedIndex;
+    bool selectedScrolls;  // Selected row text is wider than the screen
     int scrollOffset;
     unsigned long lastScrollTime;
     unsigned long scrollPauseUntil;
@@ -337,10 +472,12 @@ private:
     static const int SCREEN_HEIGHT = 64;
     static const int I2C_ADDRESS = 0x3C;
     static const int I2C_ADDRESS_ALT = 0x3D;
+    static const uint32_t I2C_CLOCK = 400000;
     static const int FONT_HEIGHT = 13;  // FreeMonoBold9pt
-    static const int CHAR_WIDTH_APPROX = 11;  // Approximate char width for this font
     static const int ROW_HEIGHT = 16;   // 64px / 4 rows = 16px per row
     static const int LEFT_PADDING = 4;  // Padding for left-aligned text
+    static const int TOAST_BOX_HEIGHT = FONT_HEIGHT + 8;
+    static const int TOAST_BOX_Y = (SCREEN_HEIGHT - TOAST_BOX_HEIGHT) / 2;
 
     // Scroll settings
     static const int SCROLL_SPEED_MS = 25;       // ms between scroll steps
@@ -0,0 +1,222 @@
+#include "OutputQueue.h"
+
+OutputQueue::OutputQueue() {
+    clear();
+}
+
+void OutputQueue::clear() {
+    realtimeHead = 0;
+    realtimeCount = 0;
+
+    for (int i = 0; i < OUTPUT_QUEUE_PACKETS; i++) {
+        next[i] = (i + 1 < OUTPUT_QUEUE_PACKETS) ? (uint8_t)(i + 1) : NONE;
+    }
+    freeHead = 0;
+    used = 0;
+
+    for (int slot = 0; slot < MAX_MIDI_DEVICES; slot++) {
+        head[slot] = NONE;
+        tail[slot] = NONE;
+        count[slot] = 0;
+        sysexCount[slot] = 0;
+    }
+    sources = 0;
+    nextSource = 0;
+    openSource = -1;
+    openCable = 0;
+    sendingSource = -1;
+    sendingCable = 0;
+}
+
+OutputPush OutputQueue::push(int srcSlot, uint32_t packet, uint32_t readCycles, OutputDropPolicy policy) {
+    if (isRealtime(packet)) {
+        // Drained first every pass, so this only fills if the device has
+        // stopped taking data; keep the oldest clock
+        if (realtimeCount == OUTPUT_REALTIME_PACKETS) {
+            return OutputPush::DROPPED_NEWEST;
+        }
+        int i = (realtimeHead + realtimeCount) % OUTPUT_REALTIME_PACKETS;
+        realtimePackets[i] = packet;
+        realtimeCycles[i] = readCycles;
+        realtimeSource[i] = (int8_t)srcSlot;
+        realtimeCount++;
+        return OutputPush::QUEUED;
+    }
+
+    OutputPush result = OutputPush::QUEUED;
+    if (space() <= 0) {
+        if (policy != OutputDropPolicy::DROP_OLDEST || makeRoom(1) == 0) {
+            return OutputPush::DROPPED_NEWEST;
+        }
+        result = OutputPush::DROPPED_OLDEST;
+    }
+
+    uint8_t i = freeHead;
+    freeHead = next[i];
+    used++;
+
+    packets[i] = packet;
+    cycles[i] = readCycles;
+    next[i] = NONE;
+    if (tail[srcSlot] == NONE) {
+        head[srcSlot] = i;
+    } else {
+        next[tail[srcSlot]] = i;
+    }
+    tail[srcSlot] = i;
+    count[srcSlot]++;
+    if (isSysEx(packet)) sysexCount[srcSlot]++;
+    sources |= (SlotMask)(1u << srcSlot);
+    return result;
+}
+
+bool OutputQueue::pushRun(int srcSlot, const uint32_t* run, int length, uint8_t cable, uint32_t readCycles) {
+    if (length <= 0) return true;
+
+    // A run that leaves the message open must leave room to close it
+    bool ends = isSysExEnd(run[length - 1]);
+    int reserve = (ends || openSource == srcSlot) ? 0 : 1;
+    if (length + reserve > space()) return false;
+    uint32_t cableBits = (uint32_t)(cable & 0x0F) << 4;
+
+    // The free list is already a chain, so the run is taken off its front
+    // as is and appended to the source's FIFO
+    uint8_t first = freeHead;
+    uint8_t last = NONE;
+    for (int k = 0; k < length; k++) {
+        last = freeHead;
+        freeHead = next[last];
+        packets[last] = (run[k] & ~(uint32_t)0xF0) | cableBits;
+        cycles[last] = readCycles;
+    }
+    next[last] = NONE;
+    used += length;
+
+    if (tail[srcSlot] == NONE) {
+        head[srcSlot] = first;
+    } else {
+        next[tail[srcSlot]] = first;
+    }
+    tail[srcSlot] = last;
+    count[srcSlot] += length;
+    sysexCount[srcSlot] += length;
+    sources |= (SlotMask)(1u << srcSlot);
+
+    if (ends) {
+        if (openSource == srcSlot) openSource = -1;
+    } else {
+        openSource = (int8_t)srcSlot;
+        openCable = cable & 0x0F;
+    }
+    return true;
+}
+
+void OutputQueue::endSysEx(int srcSlot, uint32_t readCycles) {
+    if (srcSlot < 0 || openSource != srcSlot) return;
+
+    // Goes in the packet of room held back while the message was open
+    const uint8_t endByte = 0xF7;
+    uint32_t end = packSysExPacket(&endByte, 1, true, openCable);
+    openSource = -1;
+    pushRun(srcSlot, &end, 1, openCable, readCycles);
+}
+
+bool OutputQueue::hasOtherSysEx(int srcSlot) const {
+    for (SlotMask s = sources; s; s &= s - 1) {
+        int slot = __builtin_ctz(s);
+        if (slot != srcSlot && sysexCount[slot]) return true;
+    }
+    return false;
+}
+
+int OutputQueue::makeRoom(int needed) {
+    int dropped = 0;
+    while (space() < needed) {
+        // At the expense of whoever is using the most, but never into a
+        // SysEx message
+        int heaviest = -1;
+        for (SlotMask s = sources; s; s &= s - 1) {
+            int slot = __builtin_ctz(s);
+            if (!isSysEx(packets[head[slot]]) && (heaviest < 0 || count[slot] > count[heaviest])) {
+                heaviest = slot;
+            }
+        }
+        if (heaviest < 0) break;
+
+        uint8_t i = unlinkHead(heaviest);
+        next[i] = freeHead;
+        freeHead = i;
+        used--;
+        dropped++;
+    }
+    return dropped;
+}
+
+bool OutputQueue::pop(int& srcSlot, uint32_t& packet, uint32_t& readCycles) {
+    if (realtimeCount > 0) {
+        srcSlot = realtimeSource[realtimeHead];
+        packet = realtimePackets[realtimeHead];
+        readCycles = realtimeCycles[realtimeHead];
+        realtimeHead = (realtimeHead + 1) % OUTPUT_REALTIME_PACKETS;
+        realtimeCount--;
+        return true;
+    }
+
+    int slot = nextToSend();
+    if (slot < 0) return false;
+
+    uint8_t i = unlinkHead(slot);
+    srcSlot = slot;
+    packet = packets[i];
+    readCycles = cycles[i];
+
+    // A SysEx start or continuation keeps its cable until the end packet
+    if ((packet & 0x0F) == 0x04) {
+        sendingSource = (int8_t)slot;
+        sendingCable = (packet >> 4) & 0x0F;
+    } else if (slot == sendingSource && isSysExEnd(packet)) {
+        sendingSource = -1;
+    }
+
+    next[i] = freeHead;
+    freeHead = i;
+    used--;
+    return true;
+}
+
+int OutputQueue::nextToSend() {
+    if (!sources) return -1;
+
+    SlotMask eligible = sources;
+    if (sendingSource >= 0) {
+        if (head[sendingSource] != NONE) return sendingSource;
+
+        // The rest of that message isn't here yet; others may use the
+        // output, but not on its cable
+        for (SlotMask s = sources; s; s &= s - 1) {
+            int slot = __builtin_ctz(s);
+            if (((packets[head[slot]] >> 4) & 0x0F) == sendingCable) {
+                eligible &= (SlotMask)~(1u << slot);
+            }
+        }
+        if (!eligible) return -1;
+    }
+
+    // First source with packets at or after the round-robin position
+    SlotMask after = eligible & (SlotMask)~((1u << nextSource) - 1);
+    int slot = __builtin_ctz(after ? after : eligible);
+    nextSource = (slot + 1) % MAX_MIDI_DEVICES;
+    return slot;
+}
+
+uint8_t OutputQueue::unlinkHead(int srcSlot) {
+    uint8_t i = head[srcSlot];
+    head[srcSlot] = next[i];
+    if (head[srcSlot] == NONE) {
+        tail[srcSlot] = NONE;
+        sources &= (SlotMask)~(1u << srcSlot);
+    }
+    count[srcSlot]--;
+    if (isSysEx(packets[i])) sysexCount[srcSlot]--;
+    return i;
+}
@@ -0,0 +1,140 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <stdint.h>
+#include "Config.h"
+#include "DeviceManager.h"
+
+// What a destination does with traffic that doesn't fit its queue
+enum class OutputDropPolicy : uint8_t {
+    DROP_NEWEST,  // Discard the packet that doesn't fit
+    DROP_OLDEST,  // Discard the oldest message of the source with the most queued
+    HOLD_SOURCE   // Leave sources routed here unread until there's room
+};
+
+// Result of OutputQueue::push()
+enum class OutputPush : uint8_t {
+    QUEUED,
+    DROPPED_NEWEST,  // The pushed packet was discarded
+    DROPPED_OLDEST   // Queued, after discarding an older packet
+};
+
+// Outgoing USB-MIDI packets for one destination slot, merged from every
+// source routed to it.
+//
+// System realtime (clock, start, stop...) has its own queue, always sent
+// first, so a SysEx dump never delays clock. Everything else is kept per
+// source in a shared packet pool and sent one packet per source in turn,
+// so each source gets a fair share of the output whatever the others
+// are sending. Order within one source is kept.
+//
+// SysEx (CIN 4-7) is never cut into: runs are queued whole or not at all,
+// and making room only evicts single-packet messages, never a SysEx packet.
+// Once a message has started going out, its source keeps the output on
+// that cable until the message ends; only realtime is sent in between.
+// A message that is queued but not yet ended keeps one packet of room
+// back, so endSysEx() can always close it.
+class OutputQueue {
+public:
+    OutputQueue();
+
+    // Discard everything queued
+    void clear();
+
+    // Queue a packet from srcSlot, read at readCycles (for latency).
+    // Realtime generated by the hub itself has srcSlot -1.
+    OutputPush push(int srcSlot, uint32_t packet, uint32_t readCycles, OutputDropPolicy policy);
+
+    // Queue a run of SysEx packets from srcSlot (a stretch built once for
+    // every destination), moved onto cable. Returns false, queuing nothing,
+    // if the whole run doesn't fit.
+    bool pushRun(int srcSlot, const uint32_t* run, int length, uint8_t cable, uint32_t readCycles);
+
+    // Close srcSlot's unfinished SysEx message with an end packet (F7),
+    // in the room kept back for it. Does nothing if srcSlot has no
+    // message open here. (One source at a time has SysEx open: the router
+    // never starts a message on an output carrying another's.)
+    void endSysEx(int srcSlot, uint32_t readCycles);
+
+    // Discard the oldest message of the source with the most queued until
+    // needed packets fit, skipping sources whose oldest packet is SysEx.
+    // Returns the number discarded (space() may still be short).
+    int makeRoom(int needed);
+
+    // Next packet to send: realtime first, then round-robin over sources.
+    // Returns false if nothing is queued.
+    bool pop(int& srcSlot, uint32_t& packet, uint32_t& readCycles);
+
+    bool isEmpty() const { return realtimeCount == 0 && used == 0; }
+
+    // Packets queued (both queues)
+    int depth() const { return realtimeCount + used; }
+
+    // Non-realtime packets that can still be queued
+    int space() const { return OUTPUT_QUEUE_PACKETS - used - (openSource >= 0 ? 1 : 0); }
+
+    // Whether SysEx from a source other than srcSlot is still queued (a
+    // message from srcSlot started now would be interleaved with it)
+    bool hasOtherSysEx(int srcSlot) const;
+
+    // Single-byte system realtime packet (CIN 0xF, status 0xF8-0xFF)
+    static bool isRealtime(uint32_t packet) {
+        return (packet & 0x0F) == 0x0F && ((packet >> 8) & 0xFF) >= 0xF8;
+    }
+
+    // Part of a SysEx message (CIN 4 starts or continues, 5-7 end)
+    static bool isSysEx(uint32_t packet) {
+        uint8_t cin = packet & 0x0F;
+        return cin >= 0x04 && cin <= 0x07;
+    }
+
+    // Last packet of a SysEx message (CIN 5-7)
+    static bool isSysExEnd(uint32_t packet) {
+        uint8_t cin = packet & 0x0F;
+        return cin >= 0x05 && cin <= 0x07;
+    }
+
+private:
+    static const uint8_t NONE = 0xFF;
+    static_assert(OUTPUT_QUEUE_PACKETS < NONE, "OUTPUT_QUEUE_PACKETS must fit a uint8_t link");
+    static_assert(OUTPUT_REALTIME_PACKETS <= 255, "OUTPUT_REALTIME_PACKETS must fit a uint8_t");
+
+    // Realtime ring
+    uint32_t realtimePackets[OUTPUT_REALTIME_PACKETS];
+    uint32_t realtimeCycles[OUTPUT_REALTIME_PACKETS];
+    int8_t realtimeSource[OUTPUT_REALTIME_PACKETS];
+    uint8_t realtimeHead;
+    uint8_t realtimeCount;
+
+    // Packet pool, linked into one FIFO per source and a free list
+    uint32_t packets[OUTPUT_QUEUE_PACKETS];
+    uint32_t cycles[OUTPUT_QUEUE_PACKETS];
+    uint8_t next[OUTPUT_QUEUE_PACKETS];
+    uint8_t freeHead;
+    int used;
+
+    uint8_t head[MAX_MIDI_DEVICES];
+    uint8_t tail[MAX_MIDI_DEVICES];
+    uint8_t count[MAX_MIDI_DEVICES];
+    uint8_t sysexCount[MAX_MIDI_DEVICES];  // SysEx packets among them
+    SlotMask sources;  // Sources with packets queued
+    int nextSource;    // Round-robin position
+
+    // Source whose queued SysEx hasn't ended yet, and its cable (-1 if none)
+    int8_t openSource;
+    uint8_t openCable;
+
+    // Source whose SysEx is partway out, and its cable (-1 if none)
+    int8_t sendingSource;
+    uint8_t sendingCable;
+
+    // Unlink the oldest packet of a source, returning its pool index
+    uint8_t unlinkHead(int srcSlot);
+
+    // Source to send from next: the one partway through a SysEx while it
+    // has packets, else round-robin over sources not on that SysEx's
+    // cable. -1 if nothing can be sent.
+    int nextToSend();
+};
+
+#endif
@@ -1,8 +1,28 @@
 #include "QwiicTwistInput.h"
 #include <Wire.h>
 
+// Twist I2C address and registers
+static const uint8_t TWIST_ADDRESS = 0x3F;
+static const uint8_t REG_STATUS = 0x01;       // Status, version (2), interrupt enables, count (2)
+static const uint8_t REG_ENABLE_INTS = 0x04;
+static const uint8_t STATUS_BURST = 6;        // Status through count
+static const uint8_t STATUS_MOVED = 1 << 0;
+static const uint8_t STATUS_CLICKED = 1 << 2;
+static const uint8_t INTS_ENCODER_BUTTON = 0x03;
+
+// Most steps held for the UI at once (a fast spin past the end of a list
+// shouldn't keep scrolling long after the knob stops)
+static const int16_t MAX_PENDING_STEPS = 32;
+
+volatile bool QwiicTwistInput::interrupted = false;
+
 QwiicTwistInput::QwiicTwistInput()
-    : pendingEvent(InputEvent::NONE), lastCount(0), initialized(false) {
+    : pendingEvent(InputEvent::NONE), lastCount(0), pendingSteps(0), pendingClick(false),
+      lastMoveMs(0), initialized(false) {
+    for (int i = 0; i < 3; i++) {
+        ledColor[i] = 0;
+        nextColor[i] = 0;
+    }
 }
 
 bool QwiicTwistInput::begin() {
@@ -13,10 +33,22 @@ bool QwiicTwistInput::begin() {
     }
 
     initialized = true;
+
+    // Interrupt on clicks, and on turns once the knob pauses briefly
+    twist.setIntTimeout(TWIST_INT_TIMEOUT_MS);
+    writeRegister(REG_ENABLE_INTS, INTS_ENCODER_BUTTON);
+    writeRegister(REG_STATUS, 0);
     lastCount = twist.getCount();
 
+    if (TWIST_INT_PIN >= 0) {
+        // Open-drain, active low
+        pinMode(TWIST_INT_PIN, INPUT_PULLUP);
+        attachInterrupt(digitalPinToInterrupt(TWIST_INT_PIN), onInterrupt, FALLING);
+    }
+
     // Set initial color (dim blue to indicate ready)
-    twist.setColor(0, 0, 30);
+    setColor(0, 0, 30);
+    flushColor();
 
     return true;
 }
@@ -24,34 +56,32 @@ bool QwiicTwistInput::begin() {
 bool QwiicTwistInput::hasInput() {
     if (!initialized) return false;
 
+    flushColor();
+
     if (pendingEvent != InputEvent::NONE) {
         return true;
     }
 
-    // Check for button click (fires once on release, not while held)
-    if (twist.isClicked()) {
-        pendingEvent = InputEvent::ENTER;
-        return true;
+    if (isSignalled()) {
+        readStatus();
     }
 
-    // Check for rotation
-    int16_t currentCount = twist.getCount();
-    int16_t diff = currentCount - lastCount;
-
-    if (diff != 0) {
-        lastCount = currentCount;
-
-        if (diff > 0) {
-            // Clockwise = DOWN (next item in list)
-            pendingEvent = InputEvent::DOWN;
-        } else {
-            // Counter-clockwise = UP (previous item in list)
-            pendingEvent = InputEvent::UP;
-        }
-        return true;
+    // Turns first: the click that follows selects where they ended up
+    if (pendingSteps > 0) {
+        // Clockwise = DOWN (next item in list)
+        pendingSteps--;
+        pendingEvent = InputEvent::DOWN;
+    } else if (pendingSteps < 0) {
+        // Counter-clockwise = UP (previous item in list)
+        pendingSteps++;
+        pendingEvent = InputEvent::UP;
+    } else if (pendingClick) {
+        // Fires once on release, not while held
+        pendingClick = false;
+        pendingEvent = InputEvent::ENTER;
     }
 
-    return false;
+    return pendingEvent != InputEvent::NONE;
 }
 
 InputEvent QwiicTwistInput::getInput() {
@@ -61,7 +91,94 @@ InputEvent QwiicTwistInput::getInput() {
 }
 
 void QwiicTwistInput::setColor(uint8_t r, uint8_t g, uint8_t b) {
-    if (initialized) {
-        twist.setColor(r, g, b);
+    nextColor[0] = r;
+    nextColor[1] = g;
+    nextColor[2] = b;
+}
+
+void QwiicTwistInput::onInterrupt() {
+    interrupted = true;
+}
+
+bool QwiicTwistInput::isSignalled() {
+    if (TWIST_INT_PIN < 0) return true;
+
+    // The line stays low until the status is cleared, so the level also
+    // covers an edge missed before the interrupt was attached
+    noInterrupts();
+    bool signalled = interrupted;
+    interrupted = false;
+    interrupts();
+    return signalled || digitalRead(TWIST_INT_PIN) == 0;
+}
+
+bool QwiicTwistInput::readStatus() {
+    Wire.beginTransmission(TWIST_ADDRESS);
+    Wire.write(REG_STATUS);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom(TWIST_ADDRESS, STATUS_BURST) != STATUS_BURST) return false;
+
+    uint8_t data[STATUS_BURST];
+    for (int i = 0; i < STATUS_BURST; i++) {
+        data[i] = (uint8_t)Wire.read();
+    }
+    uint8_t status = data[0];
+    int16_t count = (int16_t)(data[4] | (data[5] << 8));
+
+    // Clearing the status releases the INT line
+    if (status & (STATUS_MOVED | STATUS_CLICKED)) {
+        writeRegister(REG_STATUS, 0);
+    }
+
+    if (status & STATUS_CLICKED) {
+        pendingClick = true;
+    }
+
+    int16_t diff = count - lastCount;
+    lastCount = count;
+    if (diff != 0) {
+        addTurn(diff);
+    }
+    return true;
+}
+
+void QwiicTwistInput::addTurn(int16_t detents) {
+    // Speed over the time since the previous turn; each TWIST_ACCEL_RATE
+    // detents per second adds one step per detent
+    unsigned long now = millis();
+    unsigned long elapsed = now - lastMoveMs;
+    lastMoveMs = now;
+    if (elapsed == 0) elapsed = 1;
+
+    int magnitude = detents < 0 ? -detents : detents;
+    unsigned long rate = (unsigned long)magnitude * 1000 / elapsed;
+    int scale = 1 + (int)(rate / TWIST_ACCEL_RATE);
+    if (scale > TWIST_ACCEL_MAX) scale = TWIST_ACCEL_MAX;
+
+    // Turning back drops whatever was left of the other direction
+    if ((detents > 0) != (pendingSteps > 0)) {
+        pendingSteps = 0;
+    }
+    int steps = pendingSteps + detents * scale;
+    if (steps > MAX_PENDING_STEPS) steps = MAX_PENDING_STEPS;
+    if (steps < -MAX_PENDING_STEPS) steps = -MAX_PENDING_STEPS;
+    pendingSteps = (int16_t)steps;
+}
+
+bool QwiicTwistInput::writeRegister(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(TWIST_ADDRESS);
+    Wire.write(reg);
+    Wire.write(value);
+    return Wire.endTransmission() == 0;
+}
+
+void QwiicTwistInput::flushColor() {
+    if (nextColor[0] == ledColor[0] && nextColor[1] == ledColor[1] && nextColor[2] == ledColor[2]) {
+        return;
+    }
+
+    twist.setColor(nextColor[0], nextColor[1], nextColor[2]);
+    for (int i = 0; i < 3; i++) {
+        ledColor[i] = nextColor[i];
     }
 }
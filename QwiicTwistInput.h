@@ -2,12 +2,18 @@
 #define QWIIC_TWIST_INPUT_H
 
 #include "Input.h"
+#include "Config.h"
 #include <SparkFun_Qwiic_Twist_Arduino_Library.h>
 
 // Qwiic Twist rotary encoder input implementation
 // - Rotate clockwise = DOWN (next item)
 // - Rotate counter-clockwise = UP (previous item)
 // - Press button = ENTER (select)
+//
+// The Twist pulls its INT line low on a click or turn; only then are the
+// status and count registers read, in one I2C burst. Fast turns move
+// several items per detent. With TWIST_INT_PIN < 0 the burst is read on
+// every poll instead.
 class QwiicTwistInput : public Input {
 public:
     QwiicTwistInput();
@@ -16,14 +22,34 @@ public:
     bool hasInput() override;
     InputEvent getInput() override;
 
-    // Set LED color (0-255 for each component)
-    void setColor(uint8_t r, uint8_t g, uint8_t b);
+    // Set LED color (0-255 for each component). Written on the next poll,
+    // and only if it differs from what the LED already shows.
+    void setColor(uint8_t r, uint8_t g, uint8_t b) override;
 
 private:
     TWIST twist;
     InputEvent pendingEvent;
     int16_t lastCount;
+    int16_t pendingSteps;    // Accelerated steps not yet returned (+ = DOWN)
+    bool pendingClick;
+    unsigned long lastMoveMs;
+    uint8_t ledColor[3];     // Last written to the LED
+    uint8_t nextColor[3];    // Requested, written on the next poll
     bool initialized;
+
+    static volatile bool interrupted;
+    static void onInterrupt();
+
+    // Whether the Twist has something to report
+    bool isSignalled();
+
+    // Read status and count in one burst, clear the status, and take up
+    // the click and turn. Returns false on an I2C error.
+    bool readStatus();
+
+    void addTurn(int16_t detents);
+    bool writeRegister(uint8_t reg, uint8_t value);
+    void flushColor();
 };
 
 #endif
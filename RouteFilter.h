@@ -0,0 +1,66 @@
+#ifndef ROUTE_FILTER_H
+#define ROUTE_FILTER_H
+
+#include <stdint.h>
+
+// Message type bits for RouteFilter::typeMask
+enum FilterType : uint16_t {
+    FILTER_NOTE_OFF         = 1 << 0,
+    FILTER_NOTE_ON          = 1 << 1,
+    FILTER_POLY_PRESSURE    = 1 << 2,
+    FILTER_CONTROL_CHANGE   = 1 << 3,
+    FILTER_PROGRAM_CHANGE   = 1 << 4,
+    FILTER_CHANNEL_PRESSURE = 1 << 5,
+    FILTER_PITCH_BEND       = 1 << 6,
+    FILTER_SYSEX            = 1 << 7,
+    FILTER_SYSTEM_COMMON    = 1 << 8,   // Time code, song position/select, tune request
+    FILTER_CLOCK            = 1 << 9,   // 0xF8
+    FILTER_TRANSPORT        = 1 << 10,  // Start, continue, stop
+    FILTER_ACTIVE_SENSING   = 1 << 11,  // 0xFE
+    FILTER_SYSTEM_RESET     = 1 << 12,  // 0xFF
+    FILTER_ALL_TYPES        = 0x1FFF
+};
+
+// Types whose data1 is a note or controller number (checked against the range)
+const uint16_t FILTER_RANGE_TYPES = FILTER_NOTE_OFF | FILTER_NOTE_ON |
+                                    FILTER_POLY_PRESSURE | FILTER_CONTROL_CHANGE;
+
+// Per-route message filter. The default passes everything.
+struct RouteFilter {
+    uint16_t channelMask;  // Bit N passes channel N+1
+    uint16_t typeMask;     // FilterType bits that pass
+    uint8_t rangeLow;      // Note/CC number range that passes (inclusive)
+    uint8_t rangeHigh;
+
+    RouteFilter() : channelMask(0xFFFF), typeMask(FILTER_ALL_TYPES), rangeLow(0), rangeHigh(127) {}
+
+    bool passesAll() const {
+        return channelMask == 0xFFFF && typeMask == FILTER_ALL_TYPES &&
+               rangeLow == 0 && rangeHigh >= 127;
+    }
+
+    // FilterType bit for a message type as returned by MIDIDevice::getType()
+    static uint16_t typeBit(uint8_t type) {
+        static const uint16_t systemBits[16] = {
+            FILTER_SYSEX,          FILTER_SYSTEM_COMMON, FILTER_SYSTEM_COMMON, FILTER_SYSTEM_COMMON,
+            0,                     0,                    FILTER_SYSTEM_COMMON, FILTER_SYSEX,
+            FILTER_CLOCK,          0,                    FILTER_TRANSPORT,     FILTER_TRANSPORT,
+            FILTER_TRANSPORT,      0,                    FILTER_ACTIVE_SENSING, FILTER_SYSTEM_RESET
+        };
+        if (type >= 0xF0) return systemBits[type & 0x0F];
+        return (uint16_t)(1 << ((type >> 4) & 0x07));
+    }
+
+    // Check a message (channel is 1-16, ignored for system messages)
+    bool passes(uint8_t type, uint8_t channel, uint8_t data1) const {
+        uint16_t bit = typeBit(type);
+        if (!(typeMask & bit)) return false;
+        if (type >= 0xF0) return true;
+        if (!(channelMask & (1 << ((channel - 1) & 0x0F)))) return false;
+        // Unsigned compare covers both ends of the range
+        return !(bit & FILTER_RANGE_TYPES) ||
+               (uint8_t)(data1 - rangeLow) <= (uint8_t)(rangeHigh - rangeLow);
+    }
+};
+
+#endif
@@ -1,142 +1,92 @@
 #include "RouteManager.h"
-#include <EEPROM.h>
+#include "DeviceManager.h"
 #include <string.h>
 
-// EEPROM layout:
-// [0-1]: Magic bytes (EEPROM_MAGIC)
-// [2]:   Version
-// [3]:   Route count
-// [4+]:  Routes (56 bytes each: srcVid, srcPid, dstVid, dstPid, srcName[24], dstName[24])
-
-const int ROUTE_SIZE = 8 + 24 + 24;  // VID:PID pairs + names
-
-RouteManager::RouteManager() : routeCount(0) {
+RouteManager::RouteManager()
+    : routeCount(0), pendingSave(SAVE_NONE), pendingIndex(0), deviceManager(nullptr), connectedCount(0) {
     for (int i = 0; i < MAX_ROUTES; i++) {
         routes[i].active = false;
         routes[i].sourceName[0] = '\0';
         routes[i].destName[0] = '\0';
     }
+    memset(destMask, 0, sizeof(destMask));
+    memset(filteredMask, 0, sizeof(filteredMask));
+    memset(remapMask, 0, sizeof(remapMask));
+    memset(thinnedMask, 0, sizeof(thinnedMask));
+    memset(transformedMask, 0, sizeof(transformedMask));
+    memset(sourceDests, 0, sizeof(sourceDests));
+    memset(routeVelocityTable, -1, sizeof(routeVelocityTable));
+    memset(connectedRoutes, 0, sizeof(connectedRoutes));
 }
 
 void RouteManager::load() {
-    // Check magic bytes
-    uint16_t magic = EEPROM.read(EEPROM_START_ADDR) | (EEPROM.read(EEPROM_START_ADDR + 1) << 8);
-    if (magic != EEPROM_MAGIC) {
-        // No valid data, start fresh
-        routeCount = 0;
-        return;
-    }
-
-    // Check version
-    uint8_t version = EEPROM.read(EEPROM_START_ADDR + 2);
-    if (version != EEPROM_VERSION) {
-        // Incompatible version, start fresh
-        routeCount = 0;
-        return;
-    }
-
-    // Read route count
-    routeCount = EEPROM.read(EEPROM_START_ADDR + 3);
-    if (routeCount > MAX_ROUTES) {
-        routeCount = 0;
-        return;
-    }
-
-    // Read routes
-    int addr = EEPROM_START_ADDR + 4;
-    for (int i = 0; i < routeCount; i++) {
-        routes[i].sourceVid = EEPROM.read(addr) | (EEPROM.read(addr + 1) << 8);
-        routes[i].sourcePid = EEPROM.read(addr + 2) | (EEPROM.read(addr + 3) << 8);
-        routes[i].destVid = EEPROM.read(addr + 4) | (EEPROM.read(addr + 5) << 8);
-        routes[i].destPid = EEPROM.read(addr + 6) | (EEPROM.read(addr + 7) << 8);
-
-        // Read source name
-        for (int j = 0; j < 24; j++) {
-            routes[i].sourceName[j] = EEPROM.read(addr + 8 + j);
-        }
-        routes[i].sourceName[23] = '\0';
-
-        // Read dest name
-        for (int j = 0; j < 24; j++) {
-            routes[i].destName[j] = EEPROM.read(addr + 32 + j);
-        }
-        routes[i].destName[23] = '\0';
-
-        routes[i].active = true;
-        addr += ROUTE_SIZE;
-    }
+    routeCount = store.load(routes, MAX_ROUTES);
+    rebuildIndex();
+    rebuildRouteTable();
 }
 
 void RouteManager::save() {
-    // Write magic bytes
-    EEPROM.write(EEPROM_START_ADDR, EEPROM_MAGIC & 0xFF);
-    EEPROM.write(EEPROM_START_ADDR + 1, (EEPROM_MAGIC >> 8) & 0xFF);
-
-    // Write version
-    EEPROM.write(EEPROM_START_ADDR + 2, EEPROM_VERSION);
-
-    // Write route count
-    EEPROM.write(EEPROM_START_ADDR + 3, routeCount);
-
-    // Write routes
-    int addr = EEPROM_START_ADDR + 4;
-    for (int i = 0; i < routeCount; i++) {
-        EEPROM.write(addr, routes[i].sourceVid & 0xFF);
-        EEPROM.write(addr + 1, (routes[i].sourceVid >> 8) & 0xFF);
-        EEPROM.write(addr + 2, routes[i].sourcePid & 0xFF);
-        EEPROM.write(addr + 3, (routes[i].sourcePid >> 8) & 0xFF);
-        EEPROM.write(addr + 4, routes[i].destVid & 0xFF);
-        EEPROM.write(addr + 5, (routes[i].destVid >> 8) & 0xFF);
-        EEPROM.write(addr + 6, routes[i].destPid & 0xFF);
-        EEPROM.write(addr + 7, (routes[i].destPid >> 8) & 0xFF);
-
-        // Write source name
-        for (int j = 0; j < 24; j++) {
-            EEPROM.write(addr + 8 + j, routes[i].sourceName[j]);
-        }
+    store.writeSnapshot(routes, routeCount);
+}
 
-        // Write dest name
-        for (int j = 0; j < 24; j++) {
-            EEPROM.write(addr + 32 + j, routes[i].destName[j]);
-        }
+void RouteManager::savePending() {
+    switch (pendingSave) {
+        case SAVE_PUT:    store.putRoute(pendingRoute, pendingIndex, routes, routeCount); break;
+        case SAVE_REMOVE: store.removeRoute(pendingRoute, pendingIndex, routes, routeCount); break;
+        case SAVE_ALL:    save(); break;
+        case SAVE_NONE:   break;
+    }
+    pendingSave = SAVE_NONE;
+}
 
-        addr += ROUTE_SIZE;
+void RouteManager::queueSave(PendingSave type, const Route& route, int index) {
+    if (pendingSave != SAVE_NONE) {
+        pendingSave = SAVE_ALL;
+        return;
     }
+    pendingSave = type;
+    pendingRoute = route;
+    pendingIndex = index;
 }
 
-bool RouteManager::addRoute(uint16_t srcVid, uint16_t srcPid, const char* srcName,
-                            uint16_t dstVid, uint16_t dstPid, const char* dstName) {
-    // Check if already exists
-    if (findRoute(srcVid, srcPid, dstVid, dstPid) >= 0) {
+bool RouteManager::addRoute(const Route& route) {
+    // Check if already exists, with this or another dest cable (those sort
+    // together, from dest cable 0)
+    RouteKey key(route);
+    RouteKey link = key;
+    link.cables &= 0xFF00;
+    int linkPos = lowerBound(link);
+    if (linkPos < routeCount && RouteKey(routes[sortedIndex[linkPos]]).sameLink(key)) {
         return false;
     }
+    int pos = lowerBound(key);
 
     // Check if full
-    if (routeCount >= MAX_ROUTES) {
+    if (routeCount >= getCapacity()) {
         return false;
     }
 
     // Add new route
-    routes[routeCount].sourceVid = srcVid;
-    routes[routeCount].sourcePid = srcPid;
-    routes[routeCount].destVid = dstVid;
-    routes[routeCount].destPid = dstPid;
-
-    strncpy(routes[routeCount].sourceName, srcName, sizeof(routes[routeCount].sourceName) - 1);
-    routes[routeCount].sourceName[sizeof(routes[routeCount].sourceName) - 1] = '\0';
-
-    strncpy(routes[routeCount].destName, dstName, sizeof(routes[routeCount].destName) - 1);
-    routes[routeCount].destName[sizeof(routes[routeCount].destName) - 1] = '\0';
-
-    routes[routeCount].active = true;
+    Route& added = routes[routeCount];
+    added = route;
+    added.sourceName[sizeof(added.sourceName) - 1] = '\0';
+    added.destName[sizeof(added.destName) - 1] = '\0';
+    added.filter = RouteFilter();
+    added.thin = RouteThin();
+    added.transform = RouteTransform();
+    added.active = true;
+
+    memmove(&sortedIndex[pos + 1], &sortedIndex[pos], (routeCount - pos) * sizeof(sortedIndex[0]));
+    sortedIndex[pos] = routeCount;
     routeCount++;
 
-    save();
+    queueSave(SAVE_PUT, added, routeCount - 1);
+    rebuildRouteTable();
     return true;
 }
 
-bool RouteManager::removeRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) {
-    int index = findRoute(srcVid, srcPid, dstVid, dstPid);
+bool RouteManager::removeRoute(const Route& route) {
+    int index = findRoute(RouteKey(route));
     if (index < 0) {
         return false;
     }
@@ -148,6 +98,15 @@ bool RouteManager::removeRouteByIndex(int index) {
         return false;
     }
 
+    Route removed = routes[index];
+
+    // Drop it from the index and renumber the routes that shift down
+    int pos = lowerBound(RouteKey(removed));
+    memmove(&sortedIndex[pos], &sortedIndex[pos + 1], (routeCount - pos - 1) * sizeof(sortedIndex[0]));
+    for (int i = 0; i < routeCount - 1; i++) {
+        if (sortedIndex[i] > index) sortedIndex[i]--;
+    }
+
     // Shift remaining routes down
     for (int i = index; i < routeCount - 1; i++) {
         routes[i] = routes[i + 1];
@@ -155,20 +114,49 @@ bool RouteManager::removeRouteByIndex(int index) {
     routes[routeCount - 1].active = false;
     routeCount--;
 
-    save();
+    queueSave(SAVE_REMOVE, removed, index);
+    rebuildRouteTable();
     return true;
 }
 
-bool RouteManager::hasRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) const {
-    return findRoute(srcVid, srcPid, dstVid, dstPid) >= 0;
+bool RouteManager::hasRoute(const Route& route) const {
+    return findRoute(RouteKey(route)) >= 0;
 }
 
-bool RouteManager::shouldRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) const {
-    // If no routes configured, don't route anything (explicit routing only)
-    if (routeCount == 0) {
+bool RouteManager::setRouteFilter(int index, const RouteFilter& filter) {
+    if (index < 0 || index >= routeCount) {
         return false;
     }
-    return hasRoute(srcVid, srcPid, dstVid, dstPid);
+
+    routes[index].filter = filter;
+
+    queueSave(SAVE_PUT, routes[index], index);
+    rebuildRouteTable();
+    return true;
+}
+
+bool RouteManager::setRouteThin(int index, const RouteThin& thin) {
+    if (index < 0 || index >= routeCount) {
+        return false;
+    }
+
+    routes[index].thin = thin;
+
+    queueSave(SAVE_PUT, routes[index], index);
+    rebuildRouteTable();
+    return true;
+}
+
+bool RouteManager::setRouteTransform(int index, const RouteTransform& transform) {
+    if (index < 0 || index >= routeCount) {
+        return false;
+    }
+
+    routes[index].transform = transform;
+
+    queueSave(SAVE_PUT, routes[index], index);
+    rebuildRouteTable();
+    return true;
 }
 
 const Route* RouteManager::getRoute(int index) const {
@@ -182,20 +170,155 @@ int RouteManager::getRouteCount() const {
     return routeCount;
 }
 
+int RouteManager::getSavedCapacity() const {
+    int persisted = store.capacity();
+    return persisted < MAX_ROUTES ? persisted : MAX_ROUTES;
+}
+
 void RouteManager::clearAll() {
     routeCount = 0;
     for (int i = 0; i < MAX_ROUTES; i++) {
         routes[i].active = false;
     }
-    save();
+    pendingSave = SAVE_ALL;
+    rebuildRouteTable();
 }
 
-int RouteManager::findRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) const {
-    for (int i = 0; i < routeCount; i++) {
-        if (routes[i].sourceVid == srcVid && routes[i].sourcePid == srcPid &&
-            routes[i].destVid == dstVid && routes[i].destPid == dstPid) {
-            return i;
+void RouteManager::rebuildRouteTable() {
+    memset(destMask, 0, sizeof(destMask));
+    memset(filteredMask, 0, sizeof(filteredMask));
+    memset(remapMask, 0, sizeof(remapMask));
+    memset(thinnedMask, 0, sizeof(thinnedMask));
+    memset(transformedMask, 0, sizeof(transformedMask));
+    memset(sourceDests, 0, sizeof(sourceDests));
+    memset(connectedRoutes, 0, sizeof(connectedRoutes));
+    connectedCount = 0;
+    buildVelocityTables();
+    if (!deviceManager) return;
+
+    // Resolve each route's device identities to connected slots through the
+    // device manager's identity cache. Untagged routes match every device
+    // with the VID:PID; destinations must take output. Any-cable routes go
+    // first so cable-specific ones override them.
+    SlotMask outputSlots = deviceManager->getOutputSlots();
+    for (int pass = 0; pass < 2; pass++) {
+        for (int r = 0; r < routeCount; r++) {
+            const Route& route = routes[r];
+            if ((route.sourceCable == CABLE_ANY) != (pass == 0)) continue;
+
+            SlotMask srcSlots = deviceManager->findSlots(route.sourceVid, route.sourcePid, route.sourceTag);
+            SlotMask dstSlots = deviceManager->findSlots(route.destVid, route.destPid, route.destTag) & outputSlots;
+            if (srcSlots && dstSlots) {
+                compileRoute(r, srcSlots, dstSlots);
+                connectedRoutes[r >> 5] |= 1u << (r & 31);
+                connectedCount++;
+            }
+        }
+    }
+}
+
+void RouteManager::compileRoute(int index, SlotMask srcSlots, SlotMask dstSlots) {
+    const Route& route = routes[index];
+    int firstCable = (route.sourceCable == CABLE_ANY) ? 0 : route.sourceCable;
+    int lastCable = (route.sourceCable == CABLE_ANY) ? MIDI_CABLES - 1 : route.sourceCable;
+
+    for (SlotMask s = srcSlots; s; s &= s - 1) {
+        int srcSlot = __builtin_ctz(s);
+
+        // Never route a device back to itself
+        SlotMask dests = dstSlots & (SlotMask)~(1u << srcSlot);
+        if (!dests) continue;
+        sourceDests[srcSlot] |= dests;
+
+        for (int cable = firstCable; cable <= lastCable; cable++) {
+            destMask[srcSlot][cable] |= dests;
+            for (SlotMask d = dests; d; d &= d - 1) {
+                linkRoute[srcSlot][cable][__builtin_ctz(d)] = (uint16_t)index;
+            }
+
+            // Only filtered, thinned, transformed and remapped links are
+            // looked at per message
+            if (route.filter.passesAll()) {
+                filteredMask[srcSlot][cable] &= ~dests;
+            } else {
+                filteredMask[srcSlot][cable] |= dests;
+            }
+            if (route.thin.isActive()) {
+                thinnedMask[srcSlot][cable] |= dests;
+            } else {
+                thinnedMask[srcSlot][cable] &= ~dests;
+            }
+            if (route.transform.isIdentity()) {
+                transformedMask[srcSlot][cable] &= ~dests;
+            } else {
+                transformedMask[srcSlot][cable] |= dests;
+            }
+            if (route.destCable == CABLE_ANY || route.destCable == cable) {
+                remapMask[srcSlot][cable] &= ~dests;
+            } else {
+                remapMask[srcSlot][cable] |= dests;
+            }
         }
     }
+}
+
+void RouteManager::buildVelocityTables() {
+    // Curve parameters of each table built so far
+    uint8_t curves[VELOCITY_TABLES];
+    uint8_t amounts[VELOCITY_TABLES];
+    int tables = 0;
+
+    for (int r = 0; r < routeCount; r++) {
+        const RouteTransform& transform = routes[r].transform;
+        routeVelocityTable[r] = -1;
+        if (!transform.hasCurve()) continue;
+
+        int t = 0;
+        while (t < tables && (curves[t] != transform.velocityCurve || amounts[t] != transform.velocityAmount)) {
+            t++;
+        }
+        if (t == tables) {
+            if (tables == VELOCITY_TABLES) continue;  // Computed per note instead
+            curves[t] = transform.velocityCurve;
+            amounts[t] = transform.velocityAmount;
+            transform.buildVelocityTable(velocityTables[t]);
+            tables++;
+        }
+        routeVelocityTable[r] = (int8_t)t;
+    }
+}
+
+int RouteManager::findRoute(const RouteKey& key) const {
+    int pos = lowerBound(key);
+    if (pos < routeCount && RouteKey(routes[sortedIndex[pos]]) == key) {
+        return sortedIndex[pos];
+    }
     return -1;
 }
+
+int RouteManager::lowerBound(const RouteKey& key) const {
+    int low = 0;
+    int high = routeCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (RouteKey(routes[sortedIndex[mid]]) < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void RouteManager::rebuildIndex() {
+    // Insertion sort: only runs at load, and the store never holds duplicates
+    for (int i = 0; i < routeCount; i++) {
+        RouteKey key(routes[i]);
+        int pos = i;
+        while (pos > 0 && key < RouteKey(routes[sortedIndex[pos - 1]])) {
+            sortedIndex[pos] = sortedIndex[pos - 1];
+            pos--;
+        }
+        sortedIndex[pos] = i;
+    }
+}
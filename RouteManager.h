@@ -3,44 +3,171 @@
 
 #include <stdint.h>
 #include "Config.h"
+#include "RouteFilter.h"
+#include "RouteThin.h"
+#include "RouteTransform.h"
+#include "RouteStore.h"
+#include "DeviceManager.h"
 
-// A stored route between two devices (identified by VID:PID)
+// USB-MIDI virtual cables (ports) per device
+const int MIDI_CABLES = 16;
+
+// Route cable wildcard: any source cable / keep the source's cable on output
+const uint8_t CABLE_ANY = 0xFF;
+
+// A stored route between two devices, optionally narrowed to one source
+// cable and remapped onto one destination cable. Devices are identified by
+// VID:PID plus a device tag (serial number or port) for duplicates.
 struct Route {
     uint16_t sourceVid;
     uint16_t sourcePid;
     uint16_t destVid;
     uint16_t destPid;
+    uint32_t sourceTag;   // DEVICE_TAG_* (DEVICE_TAG_ANY matches every duplicate)
+    uint32_t destTag;
+    uint8_t sourceCable;  // 0-15 or CABLE_ANY
+    uint8_t destCable;    // 0-15 or CABLE_ANY (same as source)
     char sourceName[24];
     char destName[24];
+    RouteFilter filter;
+    RouteThin thin;
+    RouteTransform transform;
     bool active;
 };
 
-// Manages MIDI routes and persists them to EEPROM
+// Manages MIDI routes and persists them to EEPROM (via RouteStore)
 class RouteManager {
 public:
     RouteManager();
 
-    // Load routes from EEPROM
+    // Device manager used to resolve routes to slots (for the route table)
+    void setDeviceManager(const DeviceManager* dm) { deviceManager = dm; }
+
+    // Load routes from EEPROM (routes converted from an older layout past
+    // getSavedCapacity() stay RAM-only, see isRouteSaved())
     void load();
 
-    // Save routes to EEPROM
+    // Save all routes to EEPROM as a fresh snapshot (single changes are
+    // journaled by savePending())
     void save();
 
-    // Add a route (returns true if added, false if already exists or full)
-    bool addRoute(uint16_t srcVid, uint16_t srcPid, const char* srcName,
-                  uint16_t dstVid, uint16_t dstPid, const char* dstName);
+    // Write the route changes made since the last call to EEPROM. Changes
+    // are made under the router lock; EEPROM writes can take milliseconds,
+    // so they wait for this call, made after unlocking.
+    void savePending();
+
+    // Most routes that can be added (MAX_ROUTES)
+    int getCapacity() const { return MAX_ROUTES; }
 
-    // Remove a route (returns true if found and removed)
-    bool removeRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid);
+    // Most routes the EEPROM journal can persist (known after load()).
+    // Routes are saved in menu order; the rest live in RAM only until
+    // earlier routes are removed.
+    int getSavedCapacity() const;
+
+    // Whether the route at index is saved to EEPROM
+    bool isRouteSaved(int index) const { return store.isPersisted(index); }
+
+    // Add a route: devices, tags, cables and names are taken from route,
+    // the filter starts open, thinning off and the transform empty.
+    // Returns false if full, or if a route with the same devices, tags and
+    // source cable exists: one link carries one output cable, so routes
+    // differing only in dest cable can't both work.
+    bool addRoute(const Route& route);
+
+    // Remove the route with the same devices, tags and cables (returns
+    // true if found and removed)
+    bool removeRoute(const Route& route);
 
     // Remove route by index
     bool removeRouteByIndex(int index);
 
-    // Check if a route exists
-    bool hasRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) const;
+    // Check if a route with the same devices, tags and cables exists
+    bool hasRoute(const Route& route) const;
+
+    // Whether both ends of a route are connected (O(1), kept up to date by
+    // rebuildRouteTable())
+    bool isRouteConnected(int index) const {
+        return index >= 0 && index < routeCount && (connectedRoutes[index >> 5] >> (index & 31)) & 1;
+    }
+
+    // Whether every route has both ends connected (O(1))
+    bool allRoutesConnected() const { return connectedCount == routeCount; }
+
+    // Rebuild the slot-to-slot route table from routes and connected devices.
+    // Called automatically on route changes; call after device connect/disconnect.
+    void rebuildRouteTable();
+
+    // Destination slots for a source slot and cable (hot path, no route scan)
+    SlotMask getDestMask(int srcSlot, uint8_t cable) const {
+        return (srcSlot >= 0 && srcSlot < MAX_MIDI_DEVICES) ? destMask[srcSlot][cable & 0x0F] : 0;
+    }
+
+    // Every slot a source routes to, on any cable
+    SlotMask getSourceDests(int srcSlot) const {
+        return (srcSlot >= 0 && srcSlot < MAX_MIDI_DEVICES) ? sourceDests[srcSlot] : 0;
+    }
+
+    // Slots among getDestMask() whose route has a filter to evaluate
+    SlotMask getFilteredMask(int srcSlot, uint8_t cable) const {
+        return (srcSlot >= 0 && srcSlot < MAX_MIDI_DEVICES) ? filteredMask[srcSlot][cable & 0x0F] : 0;
+    }
+
+    // Slots among getDestMask() whose route moves the message to another cable
+    SlotMask getRemapMask(int srcSlot, uint8_t cable) const {
+        return (srcSlot >= 0 && srcSlot < MAX_MIDI_DEVICES) ? remapMask[srcSlot][cable & 0x0F] : 0;
+    }
+
+    // Slots among getDestMask() whose route thins controller values
+    SlotMask getThinnedMask(int srcSlot, uint8_t cable) const {
+        return (srcSlot >= 0 && srcSlot < MAX_MIDI_DEVICES) ? thinnedMask[srcSlot][cable & 0x0F] : 0;
+    }
+
+    // Thinning for the route from srcSlot/cable to dstSlot
+    const RouteThin& getThin(int srcSlot, uint8_t cable, int dstSlot) const {
+        return routes[linkRoute[srcSlot][cable & 0x0F][dstSlot]].thin;
+    }
 
-    // Check if source should route to destination (by VID:PID)
-    bool shouldRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) const;
+    // Slots among getDestMask() whose route transforms channel messages
+    SlotMask getTransformedMask(int srcSlot, uint8_t cable) const {
+        return (srcSlot >= 0 && srcSlot < MAX_MIDI_DEVICES) ? transformedMask[srcSlot][cable & 0x0F] : 0;
+    }
+
+    // Apply the transform of the route from srcSlot/cable to dstSlot
+    uint32_t applyTransform(int srcSlot, uint8_t cable, int dstSlot, uint32_t packet) const {
+        int index = linkRoute[srcSlot][cable & 0x0F][dstSlot];
+        int table = routeVelocityTable[index];
+        return routes[index].transform.apply(packet, table >= 0 ? velocityTables[table] : nullptr);
+    }
+
+    // Output cable for a message from srcSlot/cable to dstSlot
+    uint8_t getOutputCable(int srcSlot, uint8_t cable, int dstSlot) const {
+        uint8_t destCable = routes[linkRoute[srcSlot][cable & 0x0F][dstSlot]].destCable;
+        return destCable == CABLE_ANY ? cable : destCable;
+    }
+
+    // Clear destination bits whose route filter rejects the message
+    SlotMask applyFilters(int srcSlot, uint8_t cable, SlotMask dests,
+                          uint8_t type, uint8_t channel, uint8_t data1) const {
+        cable &= 0x0F;
+        SlotMask check = dests & filteredMask[srcSlot][cable];
+        while (check) {
+            int dstSlot = __builtin_ctz(check);
+            check &= check - 1;
+            if (!routes[linkRoute[srcSlot][cable][dstSlot]].filter.passes(type, channel, data1)) {
+                dests &= (SlotMask)~(1u << dstSlot);
+            }
+        }
+        return dests;
+    }
+
+    // Set a route's filter
+    bool setRouteFilter(int index, const RouteFilter& filter);
+
+    // Set a route's controller thinning
+    bool setRouteThin(int index, const RouteThin& thin);
+
+    // Set a route's transform
+    bool setRouteTransform(int index, const RouteTransform& transform);
 
     // Get all routes for iteration
     const Route* getRoute(int index) const;
@@ -50,10 +177,79 @@ public:
     void clearAll();
 
 private:
+    // Routes in menu (insertion) order. Globals live in DTCM on Teensy 4,
+    // so the table is in fast RAM with the rest of the routing state.
     Route routes[MAX_ROUTES];
     int routeCount;
+    RouteStore store;
+
+    // Change waiting for savePending(). One is journaled; more than one
+    // is saved as a snapshot of the routes as they are by then.
+    enum PendingSave : uint8_t { SAVE_NONE, SAVE_PUT, SAVE_REMOVE, SAVE_ALL };
+    PendingSave pendingSave;
+    Route pendingRoute;  // The route put or removed
+    int pendingIndex;
+
+    // Indices into routes[], sorted by route key (binary search lookup)
+    uint16_t sortedIndex[MAX_ROUTES];
+
+    // Compiled route table, indexed by source slot and cable: destination
+    // slots, and for each link the route that produced it. One route per
+    // source cable and destination slot; a cable-specific route wins over
+    // an any-cable one.
+    const DeviceManager* deviceManager;
+    SlotMask destMask[MAX_MIDI_DEVICES][MIDI_CABLES];
+    SlotMask filteredMask[MAX_MIDI_DEVICES][MIDI_CABLES];
+    SlotMask remapMask[MAX_MIDI_DEVICES][MIDI_CABLES];
+    SlotMask thinnedMask[MAX_MIDI_DEVICES][MIDI_CABLES];
+    SlotMask transformedMask[MAX_MIDI_DEVICES][MIDI_CABLES];
+    uint16_t linkRoute[MAX_MIDI_DEVICES][MIDI_CABLES][MAX_MIDI_DEVICES];
+    SlotMask sourceDests[MAX_MIDI_DEVICES];  // Union of destMask over cables
+
+    // Route health: bit per route index, set when both ends are connected
+    uint32_t connectedRoutes[(MAX_ROUTES + 31) / 32];
+    int connectedCount;
+
+    // Devices, tags and cables at both ends, ordered for the sorted index
+    struct RouteKey {
+        uint64_t devices;  // srcVid:srcPid:dstVid:dstPid
+        uint64_t tags;     // srcTag:dstTag
+        uint16_t cables;   // srcCable:dstCable
+
+        explicit RouteKey(const Route& r)
+            : devices(((uint64_t)r.sourceVid << 48) | ((uint64_t)r.sourcePid << 32) |
+                      ((uint32_t)r.destVid << 16) | r.destPid),
+              tags(((uint64_t)r.sourceTag << 32) | r.destTag),
+              cables((uint16_t)((r.sourceCable << 8) | r.destCable)) {}
+
+        bool operator<(const RouteKey& other) const {
+            if (devices != other.devices) return devices < other.devices;
+            if (tags != other.tags) return tags < other.tags;
+            return cables < other.cables;
+        }
+        bool operator==(const RouteKey& other) const {
+            return devices == other.devices && tags == other.tags && cables == other.cables;
+        }
+
+        // Same devices, tags and source cable (any dest cable)
+        bool sameLink(const RouteKey& other) const {
+            return devices == other.devices && tags == other.tags && (cables >> 8) == (other.cables >> 8);
+        }
+    };
+
+    // Velocity curve lookup tables, built from the routes' transforms when
+    // the route table is rebuilt. Routes with the same curve share one.
+    uint8_t velocityTables[VELOCITY_TABLES][128];
+    int8_t routeVelocityTable[MAX_ROUTES];  // Table for each route, -1 = none
+
+    int findRoute(const RouteKey& key) const;
+    void queueSave(PendingSave type, const Route& route, int index);
 
-    int findRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) const;
+    // First position in sortedIndex whose key is >= key
+    int lowerBound(const RouteKey& key) const;
+    void rebuildIndex();
+    void buildVelocityTables();
+    void compileRoute(int index, SlotMask srcSlots, SlotMask dstSlots);
 };
 
 #endif
@@ -0,0 +1,406 @@
+#include "RouteStore.h"
+#include "RouteManager.h"
+#include <EEPROM.h>
+#include <string.h>
+
+// Record layout (RECORD_SIZE bytes, little-endian):
+// [0]:      Type (RECORD_*)
+// [1-4]:    Sequence number (+1 per record written, never reused)
+// [5-8]:    Generation (sequence number of the generation's snapshot header)
+// [9]:      Snapshot header: route count
+//           Route: source cable + 1 (0 = any)
+// [10-90]:  Route (srcVid, srcPid, dstVid, dstPid, srcName[24], dstName[24],
+//           channelMask, typeMask, rangeLow, rangeHigh, srcTag, dstTag,
+//           thin intervalMs, thin typeMask, transform channel, transpose,
+//           noteLow, noteHigh, velocityCurve, velocityAmount, ccFrom, ccTo,
+//           dest cable + 1 (0 = same as source))
+//           Snapshot header: [10] = EEPROM_VERSION
+// [91-92]:  CRC-16/CCITT of bytes 0-90
+//
+// Old flat layout (v2), converted on first boot:
+// [0-1]: Magic bytes (EEPROM_MAGIC)
+// [2]:   Version
+// [3]:   Route count
+// [4+]:  Routes (56 bytes each: srcVid, srcPid, dstVid, dstPid, srcName,
+//        dstName as above)
+
+const uint8_t RECORD_SNAPSHOT = 0xA1;  // Generation header
+const uint8_t RECORD_ROUTE = 0xA2;     // Route in a snapshot
+const uint8_t RECORD_PUT = 0xA3;       // Route added or changed
+const uint8_t RECORD_DELETE = 0xA4;    // Route removed
+
+const int ROUTE_SIZE_V2 = 8 + 24 + 24;  // VID:PID pairs + names
+const int ROUTE_SIZE = 81;              // Record bytes 10-90
+const int RECORD_HEADER_SIZE = 10;
+const int RECORD_SIZE = RECORD_HEADER_SIZE + ROUTE_SIZE + 2;
+
+// Ring size cap (Teensy 4.1's 4284-byte EEPROM holds 46 records). A new
+// snapshot must fit without touching the current generation, so a ring of
+// N records persists at most (N - 1) / 2 - 1 routes (21 on Teensy 4.1).
+// Routes past that are kept in RAM only.
+const int MAX_RECORDS = 64;
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint16_t crc16(const uint8_t* data, int length) {
+    uint16_t crc = 0xFFFF;
+    for (int i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Cable as stored: 0 = CABLE_ANY, else cable + 1
+static uint8_t encodeCable(uint8_t cable) {
+    return cable == CABLE_ANY ? 0 : (uint8_t)((cable & 0x0F) + 1);
+}
+
+static uint8_t decodeCable(uint8_t stored) {
+    return stored == 0 ? CABLE_ANY : (uint8_t)((stored - 1) & 0x0F);
+}
+
+static void encodeRoute(const Route& route, uint8_t* p) {
+    put16(p, route.sourceVid);
+    put16(p + 2, route.sourcePid);
+    put16(p + 4, route.destVid);
+    put16(p + 6, route.destPid);
+    memcpy(p + 8, route.sourceName, 24);
+    memcpy(p + 32, route.destName, 24);
+    put16(p + 56, route.filter.channelMask);
+    put16(p + 58, route.filter.typeMask);
+    p[60] = route.filter.rangeLow;
+    p[61] = route.filter.rangeHigh;
+    put32(p + 62, route.sourceTag);
+    put32(p + 66, route.destTag);
+    p[70] = route.thin.intervalMs;
+    p[71] = route.thin.typeMask;
+    p[72] = route.transform.channel;
+    p[73] = (uint8_t)route.transform.transpose;
+    p[74] = route.transform.noteLow;
+    p[75] = route.transform.noteHigh;
+    p[76] = route.transform.velocityCurve;
+    p[77] = route.transform.velocityAmount;
+    p[78] = route.transform.ccFrom;
+    p[79] = route.transform.ccTo;
+    p[80] = encodeCable(route.destCable);
+}
+
+// A v2 route: VID:PID pairs and names, the rest left at the defaults
+// (any cable and unit, filter open, no thinning or transform)
+static void decodeRouteV2(const uint8_t* p, Route& route) {
+    route = Route();
+    route.sourceVid = get16(p);
+    route.sourcePid = get16(p + 2);
+    route.destVid = get16(p + 4);
+    route.destPid = get16(p + 6);
+    memcpy(route.sourceName, p + 8, 24);
+    route.sourceName[23] = '\0';
+    memcpy(route.destName, p + 32, 24);
+    route.destName[23] = '\0';
+    route.sourceCable = CABLE_ANY;
+    route.destCable = CABLE_ANY;
+    route.sourceTag = DEVICE_TAG_ANY;
+    route.destTag = DEVICE_TAG_ANY;
+    route.active = true;
+}
+
+static void decodeRoute(const uint8_t* p, Route& route) {
+    decodeRouteV2(p, route);
+    route.filter.channelMask = get16(p + 56);
+    route.filter.typeMask = get16(p + 58);
+    route.filter.rangeLow = p[60];
+    route.filter.rangeHigh = p[61];
+    route.sourceTag = get32(p + 62);
+    route.destTag = get32(p + 66);
+    route.thin.intervalMs = p[70];
+    route.thin.typeMask = p[71];
+    route.transform.channel = p[72];
+    route.transform.transpose = (int8_t)p[73];
+    route.transform.noteLow = p[74];
+    route.transform.noteHigh = p[75];
+    route.transform.velocityCurve = p[76];
+    route.transform.velocityAmount = p[77];
+    route.transform.ccFrom = p[78];
+    route.transform.ccTo = p[79];
+    route.destCable = decodeCable(p[80]);
+}
+
+static int findByKey(const Route* routes, int count, const Route& key) {
+    for (int i = 0; i < count; i++) {
+        if (routes[i].sourceVid == key.sourceVid && routes[i].sourcePid == key.sourcePid &&
+            routes[i].destVid == key.destVid && routes[i].destPid == key.destPid &&
+            routes[i].sourceCable == key.sourceCable && routes[i].destCable == key.destCable &&
+            routes[i].sourceTag == key.sourceTag && routes[i].destTag == key.destTag) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+RouteStore::RouteStore()
+    : recordCount(0), writeIndex(0), nextSeq(1), generation(0),
+      generationLength(0), hasGeneration(false) {
+}
+
+int RouteStore::load(Route* routes, int maxRoutes) {
+    recordCount = (EEPROM.length() - EEPROM_START_ADDR) / RECORD_SIZE;
+    if (recordCount > MAX_RECORDS) recordCount = MAX_RECORDS;
+
+    int count = 0;
+    if (loadJournal(routes, maxRoutes, count)) {
+        return count;
+    }
+
+    count = loadLegacy(routes, maxRoutes);
+    if (count < 0) return 0;
+
+    // Convert, writing past the old data so a torn conversion still
+    // leaves the old layout readable
+    int legacyBytes = 4 + count * ROUTE_SIZE_V2;
+    writeIndex = ((legacyBytes + RECORD_SIZE - 1) / RECORD_SIZE) % recordCount;
+    writeSnapshot(routes, count);
+    return count;
+}
+
+bool RouteStore::loadJournal(Route* routes, int maxRoutes, int& count) {
+    // Fast pass: type and sequence only, no CRC
+    uint8_t types[MAX_RECORDS];
+    uint32_t seqs[MAX_RECORDS];
+    int newest = -1;
+    for (int i = 0; i < recordCount; i++) {
+        int addr = EEPROM_START_ADDR + i * RECORD_SIZE;
+        types[i] = EEPROM.read(addr);
+        seqs[i] = 0;
+        if (types[i] < RECORD_SNAPSHOT || types[i] > RECORD_DELETE) continue;
+        for (int b = 3; b >= 0; b--) {
+            seqs[i] = (seqs[i] << 8) | EEPROM.read(addr + 1 + b);
+        }
+        if (newest < 0 || seqs[i] > seqs[newest]) newest = i;
+    }
+
+    // Try snapshots newest first; an incomplete (torn) one falls back
+    // to the generation before it
+    uint32_t below = 0xFFFFFFFF;
+    while (true) {
+        int best = -1;
+        for (int i = 0; i < recordCount; i++) {
+            if (types[i] == RECORD_SNAPSHOT && seqs[i] < below &&
+                (best < 0 || seqs[i] > seqs[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) break;
+
+        if (replayGeneration(best, routes, maxRoutes, count)) {
+            return true;
+        }
+        below = seqs[best];
+    }
+
+    // No journal: continue the ring after whatever was written last
+    hasGeneration = false;
+    writeIndex = (newest >= 0) ? (newest + 1) % recordCount : 0;
+    if (newest >= 0 && seqs[newest] >= nextSeq) {
+        nextSeq = seqs[newest] + 1;
+    }
+    return false;
+}
+
+int RouteStore::capacity() const {
+    int routes = (recordCount - 1) / 2 - 1;
+    return routes > 0 ? routes : 0;
+}
+
+void RouteStore::writeSnapshot(const Route* routes, int count) {
+    if (recordCount == 0) return;
+    if (count > capacity()) count = capacity();
+
+    generation = nextSeq;
+    writeRecord(RECORD_SNAPSHOT, (uint8_t)count, nullptr);
+    for (int i = 0; i < count; i++) {
+        writeRecord(RECORD_ROUTE, encodeCable(routes[i].sourceCable), &routes[i]);
+    }
+    generationLength = count + 1;
+    hasGeneration = true;
+}
+
+void RouteStore::putRoute(const Route& route, int index, const Route* routes, int count) {
+    if (!isPersisted(index)) return;
+    appendDelta(RECORD_PUT, route, routes, count);
+}
+
+void RouteStore::removeRoute(const Route& route, int index, const Route* routes, int count) {
+    if (!isPersisted(index)) return;
+    appendDelta(RECORD_DELETE, route, routes, count);
+
+    // The first RAM-only route moved down into the persisted range (a
+    // torn write here only leaves it unsaved, as it was)
+    if (count >= capacity()) {
+        appendDelta(RECORD_PUT, routes[capacity() - 1], routes, count);
+    }
+}
+
+bool RouteStore::appendDelta(uint8_t type, const Route& route, const Route* routes, int count) {
+    if (recordCount == 0) return false;
+    if (count > capacity()) count = capacity();
+
+    // Compact into a new snapshot when one more delta would leave no room
+    // to write the next snapshot (up to count + 1 routes) without
+    // overwriting this generation
+    if (!hasGeneration || generationLength + 1 + (count + 2) > recordCount) {
+        writeSnapshot(routes, count);
+        return true;
+    }
+
+    writeRecord(type, encodeCable(route.sourceCable), &route);
+    generationLength++;
+    return true;
+}
+
+void RouteStore::writeRecord(uint8_t type, uint8_t arg, const Route* route) {
+    uint8_t record[RECORD_SIZE];
+    memset(record, 0, sizeof(record));
+    record[0] = type;
+    put32(record + 1, nextSeq);
+    put32(record + 5, generation);
+    record[9] = arg;
+    if (route) {
+        encodeRoute(*route, record + RECORD_HEADER_SIZE);
+    } else {
+        record[RECORD_HEADER_SIZE] = EEPROM_VERSION;
+    }
+    put16(record + RECORD_SIZE - 2, crc16(record, RECORD_SIZE - 2));
+
+    // update() skips bytes that already hold the right value
+    int addr = EEPROM_START_ADDR + writeIndex * RECORD_SIZE;
+    for (int i = 0; i < RECORD_SIZE; i++) {
+        EEPROM.update(addr + i, record[i]);
+    }
+
+    writeIndex = (writeIndex + 1) % recordCount;
+    nextSeq++;
+}
+
+bool RouteStore::readRecord(int index, uint8_t* record) const {
+    int addr = EEPROM_START_ADDR + index * RECORD_SIZE;
+    for (int i = 0; i < RECORD_SIZE; i++) {
+        record[i] = EEPROM.read(addr + i);
+    }
+    return get16(record + RECORD_SIZE - 2) == crc16(record, RECORD_SIZE - 2);
+}
+
+bool RouteStore::replayGeneration(int index, Route* routes, int maxRoutes, int& count) {
+    uint8_t record[RECORD_SIZE];
+    if (!readRecord(index, record) || record[0] != RECORD_SNAPSHOT ||
+        record[RECORD_HEADER_SIZE] != EEPROM_VERSION) {
+        return false;
+    }
+
+    uint32_t gen = get32(record + 1);
+    int snapshotCount = record[9];
+    if (snapshotCount > maxRoutes || snapshotCount + 1 > recordCount) {
+        return false;
+    }
+
+    // Snapshot routes must all be present and valid
+    count = 0;
+    for (int k = 1; k <= snapshotCount; k++) {
+        if (!readRecord((index + k) % recordCount, record) || record[0] != RECORD_ROUTE ||
+            get32(record + 1) != gen + k || get32(record + 5) != gen) {
+            return false;
+        }
+        decodeRoute(record + RECORD_HEADER_SIZE, routes[count]);
+        routes[count++].sourceCable = decodeCable(record[9]);
+    }
+
+    // Replay deltas until the chain breaks (end of journal or torn write)
+    uint32_t seq = gen + snapshotCount + 1;
+    int length = snapshotCount + 1;
+    while (length < recordCount) {
+        if (!readRecord((index + length) % recordCount, record) ||
+            get32(record + 1) != seq || get32(record + 5) != gen) {
+            break;
+        }
+
+        Route route;
+        decodeRoute(record + RECORD_HEADER_SIZE, route);
+        route.sourceCable = decodeCable(record[9]);
+        int existing = findByKey(routes, count, route);
+        if (record[0] == RECORD_PUT) {
+            if (existing >= 0) {
+                routes[existing] = route;
+            } else if (count < maxRoutes) {
+                routes[count++] = route;
+            }
+        } else if (record[0] == RECORD_DELETE) {
+            if (existing >= 0) {
+                for (int i = existing; i < count - 1; i++) {
+                    routes[i] = routes[i + 1];
+                }
+                count--;
+            }
+        } else {
+            break;
+        }
+
+        seq++;
+        length++;
+    }
+
+    writeIndex = (index + length) % recordCount;
+    nextSeq = seq;
+    generation = gen;
+    generationLength = length;
+    hasGeneration = true;
+    return true;
+}
+
+int RouteStore::loadLegacy(Route* routes, int maxRoutes) {
+    // Check magic bytes
+    uint16_t magic = EEPROM.read(EEPROM_START_ADDR) | (EEPROM.read(EEPROM_START_ADDR + 1) << 8);
+    if (magic != EEPROM_MAGIC) {
+        return -1;
+    }
+
+    // Check version
+    if (EEPROM.read(EEPROM_START_ADDR + 2) != 2) {
+        return -1;
+    }
+
+    // Read route count
+    int count = EEPROM.read(EEPROM_START_ADDR + 3);
+    if (count > maxRoutes) {
+        return -1;
+    }
+
+    // Read routes
+    uint8_t buf[ROUTE_SIZE_V2];
+    int addr = EEPROM_START_ADDR + 4;
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < ROUTE_SIZE_V2; j++) {
+            buf[j] = EEPROM.read(addr + j);
+        }
+        decodeRouteV2(buf, routes[i]);
+        addr += ROUTE_SIZE_V2;
+    }
+    return count;
+}
@@ -0,0 +1,67 @@
+#ifndef ROUTE_STORE_H
+#define ROUTE_STORE_H
+
+#include <stdint.h>
+#include "Config.h"
+
+struct Route;
+
+// Journaled, wear-leveled route storage in EEPROM.
+//
+// The first capacity() routes of the list persist; routes past that live
+// in RAM only until removing earlier ones moves them into range.
+//
+// EEPROM is used as a ring of fixed-size records, each with a sequence
+// number and CRC. A generation starts with a snapshot (header + one
+// record per route) and continues with put/delete records for single
+// route changes. Writes always go to the next ring slot, so wear is
+// spread across the whole EEPROM. When a generation gets too long a new
+// snapshot is written after it; the old one stays intact until the new
+// one is complete, so a torn write always leaves a loadable generation.
+class RouteStore {
+public:
+    RouteStore();
+
+    // Scan EEPROM and replay the newest complete generation into routes.
+    // Falls back to the old flat (v2) layout and converts it. That layout
+    // can hold more routes than capacity(); all are loaded, but only the
+    // first capacity() are written back.
+    // Returns the number of routes loaded.
+    int load(Route* routes, int maxRoutes);
+
+    // Write a full snapshot of the routes that persist (starts a new
+    // generation)
+    void writeSnapshot(const Route* routes, int count);
+
+    // Journal an added or changed route at index (matched by its devices,
+    // tags and cables). routes/count is the full list after the change,
+    // used if the journal needs compacting into a new snapshot.
+    void putRoute(const Route& route, int index, const Route* routes, int count);
+
+    // Journal the removal of the route that was at index; routes/count is
+    // the list after removal
+    void removeRoute(const Route& route, int index, const Route* routes, int count);
+
+    // Most routes this EEPROM can persist (known after load())
+    int capacity() const;
+
+    // Whether the route at index persists
+    bool isPersisted(int index) const { return index < capacity(); }
+
+private:
+    int recordCount;       // Ring size in records
+    int writeIndex;        // Next ring slot to write
+    uint32_t nextSeq;      // Sequence number for the next record
+    uint32_t generation;   // Sequence number of the current snapshot header
+    int generationLength;  // Records in the current generation
+    bool hasGeneration;
+
+    bool loadJournal(Route* routes, int maxRoutes, int& count);
+    bool appendDelta(uint8_t type, const Route& route, const Route* routes, int count);
+    void writeRecord(uint8_t type, uint8_t arg, const Route* route);
+    bool readRecord(int index, uint8_t* record) const;
+    bool replayGeneration(int index, Route* routes, int maxRoutes, int& count);
+    int loadLegacy(Route* routes, int maxRoutes);
+};
+
+#endif
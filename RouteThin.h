@@ -0,0 +1,46 @@
+#ifndef ROUTE_THIN_H
+#define ROUTE_THIN_H
+
+#include <stdint.h>
+
+// Message type bits for RouteThin::typeMask
+enum ThinType : uint8_t {
+    THIN_POLY_PRESSURE    = 1 << 0,
+    THIN_CONTROL_CHANGE   = 1 << 1,
+    THIN_CHANNEL_PRESSURE = 1 << 2,
+    THIN_PITCH_BEND       = 1 << 3,
+    THIN_ALL_TYPES        = 0x0F
+};
+
+// Per-route rate limit for continuous controllers. Values of one
+// controller (type, channel and CC or note number) go out at most once
+// per intervalMs; in between the latest value is held and sent when the
+// interval is up, so the final position of a sweep always arrives.
+// The default is off.
+struct RouteThin {
+    uint8_t intervalMs;  // Minimum time between values of one controller, 0 = off
+    uint8_t typeMask;    // ThinType bits that are thinned
+
+    RouteThin() : intervalMs(0), typeMask(THIN_ALL_TYPES) {}
+
+    bool isActive() const {
+        return intervalMs != 0 && typeMask != 0;
+    }
+
+    // ThinType bit for a message type as returned by MIDIDevice::getType()
+    static uint8_t typeBit(uint8_t type) {
+        switch (type) {
+            case 0xA0: return THIN_POLY_PRESSURE;
+            case 0xB0: return THIN_CONTROL_CHANGE;
+            case 0xD0: return THIN_CHANNEL_PRESSURE;
+            case 0xE0: return THIN_PITCH_BEND;
+            default:   return 0;
+        }
+    }
+
+    bool thins(uint8_t type) const {
+        return typeMask & typeBit(type);
+    }
+};
+
+#endif
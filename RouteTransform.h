@@ -0,0 +1,96 @@
+#ifndef ROUTE_TRANSFORM_H
+#define ROUTE_TRANSFORM_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Velocity curves for RouteTransform::velocityCurve
+enum VelocityCurve : uint8_t {
+    VELOCITY_LINEAR = 0,  // Unchanged
+    VELOCITY_SOFT   = 1,  // Louder at low velocities (velocityAmount = strength)
+    VELOCITY_HARD   = 2,  // Quieter at low velocities (velocityAmount = strength)
+    VELOCITY_FIXED  = 3   // Every note at velocityAmount
+};
+
+// RouteTransform::ccFrom value for no CC remap
+const uint8_t CC_REMAP_OFF = 0xFF;
+
+// Per-route message transform, applied to channel voice messages on their
+// way out: channel remap, note transpose clamped to a range, note-on
+// velocity curve and one CC number remap. The default changes nothing.
+struct RouteTransform {
+    uint8_t channel;         // Output channel 1-16, 0 = keep
+    int8_t transpose;        // Semitones added to note and poly pressure numbers
+    uint8_t noteLow;         // Notes are clamped to this range after transposing
+    uint8_t noteHigh;
+    uint8_t velocityCurve;   // VelocityCurve
+    uint8_t velocityAmount;  // Curve strength 0-127, or the fixed velocity
+    uint8_t ccFrom;          // CC number moved to ccTo, or CC_REMAP_OFF
+    uint8_t ccTo;
+
+    RouteTransform()
+        : channel(0), transpose(0), noteLow(0), noteHigh(127), velocityCurve(VELOCITY_LINEAR),
+          velocityAmount(0), ccFrom(CC_REMAP_OFF), ccTo(0) {}
+
+    bool hasCurve() const {
+        return velocityCurve == VELOCITY_FIXED ||
+               ((velocityCurve == VELOCITY_SOFT || velocityCurve == VELOCITY_HARD) && velocityAmount != 0);
+    }
+
+    bool isIdentity() const {
+        return channel == 0 && transpose == 0 && noteLow == 0 && noteHigh >= 127 &&
+               !hasCurve() && (ccFrom > 127 || ccFrom == ccTo);
+    }
+
+    // Note-on velocity through the curve. 0 (note off) stays 0 and any
+    // other velocity stays at least 1.
+    uint8_t velocity(uint8_t value) const {
+        if (value == 0) return 0;
+        int out = value;
+        if (velocityCurve == VELOCITY_FIXED) {
+            out = velocityAmount;
+        } else if (velocityCurve == VELOCITY_SOFT || velocityCurve == VELOCITY_HARD) {
+            float power = 1.0f + velocityAmount / 32.0f;
+            if (velocityCurve == VELOCITY_SOFT) power = 1.0f / power;
+            out = (int)lroundf(127.0f * powf(value / 127.0f, power));
+        }
+        return (uint8_t)(out < 1 ? 1 : (out > 127 ? 127 : out));
+    }
+
+    // Fill a 128-entry velocity lookup table for this curve
+    void buildVelocityTable(uint8_t* table) const {
+        for (int v = 0; v < 128; v++) {
+            table[v] = velocity((uint8_t)v);
+        }
+    }
+
+    // Transform a packed USB-MIDI event. velocityTable is this curve's
+    // lookup table, or nullptr to compute it. System messages pass as is.
+    uint32_t apply(uint32_t packet, const uint8_t* velocityTable) const {
+        uint8_t status = (uint8_t)(packet >> 8);
+        uint8_t type = status & 0xF0;
+        if (type < 0x80 || type == 0xF0) return packet;
+
+        uint8_t data1 = (packet >> 16) & 0x7F;
+        uint8_t data2 = (packet >> 24) & 0x7F;
+        if (channel) {
+            status = type | ((channel - 1) & 0x0F);
+        }
+        if (type <= 0xA0) {
+            // Note off, note on, poly pressure
+            int note = data1 + transpose;
+            if (note < noteLow) note = noteLow;
+            if (note > noteHigh) note = noteHigh;
+            data1 = (uint8_t)note & 0x7F;
+            if (type == 0x90 && velocityCurve != VELOCITY_LINEAR) {
+                data2 = velocityTable ? velocityTable[data2] : velocity(data2);
+            }
+        } else if (type == 0xB0 && data1 == ccFrom) {
+            data1 = ccTo & 0x7F;
+        }
+        return (packet & 0xFF) | ((uint32_t)status << 8) |
+               ((uint32_t)data1 << 16) | ((uint32_t)data2 << 24);
+    }
+};
+
+#endif
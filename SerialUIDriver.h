@@ -5,48 +5,66 @@
 #include "UIDriver.h"
 
 // Serial terminal UI driver implementation
+//
+// Frames are composed into a text buffer and compared with a shadow copy
+// of what the terminal shows. Only changed cells are sent, as runs behind
+// ANSI cursor-addressing escapes, from service() in writes that fit the
+// USB serial buffer, so an unchanged screen sends nothing and routing is
+// never blocked on Serial.
 class SerialUIDriver : public UIDriver {
 public:
-    void beginFrame() override {
-        // ANSI clear screen and move cursor to top-left
-        Serial.print("\033[2J\033[H");
+    SerialUIDriver()
+        : row(0), dirty(false), needsReset(true), terminalConnected(false),
+          outLength(0), outSent(0) {
+        clearScreen(screen);
+    }
+
+    UIRect damageRect(uint8_t damage, const ListView& list) override {
+        (void)damage;
+        (void)list;
+        // Frames are composed whole; the diff finds what actually changed
+        return UIRect(0, 0, TERM_COLUMNS, TERM_ROWS);
+    }
+
+    void beginFrame(const UIRect& region) override {
+        (void)region;
+        clearScreen(screen);
+        row = 0;
     }
 
     void drawList(const ListView& list) override {
-        Serial.println();
+        // Only the list's window is built; mark rows scrolled out of view
+        int viewEnd = list.windowStart + VISIBLE_ITEMS;
+        if (viewEnd > list.count) viewEnd = list.count;
+        if (list.windowStart > 0) put(0, 0, "  ^");
 
-        for (int i = 0; i < list.count; i++) {
-            const ListItem& item = list.items[i];
-            bool selected = (i == list.selectedIndex);
+        for (int i = list.windowStart; i < viewEnd; i++) {
+            const ListItem& item = list.item(i);
+            int line = 1 + i - list.windowStart;
 
             // Selection indicator
-            if (selected) {
-                Serial.print("> ");
-            } else {
-                Serial.print("  ");
-            }
+            int col = put(line, 0, (i == list.selectedIndex) ? "> " : "  ");
 
             // Left text
             if (item.left) {
-                Serial.print(item.left);
-                Serial.print(" ");
+                col = put(line, col, item.left);
+                col = put(line, col, " ");
             }
 
             // Center text
             if (item.center) {
-                Serial.print(item.center);
+                col = put(line, col, item.center);
             }
 
             // Right text
             if (item.right) {
-                Serial.print(" ");
-                Serial.print(item.right);
+                col = put(line, col, " ");
+                put(line, col, item.right);
             }
-
-            Serial.println();
         }
 
-        Serial.println();
+        if (viewEnd < list.count) put(VISIBLE_ITEMS + 1, 0, "  v");
+        row = VISIBLE_ITEMS + 2;
     }
 
     bool drawToast(const char* message) override {
@@ -54,22 +72,18 @@ public:
         int len = strlen(message);
         int boxWidth = len + 4;
 
-        Serial.println();
+        row++;  // Blank line
 
         // Top border
-        Serial.print("  +");
-        for (int i = 0; i < boxWidth - 2; i++) Serial.print("-");
-        Serial.println("+");
+        drawBorder(row++, boxWidth);
 
         // Message line
-        Serial.print("  | ");
-        Serial.print(message);
-        Serial.println(" |");
+        int col = put(row, 0, "  | ");
+        col = put(row, col, message);
+        put(row++, col, " |");
 
         // Bottom border
-        Serial.print("  +");
-        for (int i = 0; i < boxWidth - 2; i++) Serial.print("-");
-        Serial.println("+");
+        drawBorder(row++, boxWidth);
 
         return false;  // Serial doesn't scroll
     }
@@ -86,52 +100,163 @@ public:
         int contentWidth = (qLen > optionsLen) ? qLen : optionsLen;
         int boxWidth = contentWidth + 4;
 
-        Serial.println();
+        row++;  // Blank line
 
         // Top border
-        Serial.print("  +");
-        for (int i = 0; i < boxWidth - 2; i++) Serial.print("-");
-        Serial.println("+");
+        drawBorder(row++, boxWidth);
 
         // Question line (centered)
-        Serial.print("  | ");
-        int qPad = (contentWidth - qLen) / 2;
-        for (int i = 0; i < qPad; i++) Serial.print(" ");
-        Serial.print(question);
-        for (int i = 0; i < contentWidth - qLen - qPad; i++) Serial.print(" ");
-        Serial.println(" |");
+        int col = put(row, 0, "  | ");
+        col = put(row, col + (contentWidth - qLen) / 2, question);
+        put(row++, 4 + contentWidth, " |");
 
         // Empty line
-        Serial.print("  |");
-        for (int i = 0; i < boxWidth - 2; i++) Serial.print(" ");
-        Serial.println("|");
+        put(row, 0, "  |");
+        put(row++, boxWidth + 1, "|");
 
         // Options line
-        Serial.print("  | ");
+        col = put(row, 0, "  | ");
         if (yesSelected) {
-            Serial.print("[");
-            Serial.print(yesLabel);
-            Serial.print("]  ");
-            Serial.print(noLabel);
+            col = put(row, col, "[");
+            col = put(row, col, yesLabel);
+            col = put(row, col, "]  ");
+            put(row, col, noLabel);
         } else {
-            Serial.print(yesLabel);
-            Serial.print("  [");
-            Serial.print(noLabel);
-            Serial.print("]");
+            col = put(row, col, yesLabel);
+            col = put(row, col, "  [");
+            col = put(row, col, noLabel);
+            put(row, col, "]");
         }
-        // Pad to fill box
-        int usedWidth = yLen + nLen + 5;
-        for (int i = usedWidth; i < contentWidth; i++) Serial.print(" ");
-        Serial.println(" |");
+        put(row++, 4 + contentWidth, " |");
 
         // Bottom border
-        Serial.print("  +");
-        for (int i = 0; i < boxWidth - 2; i++) Serial.print("-");
-        Serial.println("+");
+        drawBorder(row++, boxWidth);
     }
 
     void endFrame() override {
-        // Serial is unbuffered, nothing to flush
+        // Changed cells are sent by service()
+        dirty = true;
+    }
+
+    // Write as much of the pending terminal output as fits without
+    // blocking, composing it from the latest frame when none is left
+    void service() override {
+        // A terminal that (re)connects starts from a cleared screen
+        bool connected = Serial.dtr();
+        if (connected && !terminalConnected) {
+            needsReset = true;
+            outLength = 0;
+            outSent = 0;
+        }
+        terminalConnected = connected;
+        if (!connected) return;
+
+        if (outSent == outLength) {
+            outLength = 0;
+            outSent = 0;
+            if (!dirty && !needsReset) return;
+            composeOutput();
+        }
+
+        int room = Serial.availableForWrite();
+        int length = outLength - outSent;
+        if (length > room) length = room;
+        if (length > 0) {
+            Serial.write((const uint8_t*)out + outSent, length);
+            outSent += length;
+        }
+    }
+
+private:
+    static const int TERM_COLUMNS = 80;
+    static const int TERM_OVERLAY_LINES = 8;  // Blank lines plus toast/confirm box
+    static const int TERM_ROWS = VISIBLE_ITEMS + 2 + TERM_OVERLAY_LINES;
+    static const int OUT_BYTES = 1024;        // Escapes and text for one frame's changes
+    static const int RUN_GAP = 6;             // Unchanged cells worth skipping with an escape
+
+    char screen[TERM_ROWS][TERM_COLUMNS];     // Frame being composed
+    char shown[TERM_ROWS][TERM_COLUMNS];      // What the terminal shows
+    int row;                                  // Next free line for overlays
+    bool dirty;                               // screen may differ from shown
+    bool needsReset;                          // Clear the terminal first
+    bool terminalConnected;
+
+    char out[OUT_BYTES];                      // Output not yet written
+    int outLength;
+    int outSent;
+
+    static void clearScreen(char (&cells)[TERM_ROWS][TERM_COLUMNS]) {
+        memset(cells, ' ', sizeof(cells));
+    }
+
+    // Put text on a line from a column, clipped to the screen. Returns the
+    // column after it.
+    int put(int line, int col, const char* text) {
+        if (line < 0 || line >= TERM_ROWS) return col;
+        while (*text && col < TERM_COLUMNS) {
+            screen[line][col++] = *text++;
+        }
+        return col;
+    }
+
+    void drawBorder(int line, int boxWidth) {
+        int col = put(line, 0, "  +");
+        for (int i = 0; i < boxWidth - 2; i++) col = put(line, col, "-");
+        put(line, col, "+");
+    }
+
+    bool append(const char* data, int length) {
+        if (outLength + length > OUT_BYTES) return false;
+        memcpy(out + outLength, data, length);
+        outLength += length;
+        return true;
+    }
+
+    // Build the escapes and text that turn shown into screen. Runs that
+    // don't fit the output buffer are left for the next call.
+    void composeOutput() {
+        if (needsReset) {
+            // Clear, home, hide the cursor
+            static const char reset[] = "\033[2J\033[H\033[?25l";
+            append(reset, sizeof(reset) - 1);
+            clearScreen(shown);
+            needsReset = false;
+        }
+
+        dirty = false;
+        for (int line = 0; line < TERM_ROWS; line++) {
+            int col = 0;
+            while (col < TERM_COLUMNS) {
+                if (screen[line][col] == shown[line][col]) {
+                    col++;
+                    continue;
+                }
+
+                // A run of changes, bridging short unchanged gaps
+                int start = col;
+                int end = col + 1;
+                int same = 0;
+                for (int c = end; c < TERM_COLUMNS && same < RUN_GAP; c++) {
+                    if (screen[line][c] == shown[line][c]) {
+                        same++;
+                    } else {
+                        same = 0;
+                        end = c + 1;
+                    }
+                }
+
+                char move[12];
+                int moveLength = snprintf(move, sizeof(move), "\033[%d;%dH", line + 1, start + 1);
+                if (outLength + moveLength + (end - start) > OUT_BYTES) {
+                    dirty = true;
+                    return;
+                }
+                append(move, moveLength);
+                append(&screen[line][start], end - start);
+                memcpy(&shown[line][start], &screen[line][start], end - start);
+                col = end;
+            }
+        }
     }
 };
 
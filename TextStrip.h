@@ -0,0 +1,117 @@
+#ifndef TEXT_STRIP_H
+#define TEXT_STRIP_H
+
+#include <stdint.h>
+#include <string.h>
+#include <Adafruit_GFX.h>
+
+// One line of text pre-rendered into a 1-bpp bitmap strip, in the same
+// page layout as the SSD1306 frame buffer (a byte holds 8 vertical
+// pixels, LSB on top). Rendered once from the font's glyph bitmaps;
+// drawing it, at any scroll offset, is then a shifted copy of columns.
+// Works on a plain frame buffer, with no display attached.
+class TextStrip {
+public:
+    static const int HEIGHT = 24;            // Glyph tops to descenders
+    static const int BASELINE = 13;          // Text baseline, from the strip top
+    static const int MAX_WIDTH = 64 * 11;    // Pixels kept (a 64-char label)
+
+    TextStrip() : width(0) {}
+
+    // Exact advance width of text in font
+    static int textWidth(const GFXfont* font, const char* text) {
+        int total = 0;
+        for (const char* c = text; *c; c++) {
+            uint8_t ch = (uint8_t)*c;
+            if (ch >= font->first && ch <= font->last) {
+                total += font->glyph[ch - font->first].xAdvance;
+            }
+        }
+        return total;
+    }
+
+    // Render text, replacing what the strip held
+    void render(const GFXfont* font, const char* text) {
+        memset(bits, 0, sizeof(bits));
+        int cursor = 0;
+        for (const char* c = text; *c && cursor < MAX_WIDTH; c++) {
+            uint8_t ch = (uint8_t)*c;
+            if (ch < font->first || ch > font->last) continue;
+            const GFXglyph& glyph = font->glyph[ch - font->first];
+
+            // Glyph bitmaps are packed rows, MSB first (as Adafruit GFX draws them)
+            const uint8_t* bitmap = font->bitmap + glyph.bitmapOffset;
+            uint8_t byte = 0;
+            int bit = 0;
+            for (int yy = 0; yy < glyph.height; yy++) {
+                for (int xx = 0; xx < glyph.width; xx++) {
+                    if (!(bit++ & 7)) byte = *bitmap++;
+                    if (byte & 0x80) {
+                        setPixel(cursor + glyph.xOffset + xx, BASELINE + glyph.yOffset + yy);
+                    }
+                    byte <<= 1;
+                }
+            }
+            cursor += glyph.xAdvance;
+        }
+        width = cursor < MAX_WIDTH ? cursor : MAX_WIDTH;
+    }
+
+    // Rendered width in pixels
+    int getWidth() const { return width; }
+
+    // Draw into a frame buffer (frameWidth pixels wide, framePages pages
+    // tall) with the strip's top-left at x, y, inside the clip rectangle.
+    // inverted clears the text's pixels instead of setting them (dark text
+    // on a filled background).
+    void blit(uint8_t* frame, int frameWidth, int framePages, int x, int y,
+              int clipX, int clipY, int clipW, int clipH, bool inverted) const {
+        int from = (x > clipX) ? x : clipX;
+        int to = (x + width < clipX + clipW) ? x + width : clipX + clipW;
+        if (from < 0) from = 0;
+        if (to > frameWidth) to = frameWidth;
+        if (from >= to || y < 0) return;
+
+        // Pages touched, and which of their rows the clip allows
+        static const int SPAN = (HEIGHT + 7) / 8 + 1;
+        int firstPage = y / 8;
+        int shift = y & 7;
+        uint8_t pageMask[SPAN];
+        for (int p = 0; p < SPAN; p++) {
+            pageMask[p] = 0;
+            for (int r = 0; r < 8; r++) {
+                int row = (firstPage + p) * 8 + r;
+                if (row >= clipY && row < clipY + clipH) pageMask[p] |= (uint8_t)(1 << r);
+            }
+        }
+
+        for (int sx = from; sx < to; sx++) {
+            int column = sx - x;
+            uint32_t pixels = 0;
+            for (int p = 0; p < PAGES; p++) {
+                pixels |= (uint32_t)bits[p][column] << (8 * p);
+            }
+            pixels <<= shift;
+
+            for (int p = 0; p < SPAN && firstPage + p < framePages; p++) {
+                uint8_t b = (uint8_t)(pixels >> (8 * p)) & pageMask[p];
+                if (!b) continue;
+                uint8_t& dst = frame[sx + (firstPage + p) * frameWidth];
+                dst = inverted ? (uint8_t)(dst & ~b) : (uint8_t)(dst | b);
+            }
+        }
+    }
+
+private:
+    static const int PAGES = HEIGHT / 8;
+
+    uint8_t bits[PAGES][MAX_WIDTH];
+    int width;
+
+    void setPixel(int x, int y) {
+        if (x < 0 || x >= MAX_WIDTH || y < 0 || y >= HEIGHT) return;
+        bits[y / 8][x] |= (uint8_t)(1 << (y & 7));
+    }
+};
+
+#endif
@@ -1,15 +1,60 @@
 #ifndef UIDRIVER_H
 #define UIDRIVER_H
 
+#include <stdint.h>
 #include "ListItem.h"
 
+// What changed since the last frame (UIManager accumulates these)
+enum UIDamage : uint8_t {
+    DAMAGE_NONE        = 0,
+    DAMAGE_LIST        = 1 << 0,  // List contents changed
+    DAMAGE_SELECTION   = 1 << 1,  // Selected row moved
+    DAMAGE_SCROLL      = 1 << 2,  // Selected row text scroll step
+    DAMAGE_TOAST       = 1 << 3,  // Toast shown, expired or scrolled
+    DAMAGE_CONFIRM     = 1 << 4,  // Confirmation shown, toggled or closed
+    DAMAGE_SCREENSAVER = 1 << 5,  // Screensaver ball moved
+    DAMAGE_ALL         = 0xFF
+};
+
+// Rectangular display region in driver units (pixels, or text cells)
+struct UIRect {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+
+    UIRect() : x(0), y(0), w(0), h(0) {}
+    UIRect(int16_t x, int16_t y, int16_t w, int16_t h) : x(x), y(y), w(w), h(h) {}
+
+    bool isEmpty() const { return w <= 0 || h <= 0; }
+
+    // Grow to the bounding box of this and another region
+    void include(const UIRect& r) {
+        if (r.isEmpty()) return;
+        if (isEmpty()) { *this = r; return; }
+        int16_t x2 = (x + w > r.x + r.w) ? x + w : r.x + r.w;
+        int16_t y2 = (y + h > r.y + r.h) ? y + h : r.y + r.h;
+        if (r.x < x) x = r.x;
+        if (r.y < y) y = r.y;
+        w = x2 - x;
+        h = y2 - y;
+    }
+};
+
 // Abstract UI driver interface - allows different display implementations
 class UIDriver {
 public:
     virtual ~UIDriver() {}
 
-    // Begin a new frame (clear buffer)
-    virtual void beginFrame() = 0;
+    // Bounding region affected by the given damage flags
+    virtual UIRect damageRect(uint8_t damage, const ListView& list) = 0;
+
+    // Animation steps that are due now (DAMAGE_SCROLL, DAMAGE_TOAST,
+    // DAMAGE_SCREENSAVER). UIManager skips frames when nothing is due.
+    virtual uint8_t pendingDamage() { return DAMAGE_NONE; }
+
+    // Begin a new frame (clear the damaged region)
+    virtual void beginFrame(const UIRect& region) = 0;
 
     // Draw the main list view
     virtual void drawList(const ListView& list) = 0;
@@ -33,8 +78,11 @@ public:
     // Turn display back on
     virtual void displayOn() {}
 
-    // End frame (flush to display)
+    // End frame (flush to display, or queue it for service())
     virtual void endFrame() = 0;
+
+    // Called every loop() pass to push queued display data in short slices
+    virtual void service() {}
 };
 
 #endif
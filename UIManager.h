@@ -20,7 +20,7 @@ const int MAX_TOASTS = 8;
 // Central UI controller
 class UIManager {
 public:
-    UIManager() : driver(nullptr), needsRedraw(true),
+    UIManager() : driver(nullptr), damage(DAMAGE_ALL), drawnListRevision(0), drawnSelectedIndex(-1),
                   toastHead(0), toastTail(0), toastEndTime(0), toastScrolling(false),
                   confirmActive(false), confirmYesSelected(true), confirmCallback(nullptr),
                   lastActivityTime(0), sleeping(false), deepSleeping(false), sleepStartTime(0) {
@@ -34,8 +34,8 @@ public:
     // Access the list view for building UI
     ListView& getList() { return list; }
 
-    // Mark UI as needing redraw
-    void requestRedraw() { needsRedraw = true; }
+    // Mark the whole UI as needing redraw
+    void requestRedraw() { damage = DAMAGE_ALL; }
 
     // Show a temporary toast message
     void showToast(const char* message) {
@@ -53,7 +53,7 @@ public:
         }
 
         toastTail = nextTail;
-        needsRedraw = true;
+        damage |= DAMAGE_TOAST;
     }
 
     // Show a confirmation dialog (modal)
@@ -68,7 +68,7 @@ public:
         confirmCallback = callback;
         confirmYesSelected = true;  // Default to "Yes"
         confirmActive = true;
-        needsRedraw = true;
+        damage |= DAMAGE_CONFIRM;
     }
 
     // Check if confirmation is active
@@ -84,10 +84,10 @@ public:
             deepSleeping = false;
             sleeping = false;
             if (driver) driver->displayOn();
-            needsRedraw = true;
+            damage = DAMAGE_ALL;
         } else if (sleeping) {
             sleeping = false;
-            needsRedraw = true;
+            damage = DAMAGE_ALL;
         }
     }
 
@@ -100,7 +100,7 @@ public:
             case InputEvent::UP:
             case InputEvent::DOWN:
                 confirmYesSelected = !confirmYesSelected;
-                needsRedraw = true;
+                damage |= DAMAGE_CONFIRM;
                 return true;
 
             case InputEvent::ENTER:
@@ -108,7 +108,7 @@ public:
                 if (confirmCallback) {
                     confirmCallback(confirmYesSelected);
                 }
-                needsRedraw = true;
+                damage |= DAMAGE_CONFIRM;
                 return true;
 
             default:
@@ -124,7 +124,7 @@ public:
             if (toastHead != toastTail) {
                 toastEndTime = millis() + TOAST_DURATION_MS;
             }
-            needsRedraw = true;
+            damage |= DAMAGE_TOAST;
         }
 
         // Check for sleep timeout
@@ -132,6 +132,7 @@ public:
             if (millis() - lastActivityTime >= SLEEP_TIMEOUT_MS) {
                 sleeping = true;
                 sleepStartTime = millis();
+                damage = DAMAGE_ALL;
             }
         }
 
@@ -144,7 +145,12 @@ public:
         }
     }
 
-    // Render the UI (always render to support scrolling animations)
+    // Let the driver push a slice of any queued frame (call every loop pass)
+    void service() {
+        if (driver && !deepSleeping) driver->service();
+    }
+
+    // Render the UI, only composing a frame when something changed
     void render() {
         if (!driver) return;
 
@@ -153,13 +159,37 @@ public:
             return;
         }
 
+        uint8_t animation = driver->pendingDamage();
+
         // Screensaver mode
         if (sleeping) {
-            driver->drawScreensaver();
+            if (damage || (animation & DAMAGE_SCREENSAVER)) {
+                driver->drawScreensaver();
+                damage = DAMAGE_NONE;
+            }
             return;
         }
 
-        driver->beginFrame();
+        // Pick up list edits made directly through getList()
+        if (list.revision != drawnListRevision) {
+            damage |= DAMAGE_LIST;
+        }
+        if (list.selectedIndex != drawnSelectedIndex) {
+            damage |= DAMAGE_SELECTION;
+        }
+
+        // Toast animation only matters while a toast (and no dialog) is up
+        animation &= (uint8_t)~DAMAGE_SCREENSAVER;
+        if (confirmActive || toastHead == toastTail) {
+            animation &= (uint8_t)~DAMAGE_TOAST;
+        }
+
+        uint8_t frameDamage = damage | animation;
+        if (frameDamage == DAMAGE_NONE) {
+            return;
+        }
+
+        driver->beginFrame(driver->damageRect(frameDamage, list));
 
         // Draw the list
         driver->drawList(list);
@@ -174,13 +204,19 @@ public:
         }
 
         driver->endFrame();
-        needsRedraw = false;
+        damage = DAMAGE_NONE;
+        drawnListRevision = list.revision;
+        drawnSelectedIndex = list.selectedIndex;
     }
 
 private:
     UIDriver* driver;
     ListView list;
-    bool needsRedraw;
+
+    // Damage tracking
+    uint8_t damage;
+    uint16_t drawnListRevision;
+    int drawnSelectedIndex;
 
     // Toast queue
     char toastQueue[MAX_TOASTS][64];
@@ -0,0 +1,34 @@
+#ifndef USB_DRIVER_POOL_H
+#define USB_DRIVER_POOL_H
+
+#include <USBHost_t36.h>
+#include <new>
+
+// A compile-time sized set of USB host drivers of one type.
+//
+// USBHost_t36 drivers need the host at construction and register
+// themselves in construction order, so they can't be a plain array.
+// The pool constructs them in place, in index order; declare pools in
+// the order drivers should get the chance to claim a device.
+template <class Driver, int N>
+class UsbDriverPool {
+public:
+    explicit UsbDriverPool(USBHost& host) {
+        for (int i = 0; i < N; i++) {
+            drivers[i] = new (storage[i]) Driver(host);
+        }
+    }
+
+    Driver& operator[](int index) { return *drivers[index]; }
+
+    // Pointers to every driver, in slot order
+    Driver** all() { return drivers; }
+
+    static int size() { return N; }
+
+private:
+    alignas(Driver) uint8_t storage[N][sizeof(Driver)];
+    Driver* drivers[N];
+};
+
+#endif
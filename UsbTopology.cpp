@@ -0,0 +1,25 @@
+#include "UsbTopology.h"
+
+uint32_t usbPortPath(uint8_t hubAddress, uint8_t hubPort, TopologyHub* const* hubs, int hubCount) {
+    uint32_t path = 0;
+    int shift = 0;
+
+    // Walk up towards the root, one tier per step (USB allows 5 hub tiers)
+    while (hubAddress != 0 && shift < 28) {
+        path |= (uint32_t)(hubPort & 0x0F) << shift;
+        shift += 4;
+
+        const TopologyHub* parent = nullptr;
+        for (int i = 0; i < hubCount; i++) {
+            if (hubs[i]->address() == hubAddress) {
+                parent = hubs[i];
+                break;
+            }
+        }
+        if (!parent) break;
+
+        hubAddress = parent->parentAddress();
+        hubPort = parent->parentPort();
+    }
+    return path;
+}
@@ -0,0 +1,27 @@
+#ifndef USB_TOPOLOGY_H
+#define USB_TOPOLOGY_H
+
+#include <USBHost_t36.h>
+
+// USB hub driver that reports where the hub sits on the bus, so devices
+// behind it can be told apart by physical port
+class TopologyHub : public USBHub {
+public:
+    TopologyHub(USBHost &host) : USBHub(host) {}
+
+    // USB address of this hub, 0 if nothing is attached
+    uint8_t address() const { return device ? device->address : 0; }
+
+    // Address of the hub this one is plugged into (0 = root port) and
+    // the port on it
+    uint8_t parentAddress() const { return device ? device->hub_address : 0; }
+    uint8_t parentPort() const { return device ? device->hub_port : 0; }
+};
+
+// Physical port path of a device plugged into port hubPort of the hub at
+// hubAddress: one nibble per hub tier, the device's own port lowest.
+// 0 for a device on the root port. Unlike USB addresses it doesn't depend
+// on enumeration order, so it survives power cycles.
+uint32_t usbPortPath(uint8_t hubAddress, uint8_t hubPort, TopologyHub* const* hubs, int hubCount);
+
+#endif
@@ -3,7 +3,8 @@
  *
  * A USB MIDI hub for Teensy 4.1 with configurable routing.
  * Routes MIDI between USB Host MIDI devices based on user-configured routes.
- * Computer connection is used for Serial configuration UI only.
+ * The computer connection carries the Serial configuration UI and, with
+ * COMPUTER_MIDI_PORT, a routable USB MIDI port.
  */
 
 #include <USBHost_t36.h>
@@ -26,72 +27,33 @@
 #include "DeviceManager.h"
 #include "RouteManager.h"
 #include "USBDeviceMonitor.h"
+#include "MidiStats.h"
+#include "MidiRouter.h"
+#include "ClockEngine.h"
+#include "UsbDriverPool.h"
 
 // USB Host objects
 USBHost myusb;
-USBHub hub1(myusb);
-USBHub hub2(myusb);
+UsbDriverPool<TopologyHub, USB_HUB_COUNT> hubs(myusb);
 
-// USB Host MIDI devices FIRST (so they get first chance to claim)
-#if MAX_MIDI_DEVICES >= 1
-MIDIDevice_BigBuffer midi1(myusb);
-#endif
-#if MAX_MIDI_DEVICES >= 2
-MIDIDevice_BigBuffer midi2(myusb);
-#endif
-#if MAX_MIDI_DEVICES >= 3
-MIDIDevice_BigBuffer midi3(myusb);
-#endif
-#if MAX_MIDI_DEVICES >= 4
-MIDIDevice_BigBuffer midi4(myusb);
-#endif
-#if MAX_MIDI_DEVICES >= 5
-MIDIDevice_BigBuffer midi5(myusb);
-#endif
-#if MAX_MIDI_DEVICES >= 6
-MIDIDevice_BigBuffer midi6(myusb);
-#endif
-#if MAX_MIDI_DEVICES >= 7
-MIDIDevice_BigBuffer midi7(myusb);
-#endif
-#if MAX_MIDI_DEVICES >= 8
-MIDIDevice_BigBuffer midi8(myusb);
-#endif
+// USB Host MIDI devices FIRST (so they get first chance to claim),
+// one per device slot
+UsbDriverPool<HubMidiDevice, HOST_DEVICE_SLOTS> midiDevices(myusb);
 
 // Catch-all LAST (only sees what MIDIDevices didn't claim)
 USBDeviceMonitor usbMonitor(myusb);
 
-// Array of host MIDI device pointers
-MIDIDevice_BigBuffer* midiDevices[] = {
-#if MAX_MIDI_DEVICES >= 1
-    &midi1,
-#endif
-#if MAX_MIDI_DEVICES >= 2
-    &midi2,
+#ifdef COMPUTER_MIDI_PORT
+// The Teensy's own USB port, in the last device slot
+ComputerMidiPort computerPort;
 #endif
-#if MAX_MIDI_DEVICES >= 3
-    &midi3,
-#endif
-#if MAX_MIDI_DEVICES >= 4
-    &midi4,
-#endif
-#if MAX_MIDI_DEVICES >= 5
-    &midi5,
-#endif
-#if MAX_MIDI_DEVICES >= 6
-    &midi6,
-#endif
-#if MAX_MIDI_DEVICES >= 7
-    &midi7,
-#endif
-#if MAX_MIDI_DEVICES >= 8
-    &midi8,
-#endif
-};
 
 // Core managers
 DeviceManager deviceManager;
 RouteManager routeManager;
+MidiStats midiStats;
+MidiRouter midiRouter(deviceManager, routeManager, midiStats);
+ClockEngine clockEngine(midiRouter, midiStats);
 
 // UI components
 #ifdef INPUT_QWIIC_TWIST
@@ -116,7 +78,11 @@ UIManager ui;
 enum class UIState {
     MAIN_MENU,
     SOURCE_LIST,
-    DEST_LIST
+    SOURCE_CABLE,
+    DEST_LIST,
+    DEST_CABLE,
+    ROUTE_SETTINGS,
+    STATS
 };
 
 UIState currentState = UIState::MAIN_MENU;
@@ -128,28 +94,51 @@ int selectedSourceSlot = -1;
 uint16_t selectedSourceVid = 0;
 uint16_t selectedSourcePid = 0;
 char selectedSourceName[32] = "";
+uint8_t selectedSourceCable = CABLE_ANY;
 int selectedDestSlot = -1;
 uint16_t selectedDestVid = 0;
 uint16_t selectedDestPid = 0;
 char selectedDestName[32] = "";
 
+// Cables offered by the cable picker (for the device just selected)
+int cablePickerCount = 0;
+
 // Cached device lists (to detect changes)
 int connectedSlots[MAX_MIDI_DEVICES];
 int connectedCount = 0;
 int availableSlots[MAX_MIDI_DEVICES];
 int availableCount = 0;
 
+// Route settings page: the route shown, and the field UP/DOWN change
+// (-1 while moving between rows). A change is applied on ENTER.
+int editRouteIndex = -1;
+int editField = -1;
+int routeSettingsCursor = 0;
+RouteFilter editFilter;
+RouteThin editThin;
+RouteTransform editTransform;
+
 // Timing
 unsigned long lastUiUpdate = 0;
+unsigned long lastStatsRefresh = 0;
+unsigned long lastStatsReport = 0;
 
 // Forward declarations
 void buildMainMenu();
 void buildSourceList();
 void buildDestList();
+void buildCableList(int cables);
+void buildStatsList();
+void buildRouteSettings();
 void buildConfirmRoute();
 void handleMainMenuInput(InputEvent event);
 void handleSourceListInput(InputEvent event);
 void handleDestListInput(InputEvent event);
+void handleCableInput(InputEvent event);
+void createRoute(uint8_t destCable);
+void openRouteSettings(int index);
+void handleStatsInput(InputEvent event);
+void handleRouteSettingsInput(InputEvent event);
 void handleConfirmRouteInput(InputEvent event);
 void refreshConnectedDevices();
 void refreshAvailableDevices();
@@ -158,11 +147,22 @@ void onCreateConfirm(bool confirmed);
 void updateLedForSelection();
 
 // Check if a route has a disconnected member
-bool isRouteIncomplete(const Route* route) {
-    if (!route) return false;
-    bool srcConnected = deviceManager.findDeviceByVidPid(route->sourceVid, route->sourcePid) >= 0;
-    bool dstConnected = deviceManager.findDeviceByVidPid(route->destVid, route->destPid) >= 0;
-    return !srcConnected || !dstConnected;
+bool isRouteIncomplete(int index) {
+    return index >= 0 && index < routeManager.getRouteCount() && !routeManager.isRouteConnected(index);
+}
+
+// Device name, with its serial tail or port appended if another connected
+// device has the same VID:PID
+const char* deviceLabel(int slot, char* buf, int size) {
+    const MidiDeviceInfo* info = deviceManager.getDeviceBySlot(slot);
+    if (!info) {
+        buf[0] = '\0';
+    } else if (deviceManager.hasDuplicate(slot)) {
+        snprintf(buf, size, "%s #%s", info->name, info->idLabel);
+    } else {
+        snprintf(buf, size, "%s", info->name);
+    }
+    return buf;
 }
 
 // Update LED color based on current selection (or off if sleeping)
@@ -173,17 +173,27 @@ void updateLedForSelection() {
         return;
     }
 
+#if defined(LED_ROUTE_SUMMARY)
+    // Red while any route has a device missing
+    if (!routeManager.allRoutesConnected()) {
+        input->setColor(60, 0, 0);
+        return;
+    }
+#else
     if (currentState == UIState::MAIN_MENU) {
         ListView& list = ui.getList();
-        if (list.selectedIndex > 0) {
+        if (list.selectedIndex > 0 && list.selectedIndex < list.count - 1) {
             // On a route - check if incomplete
-            const Route* route = routeManager.getRoute(list.selectedIndex - 1);
-            if (isRouteIncomplete(route)) {
+            if (isRouteIncomplete(list.selectedIndex - 1)) {
                 input->setColor(60, 0, 0);  // Red for incomplete
                 return;
             }
         }
+    } else if (currentState == UIState::ROUTE_SETTINGS && isRouteIncomplete(editRouteIndex)) {
+        input->setColor(60, 0, 0);
+        return;
     }
+#endif
     // Default: dim blue
     input->setColor(0, 0, 30);
 }
@@ -203,6 +213,11 @@ void onMidiConnectionChange(int slot, bool connected) {
         ui.showToast("- device");
     }
 
+    // Counters and stream state belong to the device that was in the slot
+    midiStats.resetSlot(slot);
+    midiRouter.resetSlot(slot);
+    clockEngine.resetSlot(slot);
+
     // Refresh list on device change
     needsListRebuild = true;
 }
@@ -241,13 +256,26 @@ void setup() {
 #endif
 
     // Initialize device manager
-    deviceManager.init(midiDevices, MAX_MIDI_DEVICES);
+    deviceManager.init(midiDevices.all(), midiDevices.size());
+#ifdef COMPUTER_MIDI_PORT
+    deviceManager.setComputerPort(&computerPort);
+#endif
+    deviceManager.setHubs(hubs.all(), hubs.size());
     deviceManager.setConnectionCallback(onMidiConnectionChange);
 
+    // Forward SysEx as it arrives instead of buffering whole messages
+    midiRouter.begin();
+    midiRouter.setClockEngine(&clockEngine);
+
+#ifdef BENCH_FANOUT
+    midiRouter.benchmarkFanout(Serial);
+#endif
+
     // Set up USB monitor for non-MIDI devices and overflow
     usbMonitor.setCallback(onUSBDeviceEvent);
 
     // Load saved routes from EEPROM
+    routeManager.setDeviceManager(&deviceManager);
     routeManager.load();
 
     // Set up UI
@@ -256,22 +284,59 @@ void setup() {
     // Initialize USB Host
     myusb.begin();
 
+    // Route from a timer interrupt so latency doesn't depend on loop()
+    if (MIDI_DISPATCH_US > 0) {
+        midiRouter.beginDispatch(MIDI_DISPATCH_US);
+    }
+
+    // Clock distribution
+#if defined(CLOCK_INTERNAL)
+    clockEngine.setMode(ClockMode::INTERNAL);
+#elif defined(CLOCK_REGENERATE)
+    clockEngine.setMode(ClockMode::REGENERATE);
+#endif
+
     Serial.println("Teensy MIDI Hub - Configurable Routing");
     Serial.println("======================================");
     Serial.print("Loaded ");
     Serial.print(routeManager.getRouteCount());
     Serial.println(" routes from EEPROM");
+
+    // An older layout converted with more routes than the EEPROM now saves
+    int saved = routeManager.getSavedCapacity();
+    if (routeManager.getRouteCount() > saved) {
+        Serial.print("WARNING: only the first ");
+        Serial.print(saved);
+        Serial.println(" routes fit the EEPROM; the rest (marked *) are lost on power-off");
+        ui.showToast("Routes unsaved!");
+    }
     Serial.println();
 }
 
 void loop() {
+    uint32_t loopStart = MidiStats::cycles();
+
+    // USB enumeration and device/route table changes must not race the
+    // routing interrupt
+    midiRouter.lock();
     myusb.Task();
 
     // Update device manager (handles connect/disconnect)
-    deviceManager.update();
+    if (deviceManager.update()) {
+        routeManager.rebuildRouteTable();
+    }
+    midiRouter.unlock();
 
-    // Route MIDI between devices
-    routeMidi();
+    // Route MIDI between devices (unless the timer interrupt does it)
+    if (!midiRouter.isDispatching()) {
+        midiRouter.route();
+    }
+#ifdef COMPUTER_MIDI_PORT
+    computerPort.service();
+#endif
+
+    // Push one short slice of any pending display update
+    ui.service();
 
     // Handle UI updates at fixed rate
     unsigned long now = millis();
@@ -294,6 +359,10 @@ void loop() {
             if (availableCount != oldCount) {
                 needsListRebuild = true;
             }
+        } else if (currentState == UIState::STATS) {
+            if (now - lastStatsRefresh >= STATS_REFRESH_MS) {
+                needsListRebuild = true;
+            }
         }
 
         // Rebuild list if needed
@@ -302,14 +371,18 @@ void loop() {
                 case UIState::MAIN_MENU:    buildMainMenu(); break;
                 case UIState::SOURCE_LIST:  buildSourceList(); break;
                 case UIState::DEST_LIST:    buildDestList(); break;
+                case UIState::SOURCE_CABLE: buildCableList(cablePickerCount); break;
+                case UIState::DEST_CABLE:   buildCableList(cablePickerCount); break;
+                case UIState::ROUTE_SETTINGS: buildRouteSettings(); break;
+                case UIState::STATS:        buildStatsList(); break;
             }
             needsListRebuild = false;
             updateLedForSelection();
             ui.requestRedraw();
         }
 
-        // Check for input
-        if (input->hasInput()) {
+        // Check for input (a fast encoder turn can queue several steps)
+        while (input->hasInput()) {
             InputEvent event = input->getInput();
 
             // Wake from sleep on any input
@@ -317,9 +390,17 @@ void loop() {
             ui.activity();
 
             if (wasSleeping) {
-                // Just woke up - restore LED and skip processing this input
+                // Just woke up - restore LED and skip this input (and the
+                // rest of the turn that woke it)
                 updateLedForSelection();
+                while (input->hasInput()) {
+                    input->getInput();
+                }
+                break;
             } else {
+                // Input handlers may add or remove routes
+                midiRouter.lock();
+
                 // Let UI manager handle confirmation dialog first
                 if (ui.handleInput(event)) {
                     // Input was consumed by confirmation
@@ -329,8 +410,17 @@ void loop() {
                         case UIState::MAIN_MENU:    handleMainMenuInput(event); break;
                         case UIState::SOURCE_LIST:  handleSourceListInput(event); break;
                         case UIState::DEST_LIST:    handleDestListInput(event); break;
+                        case UIState::SOURCE_CABLE: handleCableInput(event); break;
+                        case UIState::DEST_CABLE:   handleCableInput(event); break;
+                        case UIState::ROUTE_SETTINGS: handleRouteSettingsInput(event); break;
+                        case UIState::STATS:        handleStatsInput(event); break;
                     }
                 }
+
+                midiRouter.unlock();
+
+                // Their EEPROM writes run with routing going on
+                routeManager.savePending();
             }
         }
 
@@ -345,80 +435,416 @@ void loop() {
         ui.render();
     }
 
+    // Periodic stats report (the serial UI owns the terminal)
+#ifndef UI_SERIAL
+    if (STATS_REPORT_MS > 0 && millis() - lastStatsReport >= STATS_REPORT_MS) {
+        lastStatsReport = millis();
+        midiStats.print(Serial);
+    }
+#endif
+
     // Heartbeat LED
     static unsigned long lastBlink = 0;
     if (millis() - lastBlink >= 1000) {
         lastBlink = millis();
         digitalToggle(LED_BUILTIN);
     }
+
+    midiStats.recordLoop(MidiStats::cycles() - loopStart);
 }
 
 // ============================================
 // List Building Functions
 // ============================================
 
-// Static buffers for menu item text (needed because ListView stores pointers)
-static char menuBuf[MAX_LIST_ITEMS][32];
-
-void buildMainMenu() {
-    ListView& list = ui.getList();
-    list.clear();
+// "src>dst", with ":N" port suffixes on cable-specific ends. Returns the
+// snprintf length.
+int formatRouteName(char* buf, int size, const Route* route) {
+    char srcPort[4] = "";
+    char dstPort[4] = "";
+    if (route->sourceCable != CABLE_ANY) {
+        snprintf(srcPort, sizeof(srcPort), ":%d", route->sourceCable + 1);
+    }
+    if (route->destCable != CABLE_ANY) {
+        snprintf(dstPort, sizeof(dstPort), ":%d", route->destCable + 1);
+    }
+    return snprintf(buf, size, "%s%s>%s%s", route->sourceName, srcPort, route->destName, dstPort);
+}
 
-    // First item: "routes" centered with "+" on right
-    list.add(nullptr, "routes", "+");
+// Row providers: the list only asks for the rows it's showing
 
-    // Existing routes (left-justified)
+void mainMenuRow(int index, ListItem& item, char* buf) {
     int routeCount = routeManager.getRouteCount();
-    for (int i = 0; i < routeCount && list.count < MAX_LIST_ITEMS; i++) {
-        const Route* route = routeManager.getRoute(i);
-        snprintf(menuBuf[list.count], sizeof(menuBuf[0]), "%s>%s", route->sourceName, route->destName);
-        list.add(menuBuf[list.count], nullptr, nullptr);
+    if (index == 0) {
+        // First item: "routes" centered with "+" on right
+        item.center = "routes";
+        item.right = "+";
+    } else if (index > routeCount) {
+        // Last item: stats page
+        item.center = "stats";
+    } else {
+        // Existing routes (left-justified), "*" on ones past what the
+        // EEPROM can save
+        int route = index - 1;
+        int marker = routeManager.isRouteSaved(route) ? 0 : snprintf(buf, LIST_ROW_TEXT, "*");
+        formatRouteName(buf + marker, LIST_ROW_TEXT - marker, routeManager.getRoute(route));
+        item.left = buf;
     }
+}
 
-    // Set cursor position (clamped to valid range)
-    if (mainMenuCursor >= list.count) {
-        mainMenuCursor = list.count - 1;
+void sourceRow(int index, ListItem& item, char* buf) {
+    if (index == 0) {
+        // First item: back
+        item.left = "<";
+        item.center = "sources";
+    } else {
+        // Connected devices (left-justified)
+        item.left = deviceLabel(connectedSlots[index - 1], buf, LIST_ROW_TEXT);
     }
-    if (mainMenuCursor < 0) {
-        mainMenuCursor = 0;
+}
+
+void destRow(int index, ListItem& item, char* buf) {
+    if (index == 0) {
+        // First item: back
+        item.left = "<";
+        item.center = "sinks";
+    } else {
+        // Available destinations (left-justified)
+        item.left = deviceLabel(availableSlots[index - 1], buf, LIST_ROW_TEXT);
     }
-    list.selectedIndex = mainMenuCursor;
 }
 
-void buildSourceList() {
-    refreshConnectedDevices();
+// Slots shown on the stats page (connected when the page was built)
+int statsSlots[MAX_MIDI_DEVICES];
+int statsSlotCount = 0;
 
-    ListView& list = ui.getList();
-    list.clear();
+void statsRow(int index, ListItem& item, char* buf) {
+    if (index == 0) {
+        // First item: back
+        item.left = "<";
+        item.center = "stats";
+        return;
+    }
+    item.left = buf;
 
-    // First item: back
-    list.add("<", "sources", nullptr);
+    if (index == 1) {
+        snprintf(buf, LIST_ROW_TEXT, "loop max %luus p99<%luus",
+                 (unsigned long)midiStats.getLoopMaxMicros(),
+                 (unsigned long)midiStats.getLoopPercentileMicros(99));
+        return;
+    }
+
+    if (index == 2) {
+        // Clock tempo and jitter in (as received) / out (as sent)
+        unsigned long tenths = (unsigned long)(clockEngine.getBpm() * 10 + 0.5f);
+        snprintf(buf, LIST_ROW_TEXT, "clock %lu.%lubpm jit %lu/%luus out %lu/%luus",
+                 tenths / 10, tenths % 10,
+                 (unsigned long)midiStats.getClockInJitterAvgMicros(),
+                 (unsigned long)midiStats.getClockInJitterMaxMicros(),
+                 (unsigned long)midiStats.getClockOutJitterAvgMicros(),
+                 (unsigned long)midiStats.getClockOutJitterMaxMicros());
+        return;
+    }
+
+    // Per device: traffic, most messages read in one pass, output queue
+    // overflows, SysEx turned away while busy with another source's, and
+    // read-to-send latency
+    index -= 3;
+    if (index < statsSlotCount) {
+        int slot = statsSlots[index];
+        const MidiDeviceInfo* info = deviceManager.getDeviceBySlot(slot);
+        const SlotStats& s = midiStats.getSlot(slot);
+        snprintf(buf, LIST_ROW_TEXT, "%s rx%lu tx%lu sx%lu bst%lu drop%lu ovf%lu sxb%lu lat%lu/%luus",
+                 info ? info->name : "?", (unsigned long)s.rxMessages, (unsigned long)s.txMessages,
+                 (unsigned long)s.sysexCount, (unsigned long)s.maxDrained,
+                 (unsigned long)s.dropped, (unsigned long)s.outputDropped, (unsigned long)s.sysexBlocked,
+                 (unsigned long)midiStats.getLatencyAvgMicros(slot),
+                 (unsigned long)midiStats.getLatencyMaxMicros(slot));
+        return;
+    }
 
-    // Connected devices (left-justified)
-    for (int i = 0; i < connectedCount && list.count < MAX_LIST_ITEMS; i++) {
-        const MidiDeviceInfo* info = deviceManager.getDeviceBySlot(connectedSlots[i]);
-        if (info) {
-            list.add(info->name, nullptr, nullptr);
+    // Per route: messages forwarded between the connected endpoints
+    const Route* route = routeManager.getRoute(index - statsSlotCount);
+    if (!route) return;
+    uint32_t forwarded = 0;
+    SlotMask srcSlots = deviceManager.findSlots(route->sourceVid, route->sourcePid, route->sourceTag);
+    SlotMask dstSlots = deviceManager.findSlots(route->destVid, route->destPid, route->destTag);
+    for (SlotMask s = srcSlots; s; s &= s - 1) {
+        for (SlotMask d = dstSlots; d; d &= d - 1) {
+            forwarded += midiStats.getRouteMessages(__builtin_ctz(s), __builtin_ctz(d));
         }
     }
+    int length = formatRouteName(buf, LIST_ROW_TEXT, route);
+    if (length < LIST_ROW_TEXT) {
+        snprintf(buf + length, LIST_ROW_TEXT - length, " %lu", (unsigned long)forwarded);
+    }
+}
+
+void cableRow(int index, ListItem& item, char* buf) {
+    bool source = (currentState == UIState::SOURCE_CABLE);
+    if (index == 0) {
+        // First item: back
+        item.left = "<";
+        item.center = source ? "in port" : "out port";
+    } else if (index == 1) {
+        // Every cable / the source's own cable
+        item.left = source ? "all" : "same";
+    } else {
+        // Ports are numbered from 1, cables from 0
+        snprintf(buf, LIST_ROW_TEXT, "port %d", index - 1);
+        item.left = buf;
+    }
+}
+
+// Route settings rows after the header
+enum RouteField {
+    FIELD_CHANNEL,     // Filter: input channel
+    FIELD_TYPES,       // Filter: message types
+    FIELD_RANGE_LOW,   // Filter: note/CC number range
+    FIELD_RANGE_HIGH,
+    FIELD_THIN,        // Controller thinning interval
+    FIELD_OUT_CHANNEL, // Transform: output channel
+    FIELD_TRANSPOSE,   // Transform: semitones
+    FIELD_NOTE_LOW,    // Transform: note clamp range
+    FIELD_NOTE_HIGH,
+    FIELD_VELOCITY,    // Transform: velocity curve
+    FIELD_VELOCITY_AMOUNT,
+    FIELD_CC_FROM,     // Transform: CC remap
+    FIELD_CC_TO,
+    FIELD_DELETE,
+    FIELD_COUNT
+};
+
+// Message type filter choices
+struct TypeChoice {
+    const char* name;
+    uint16_t mask;
+};
+
+const TypeChoice typeChoices[] = {
+    {"all",   FILTER_ALL_TYPES},
+    {"notes", FILTER_NOTE_OFF | FILTER_NOTE_ON},
+    {"voice", FILTER_SYSEX - 1},  // Channel messages
+    {"sync",  FILTER_CLOCK | FILTER_TRANSPORT},
+    {"-sync", FILTER_ALL_TYPES & ~(FILTER_CLOCK | FILTER_TRANSPORT)},
+    {"-sx",   FILTER_ALL_TYPES & ~FILTER_SYSEX},
+};
+const int TYPE_CHOICES = sizeof(typeChoices) / sizeof(typeChoices[0]);
+
+// Controller thinning intervals (ms), 0 = off
+const uint8_t thinChoices[] = {0, 5, 10, 20, 50, 100, 200};
+const int THIN_CHOICES = sizeof(thinChoices) / sizeof(thinChoices[0]);
+
+// Index of the first thinChoices interval at least intervalMs
+int thinChoice(uint8_t intervalMs) {
+    int i = 0;
+    while (i < THIN_CHOICES - 1 && thinChoices[i] < intervalMs) i++;
+    return i;
+}
+
+// Index in typeChoices, or -1 for a mask that isn't one of them
+int typeChoice(uint16_t mask) {
+    for (int i = 0; i < TYPE_CHOICES; i++) {
+        if (typeChoices[i].mask == mask) return i;
+    }
+    return -1;
+}
+
+// Filter channel 1-16, 0 for all
+int filterChannel(const RouteFilter& filter) {
+    if (filter.channelMask == 0xFFFF || filter.channelMask == 0) return 0;
+    return __builtin_ctz(filter.channelMask) + 1;
+}
+
+int stepClamped(int value, int step, int low, int high) {
+    value += step;
+    return value < low ? low : (value > high ? high : value);
+}
+
+int stepWrapped(int value, int step, int count) {
+    return ((value + step) % count + count) % count;
+}
+
+void formatRouteField(int field, char* buf, int size) {
+    switch (field) {
+        case FIELD_CHANNEL: {
+            int channel = filterChannel(editFilter);
+            if (channel) {
+                snprintf(buf, size, "%d", channel);
+            } else {
+                snprintf(buf, size, "all");
+            }
+            break;
+        }
+        case FIELD_TYPES: {
+            int choice = typeChoice(editFilter.typeMask);
+            snprintf(buf, size, "%s", choice >= 0 ? typeChoices[choice].name : "?");
+            break;
+        }
+        case FIELD_RANGE_LOW:  snprintf(buf, size, "%d", editFilter.rangeLow); break;
+        case FIELD_RANGE_HIGH: snprintf(buf, size, "%d", editFilter.rangeHigh); break;
+        case FIELD_OUT_CHANNEL:
+            if (editTransform.channel) {
+                snprintf(buf, size, "%d", editTransform.channel);
+            } else {
+                snprintf(buf, size, "same");
+            }
+            break;
+        case FIELD_TRANSPOSE:  snprintf(buf, size, "%+d", editTransform.transpose); break;
+        case FIELD_NOTE_LOW:   snprintf(buf, size, "%d", editTransform.noteLow); break;
+        case FIELD_NOTE_HIGH:  snprintf(buf, size, "%d", editTransform.noteHigh); break;
+        case FIELD_VELOCITY: {
+            static const char* const curves[] = {"lin", "soft", "hard", "fixed"};
+            snprintf(buf, size, "%s", curves[editTransform.velocityCurve & 3]);
+            break;
+        }
+        case FIELD_VELOCITY_AMOUNT: snprintf(buf, size, "%d", editTransform.velocityAmount); break;
+        case FIELD_CC_FROM:
+            if (editTransform.ccFrom <= 127) {
+                snprintf(buf, size, "%d", editTransform.ccFrom);
+            } else {
+                snprintf(buf, size, "off");
+            }
+            break;
+        case FIELD_CC_TO:      snprintf(buf, size, "%d", editTransform.ccTo); break;
+        case FIELD_THIN:
+            if (editThin.isActive()) {
+                snprintf(buf, size, "%dms", editThin.intervalMs);
+            } else {
+                snprintf(buf, size, "off");
+            }
+            break;
+        default:               buf[0] = '\0'; break;
+    }
+}
+
+// Change a field of the edited copy by one step
+void stepRouteField(int field, int step) {
+    switch (field) {
+        case FIELD_CHANNEL: {
+            int channel = stepWrapped(filterChannel(editFilter), step, 17);
+            editFilter.channelMask = channel ? (uint16_t)(1 << (channel - 1)) : 0xFFFF;
+            break;
+        }
+        case FIELD_TYPES: {
+            int choice = typeChoice(editFilter.typeMask);
+            choice = choice < 0 ? 0 : stepWrapped(choice, step, TYPE_CHOICES);
+            editFilter.typeMask = typeChoices[choice].mask;
+            break;
+        }
+        case FIELD_RANGE_LOW:
+            editFilter.rangeLow = (uint8_t)stepClamped(editFilter.rangeLow, step, 0, editFilter.rangeHigh);
+            break;
+        case FIELD_RANGE_HIGH:
+            editFilter.rangeHigh = (uint8_t)stepClamped(editFilter.rangeHigh, step, editFilter.rangeLow, 127);
+            break;
+        case FIELD_THIN:
+            editThin.intervalMs = thinChoices[stepClamped(thinChoice(editThin.intervalMs), step, 0, THIN_CHOICES - 1)];
+            editThin.typeMask = THIN_ALL_TYPES;
+            break;
+        case FIELD_OUT_CHANNEL:
+            editTransform.channel = (uint8_t)stepWrapped(editTransform.channel, step, 17);
+            break;
+        case FIELD_TRANSPOSE:
+            editTransform.transpose = (int8_t)stepClamped(editTransform.transpose, step, -48, 48);
+            break;
+        case FIELD_NOTE_LOW:
+            editTransform.noteLow = (uint8_t)stepClamped(editTransform.noteLow, step, 0, editTransform.noteHigh);
+            break;
+        case FIELD_NOTE_HIGH:
+            editTransform.noteHigh = (uint8_t)stepClamped(editTransform.noteHigh, step, editTransform.noteLow, 127);
+            break;
+        case FIELD_VELOCITY:
+            editTransform.velocityCurve = (uint8_t)stepWrapped(editTransform.velocityCurve, step, VELOCITY_FIXED + 1);
+            break;
+        case FIELD_VELOCITY_AMOUNT:
+            editTransform.velocityAmount = (uint8_t)stepClamped(editTransform.velocityAmount, step, 0, 127);
+            break;
+        case FIELD_CC_FROM: {
+            // Off sits below CC 0
+            int cc = editTransform.ccFrom <= 127 ? editTransform.ccFrom : -1;
+            cc = stepClamped(cc, step, -1, 127);
+            editTransform.ccFrom = cc < 0 ? CC_REMAP_OFF : (uint8_t)cc;
+            break;
+        }
+        case FIELD_CC_TO:
+            editTransform.ccTo = (uint8_t)stepClamped(editTransform.ccTo, step, 0, 127);
+            break;
+    }
+}
+
+// Hand a changed field's settings to the route manager
+void applyRouteField(int field) {
+    if (field <= FIELD_RANGE_HIGH) {
+        routeManager.setRouteFilter(editRouteIndex, editFilter);
+    } else if (field == FIELD_THIN) {
+        routeManager.setRouteThin(editRouteIndex, editThin);
+    } else if (field < FIELD_DELETE) {
+        routeManager.setRouteTransform(editRouteIndex, editTransform);
+    }
+}
+
+void routeSettingsRow(int index, ListItem& item, char* buf) {
+    static const char* const labels[FIELD_COUNT] = {
+        "chan", "pass", "min", "max", "thin",
+        "out ch", "trans", "n min", "n max", "vel", "amount", "cc", "cc to", "delete"
+    };
+    if (index == 0) {
+        // First item: back
+        item.left = "<";
+        item.center = "route";
+        return;
+    }
+    int field = index - 1;
+    item.left = labels[field];
+    if (field == FIELD_DELETE) return;
+
+    // The field being changed shows in brackets
+    char value[8];
+    formatRouteField(field, value, sizeof(value));
+    snprintf(buf, LIST_ROW_TEXT, field == editField ? "[%s]" : "%s", value);
+    item.right = buf;
+}
+
+void buildMainMenu() {
+    // Header, routes, stats; the cursor is clamped to the new length
+    ListView& list = ui.getList();
+    list.setRows(mainMenuRow, routeManager.getRouteCount() + 2, mainMenuCursor);
+    mainMenuCursor = list.selectedIndex;
+}
+
+void buildSourceList() {
+    refreshConnectedDevices();
+    ui.getList().setRows(sourceRow, connectedCount + 1, 0);
 }
 
 void buildDestList() {
     refreshAvailableDevices();
+    ui.getList().setRows(destRow, availableCount + 1, 0);
+}
 
-    ListView& list = ui.getList();
-    list.clear();
+void buildCableList(int cables) {
+    ui.getList().setRows(cableRow, cables + 2, 1);
+}
 
-    // First item: back
-    list.add("<", "sinks", nullptr);
+void buildStatsList() {
+    ListView& list = ui.getList();
+    lastStatsRefresh = millis();
 
-    // Available destinations (left-justified)
-    for (int i = 0; i < availableCount && list.count < MAX_LIST_ITEMS; i++) {
-        const MidiDeviceInfo* info = deviceManager.getDeviceBySlot(availableSlots[i]);
-        if (info) {
-            list.add(info->name, nullptr, nullptr);
+    statsSlotCount = 0;
+    for (int slot = 0; slot < MAX_MIDI_DEVICES; slot++) {
+        const MidiDeviceInfo* info = deviceManager.getDeviceBySlot(slot);
+        if (info && info->connected) {
+            statsSlots[statsSlotCount++] = slot;
         }
     }
+
+    // Keep the cursor across refreshes
+    list.setRows(statsRow, 3 + statsSlotCount + routeManager.getRouteCount(), list.selectedIndex);
+}
+
+void buildRouteSettings() {
+    ui.getList().setRows(routeSettingsRow, FIELD_COUNT + 1, routeSettingsCursor);
 }
 
 // ============================================
@@ -451,10 +877,16 @@ void handleMainMenuInput(InputEvent event) {
                 // +Route selected - go to source selection
                 currentState = UIState::SOURCE_LIST;
                 needsListRebuild = true;
+            } else if (list.selectedIndex == list.count - 1) {
+                // Stats selected - also dump the full report to Serial
+                currentState = UIState::STATS;
+                needsListRebuild = true;
+#ifndef UI_SERIAL
+                midiStats.print(Serial);
+#endif
             } else {
-                // Route selected - confirm delete
-                deleteRouteIndex = list.selectedIndex - 1;
-                ui.showConfirmation("delete?", "yes", "no", onDeleteConfirm);
+                // Route selected - open its settings
+                openRouteSettings(list.selectedIndex - 1);
             }
             break;
 
@@ -467,6 +899,7 @@ void onDeleteConfirm(bool confirmed) {
     if (confirmed && deleteRouteIndex >= 0) {
         routeManager.removeRouteByIndex(deleteRouteIndex);
         ui.showToast("- route");
+        currentState = UIState::MAIN_MENU;
     }
     deleteRouteIndex = -1;
     needsListRebuild = true;
@@ -499,10 +932,12 @@ void handleSourceListInput(InputEvent event) {
                     selectedSourceSlot = slot;
                     selectedSourceVid = info->vid;
                     selectedSourcePid = info->pid;
-                    strncpy(selectedSourceName, info->name, sizeof(selectedSourceName) - 1);
-                    selectedSourceName[sizeof(selectedSourceName) - 1] = '\0';
+                    deviceLabel(slot, selectedSourceName, sizeof(selectedSourceName));
+                    selectedSourceCable = CABLE_ANY;
 
-                    currentState = UIState::DEST_LIST;
+                    // Multi-port devices pick a port next
+                    cablePickerCount = deviceManager.getInputCables(slot);
+                    currentState = (cablePickerCount > 1) ? UIState::SOURCE_CABLE : UIState::DEST_LIST;
                     needsListRebuild = true;
                 }
             }
@@ -533,29 +968,23 @@ void handleDestListInput(InputEvent event) {
                 currentState = UIState::SOURCE_LIST;
                 needsListRebuild = true;
             } else if (list.selectedIndex - 1 < availableCount) {
-                // Device selected - create route immediately
+                // Device selected
                 int slot = availableSlots[list.selectedIndex - 1];
                 const MidiDeviceInfo* info = deviceManager.getDeviceBySlot(slot);
                 if (info) {
-                    bool added = routeManager.addRoute(
-                        selectedSourceVid, selectedSourcePid, selectedSourceName,
-                        info->vid, info->pid, info->name
-                    );
-
-                    if (added) {
-                        ui.showToast("+ route");
-                        // Set cursor to the newly created route (it's the last one)
-                        mainMenuCursor = routeManager.getRouteCount();  // +1 for header row
-                    } else if (routeManager.getRouteCount() >= MAX_ROUTES) {
-                        ui.showToast("Max routes!");
-                        mainMenuCursor = 0;
+                    selectedDestSlot = slot;
+                    selectedDestVid = info->vid;
+                    selectedDestPid = info->pid;
+                    deviceLabel(slot, selectedDestName, sizeof(selectedDestName));
+
+                    // Multi-port devices pick a port, others get the route now
+                    cablePickerCount = deviceManager.getOutputCables(slot);
+                    if (cablePickerCount > 1) {
+                        currentState = UIState::DEST_CABLE;
+                        needsListRebuild = true;
                     } else {
-                        ui.showToast("Route exists");
-                        mainMenuCursor = 0;
+                        createRoute(CABLE_ANY);
                     }
-
-                    currentState = UIState::MAIN_MENU;
-                    needsListRebuild = true;
                 }
             }
             break;
@@ -565,68 +994,193 @@ void handleDestListInput(InputEvent event) {
     }
 }
 
-// ============================================
-// Helper Functions
-// ============================================
+void handleCableInput(InputEvent event) {
+    ListView& list = ui.getList();
+    bool source = (currentState == UIState::SOURCE_CABLE);
 
-void refreshConnectedDevices() {
-    connectedCount = 0;
-    for (int i = 0; i < MAX_MIDI_DEVICES; i++) {
-        if (deviceManager.isConnected(i)) {
-            connectedSlots[connectedCount++] = i;
+    switch (event) {
+        case InputEvent::UP:
+            list.selectPrev();
+            ui.requestRedraw();
+            break;
+
+        case InputEvent::DOWN:
+            list.selectNext();
+            ui.requestRedraw();
+            break;
+
+        case InputEvent::ENTER: {
+            if (list.selectedIndex == 0) {
+                // Back selected
+                currentState = source ? UIState::SOURCE_LIST : UIState::DEST_LIST;
+                needsListRebuild = true;
+                break;
+            }
+
+            uint8_t cable = (list.selectedIndex == 1) ? CABLE_ANY : (uint8_t)(list.selectedIndex - 2);
+            if (source) {
+                selectedSourceCable = cable;
+                currentState = UIState::DEST_LIST;
+                needsListRebuild = true;
+            } else {
+                createRoute(cable);
+            }
+            break;
         }
+
+        default:
+            break;
     }
 }
 
-void refreshAvailableDevices() {
-    availableCount = 0;
-    for (int i = 0; i < MAX_MIDI_DEVICES; i++) {
-        // Exclude the source device
-        if (i != selectedSourceSlot && deviceManager.isConnected(i)) {
-            availableSlots[availableCount++] = i;
-        }
+// Add the route picked in the source/dest screens and return to the menu
+void createRoute(uint8_t destCable) {
+    // Bind to the picked units, so identical devices get their own routes
+    Route route;
+    route.sourceVid = selectedSourceVid;
+    route.sourcePid = selectedSourcePid;
+    route.sourceTag = deviceManager.getBindingTag(selectedSourceSlot);
+    route.sourceCable = selectedSourceCable;
+    route.destVid = selectedDestVid;
+    route.destPid = selectedDestPid;
+    route.destTag = deviceManager.getBindingTag(selectedDestSlot);
+    route.destCable = destCable;
+    strncpy(route.sourceName, selectedSourceName, sizeof(route.sourceName));
+    strncpy(route.destName, selectedDestName, sizeof(route.destName));
+
+    bool added = routeManager.addRoute(route);
+
+    if (added) {
+        bool saved = routeManager.isRouteSaved(routeManager.getRouteCount() - 1);
+        ui.showToast(saved ? "+ route" : "+ unsaved");
+        // Set cursor to the newly created route (it's the last one)
+        mainMenuCursor = routeManager.getRouteCount();  // +1 for header row
+    } else if (routeManager.getRouteCount() >= routeManager.getCapacity()) {
+        ui.showToast("Max routes!");
+        mainMenuCursor = 0;
+    } else {
+        ui.showToast("Route exists");
+        mainMenuCursor = 0;
     }
+
+    currentState = UIState::MAIN_MENU;
+    needsListRebuild = true;
 }
 
-void routeMidi() {
-    // Route from each connected host device
-    for (int srcSlot = 0; srcSlot < MAX_MIDI_DEVICES; srcSlot++) {
-        if (!deviceManager.isConnected(srcSlot)) continue;
+void handleStatsInput(InputEvent event) {
+    ListView& list = ui.getList();
 
-        MIDIDevice_BigBuffer* source = deviceManager.getMidiDevice(srcSlot);
-        if (!source->read()) continue;
+    switch (event) {
+        case InputEvent::UP:
+            list.selectPrev();
+            ui.requestRedraw();
+            break;
 
-        // Get MIDI message data
-        uint8_t type = source->getType();
-        uint8_t data1 = source->getData1();
-        uint8_t data2 = source->getData2();
-        uint8_t channel = source->getChannel();
-        uint8_t cable = source->getCable();
+        case InputEvent::DOWN:
+            list.selectNext();
+            ui.requestRedraw();
+            break;
 
-        // Get source device info for route lookup
-        const MidiDeviceInfo* srcInfo = deviceManager.getDeviceBySlot(srcSlot);
-        if (!srcInfo) continue;
+        case InputEvent::ENTER:
+            if (list.selectedIndex == 0) {
+                // Back selected
+                currentState = UIState::MAIN_MENU;
+                needsListRebuild = true;
+            }
+            break;
 
-        // Check each potential destination
-        for (int dstSlot = 0; dstSlot < MAX_MIDI_DEVICES; dstSlot++) {
-            if (dstSlot == srcSlot) continue;
-            if (!deviceManager.isConnected(dstSlot)) continue;
+        default:
+            break;
+    }
+}
 
-            const MidiDeviceInfo* dstInfo = deviceManager.getDeviceBySlot(dstSlot);
-            if (!dstInfo) continue;
+// Show a route's settings, starting on its first field
+void openRouteSettings(int index) {
+    const Route* route = routeManager.getRoute(index);
+    if (!route) return;
+    editRouteIndex = index;
+    editField = -1;
+    editFilter = route->filter;
+    editThin = route->thin;
+    editTransform = route->transform;
+    routeSettingsCursor = 1;
+    currentState = UIState::ROUTE_SETTINGS;
+    needsListRebuild = true;
+}
 
-            // Check if this route is configured
-            if (!routeManager.shouldRoute(srcInfo->vid, srcInfo->pid, dstInfo->vid, dstInfo->pid)) {
-                continue;
+void handleRouteSettingsInput(InputEvent event) {
+    ListView& list = ui.getList();
+
+    switch (event) {
+        case InputEvent::UP:
+            if (editField >= 0) {
+                stepRouteField(editField, -1);
+                list.refresh();
+            } else {
+                list.selectPrev();
+                routeSettingsCursor = list.selectedIndex;
             }
+            ui.requestRedraw();
+            break;
 
-            // Route the message
-            MIDIDevice_BigBuffer* dest = deviceManager.getMidiDevice(dstSlot);
-            if (type == 0xF0) {  // SystemExclusive
-                dest->sendSysEx(source->getSysExArrayLength(), source->getSysExArray(), true, cable);
+        case InputEvent::DOWN:
+            if (editField >= 0) {
+                stepRouteField(editField, 1);
+                list.refresh();
             } else {
-                dest->send(type, data1, data2, channel, cable);
+                list.selectNext();
+                routeSettingsCursor = list.selectedIndex;
             }
+            ui.requestRedraw();
+            break;
+
+        case InputEvent::ENTER:
+            if (editField >= 0) {
+                // Done changing the field
+                applyRouteField(editField);
+                editField = -1;
+                list.refresh();
+                ui.requestRedraw();
+            } else if (list.selectedIndex == 0) {
+                // Back selected
+                currentState = UIState::MAIN_MENU;
+                needsListRebuild = true;
+            } else if (list.selectedIndex - 1 == FIELD_DELETE) {
+                deleteRouteIndex = editRouteIndex;
+                ui.showConfirmation("delete?", "yes", "no", onDeleteConfirm);
+            } else {
+                editField = list.selectedIndex - 1;
+                list.refresh();
+                ui.requestRedraw();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+// ============================================
+// Helper Functions
+// ============================================
+
+void refreshConnectedDevices() {
+    connectedCount = 0;
+    for (int i = 0; i < MAX_MIDI_DEVICES; i++) {
+        if (deviceManager.isConnected(i)) {
+            connectedSlots[connectedCount++] = i;
+        }
+    }
+}
+
+void refreshAvailableDevices() {
+    availableCount = 0;
+    SlotMask outputSlots = deviceManager.getOutputSlots();
+    for (int i = 0; i < MAX_MIDI_DEVICES; i++) {
+        // Exclude the source device and devices that take no output
+        if (i != selectedSourceSlot && (outputSlots & (SlotMask)(1u << i))) {
+            availableSlots[availableCount++] = i;
         }
     }
 }
@@ -0,0 +1,49 @@
+#include "Check.h"
+#include <vector>
+
+namespace check {
+
+namespace {
+
+struct Test {
+    const char* name;
+    TestFunction function;
+};
+
+std::vector<Test>& tests() {
+    static std::vector<Test> list;
+    return list;
+}
+
+int failures = 0;
+
+}  // namespace
+
+Registrar::Registrar(const char* name, TestFunction function) {
+    tests().push_back(Test{name, function});
+}
+
+void fail(const char* file, int line, const char* expression) {
+    printf("%s:%d: check failed: %s\n", file, line, expression);
+    failures++;
+}
+
+void failEqual(const char* file, int line, const char* expression, long long actual, long long expected) {
+    printf("%s:%d: check failed: %s (got %lld, expected %lld)\n", file, line, expression, actual, expected);
+    failures++;
+}
+
+}  // namespace check
+
+int main() {
+    int failed = 0;
+    for (const check::Test& test : check::tests()) {
+        int before = check::failures;
+        test.function();
+        bool ok = check::failures == before;
+        printf("%s %s\n", ok ? "PASS" : "FAIL", test.name);
+        if (!ok) failed++;
+    }
+    printf("%d of %d tests failed\n", failed, (int)check::tests().size());
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,41 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Minimal test runner: TEST_CASE(name) { ... CHECK(...) ... } in a test
+// file, linked with Check.cpp for main(). A failed check reports and
+// carries on; the program exits non-zero if any failed.
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace check {
+
+typedef void (*TestFunction)();
+
+struct Registrar {
+    Registrar(const char* name, TestFunction function);
+};
+
+void fail(const char* file, int line, const char* expression);
+void failEqual(const char* file, int line, const char* expression, long long actual, long long expected);
+
+}  // namespace check
+
+#define TEST_CASE(name)                                            \
+    static void name();                                            \
+    static check::Registrar name##Registrar(#name, name);          \
+    static void name()
+
+#define CHECK(condition)                                           \
+    do {                                                           \
+        if (!(condition)) check::fail(__FILE__, __LINE__, #condition); \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                 \
+    do {                                                           \
+        long long a_ = (long long)(actual);                        \
+        long long e_ = (long long)(expected);                      \
+        if (a_ != e_) check::failEqual(__FILE__, __LINE__, #actual " == " #expected, a_, e_); \
+    } while (0)
+
+#endif
@@ -0,0 +1,139 @@
+#include "HubSim.h"
+
+HubSim* HubSim::current = nullptr;
+
+HubSim::Reset::Reset(bool keepEeprom) {
+    mock::reset();
+    if (!keepEeprom) mock::eraseEeprom();
+}
+
+HubSim::HubSim(unsigned long dispatchUs, bool keepEeprom)
+    : reset(keepEeprom), hubs(host), midi(host), router(devices, routes, stats), clock(router, stats) {
+    // As setup() does it
+    current = this;
+    devices.init(midi.all(), midi.size());
+    devices.setHubs(hubs.all(), hubs.size());
+    devices.setConnectionCallback(onConnectionChange);
+    router.begin();
+    router.setClockEngine(&clock);
+    routes.setDeviceManager(&devices);
+    routes.load();
+    host.begin();
+    if (dispatchUs > 0) {
+        router.beginDispatch(dispatchUs);
+    }
+}
+
+HubSim::~HubSim() {
+    for (Stream* s : streams) {
+        mock::cancelEvent(s->event);
+        delete s;
+    }
+    if (current == this) current = nullptr;
+}
+
+void HubSim::onConnectionChange(int slot, bool) {
+    // The sketch's onMidiConnectionChange(), without the UI
+    if (!current) return;
+    current->stats.resetSlot(slot);
+    current->router.resetSlot(slot);
+    current->clock.resetSlot(slot);
+}
+
+mock::UsbDevice* HubSim::plug(const mock::UsbDeviceSpec& spec) {
+    router.lock();
+    mock::UsbDevice* dev = mock::plug(spec);
+    router.unlock();
+    loop();
+    return dev;
+}
+
+void HubSim::unplug(mock::UsbDevice* dev) {
+    router.lock();
+    mock::unplug(dev);
+    router.unlock();
+    loop();
+}
+
+int HubSim::slotOf(const mock::UsbDevice* dev) const {
+    for (int slot = 0; slot < HOST_DEVICE_SLOTS; slot++) {
+        if (dev->driver && devices.getMidiDevice(slot) == dev->driver && devices.isConnected(slot)) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+bool HubSim::addRoute(const mock::UsbDevice* src, const mock::UsbDevice* dst,
+                      uint8_t sourceCable, uint8_t destCable) {
+    int srcSlot = slotOf(src);
+    int dstSlot = slotOf(dst);
+    if (srcSlot < 0 || dstSlot < 0) return false;
+
+    // As the sketch's createRoute() fills it in
+    Route route = {};
+    route.sourceVid = src->spec.vid;
+    route.sourcePid = src->spec.pid;
+    route.destVid = dst->spec.vid;
+    route.destPid = dst->spec.pid;
+    route.sourceTag = devices.getBindingTag(srcSlot);
+    route.destTag = devices.getBindingTag(dstSlot);
+    route.sourceCable = sourceCable;
+    route.destCable = destCable;
+    snprintf(route.sourceName, sizeof(route.sourceName), "%.23s", devices.getDeviceBySlot(srcSlot)->name);
+    snprintf(route.destName, sizeof(route.destName), "%.23s", devices.getDeviceBySlot(dstSlot)->name);
+
+    router.lock();
+    bool added = routes.addRoute(route);
+    router.unlock();
+    routes.savePending();
+    return added;
+}
+
+void HubSim::loop() {
+    router.lock();
+    host.Task();
+    if (devices.update()) {
+        routes.rebuildRouteTable();
+    }
+    router.unlock();
+
+    if (!router.isDispatching()) {
+        router.route();
+    }
+}
+
+void HubSim::run(uint64_t nanos, uint64_t loopUs) {
+    uint64_t end = mock::now() + nanos;
+    while (mock::now() < end) {
+        uint64_t next = mock::now() + loopUs * 1000;
+        mock::advanceTo(next < end ? next : end);
+        loop();
+    }
+}
+
+void HubSim::stream(mock::UsbDevice* dev, const std::vector<uint32_t>& packets,
+                    uint64_t start, uint64_t interval) {
+    Stream* s = new Stream{dev, packets, std::vector<uint64_t>(packets.size(), 0), 0, -1};
+    streams.push_back(s);
+    s->event = mock::scheduleEvent(start, interval, feed, s);
+}
+
+bool HubSim::streamsDone() const {
+    for (const Stream* s : streams) {
+        if (s->next < s->packets.size()) return false;
+    }
+    return true;
+}
+
+void HubSim::feed(void* context) {
+    Stream* s = (Stream*)context;
+    if (s->next >= s->packets.size()) {
+        mock::cancelEvent(s->event);
+        return;
+    }
+    if (mock::sendToHost(s->dev, s->packets[s->next])) {
+        s->sentAt[s->next] = mock::now();
+        s->next++;
+    }
+}
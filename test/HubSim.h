@@ -0,0 +1,88 @@
+#ifndef HUB_SIM_H
+#define HUB_SIM_H
+
+#include <USBHost_t36.h>
+#include <EEPROM.h>
+#include <vector>
+#include "Config.h"
+#include "DeviceManager.h"
+#include "RouteManager.h"
+#include "MidiStats.h"
+#include "MidiRouter.h"
+#include "ClockEngine.h"
+#include "UsbDriverPool.h"
+
+// The sketch's routing core on the host: the same objects setup() builds,
+// wired the same way, over mock USB devices on a simulated clock.
+// loop() is the routing part of the sketch's loop(); run() calls it at a
+// fixed cadence while timers (routing dispatch, the clock engine) and USB
+// frames fire in between, and scripted input streams feed devices.
+class HubSim {
+    // First member: a fresh clock and bus (and EEPROM) before any driver
+    // registers
+    struct Reset {
+        explicit Reset(bool keepEeprom);
+    } reset;
+
+public:
+    // dispatchUs > 0 routes from the timer interrupt, as with
+    // MIDI_DISPATCH_US; 0 routes from loop(). The EEPROM is erased unless
+    // keepEeprom (a power cycle).
+    explicit HubSim(unsigned long dispatchUs = 0, bool keepEeprom = false);
+    ~HubSim();
+
+    // Plug or unplug a device and run one loop() pass so it's picked up
+    mock::UsbDevice* plug(const mock::UsbDeviceSpec& spec);
+    void unplug(mock::UsbDevice* dev);
+
+    // Slot a device's driver holds, -1 if none
+    int slotOf(const mock::UsbDevice* dev) const;
+
+    // Add a route between two plugged-in devices, bound the way the UI
+    // binds them (getBindingTag())
+    bool addRoute(const mock::UsbDevice* src, const mock::UsbDevice* dst,
+                  uint8_t sourceCable = CABLE_ANY, uint8_t destCable = CABLE_ANY);
+
+    // One pass of the sketch's loop(): USB, device changes, routing
+    void loop();
+
+    // Run for a while, with a loop() pass every loopUs
+    void run(uint64_t nanos, uint64_t loopUs = 100);
+
+    // Send packets from a device at a fixed interval starting at start
+    // (ns). A full receive queue holds the stream back, as the device's
+    // endpoint would be NAKed; the packet goes at the next interval.
+    void stream(mock::UsbDevice* dev, const std::vector<uint32_t>& packets,
+                uint64_t start, uint64_t interval);
+
+    // Whether every stream has been sent
+    bool streamsDone() const;
+
+    // When each packet of stream n left its device (0 until sent)
+    const std::vector<uint64_t>& sentTimes(int n) const { return streams[n]->sentAt; }
+
+    USBHost host;
+    UsbDriverPool<TopologyHub, USB_HUB_COUNT> hubs;
+    UsbDriverPool<HubMidiDevice, HOST_DEVICE_SLOTS> midi;
+    DeviceManager devices;
+    RouteManager routes;
+    MidiStats stats;
+    MidiRouter router;
+    ClockEngine clock;
+
+private:
+    struct Stream {
+        mock::UsbDevice* dev;
+        std::vector<uint32_t> packets;
+        std::vector<uint64_t> sentAt;
+        size_t next;
+        int event;
+    };
+    std::vector<Stream*> streams;
+
+    static HubSim* current;
+    static void onConnectionChange(int slot, bool connected);
+    static void feed(void* context);
+};
+
+#endif
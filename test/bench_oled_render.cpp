@@ -0,0 +1,90 @@
+// Cost of one scroll step of the selected list row: blitting the
+// pre-rendered TextStrip, against redrawing the row with GFX text (what
+// the driver did before strips), in host time per frame. And the I2C
+// traffic of scroll frames through the driver, against a full display().
+
+#include "Check.h"
+#include "OLEDUIDriver.h"
+#include <chrono>
+#include <memory>
+
+static const int WIDTH = 128;
+static const int PAGES = 8;
+static const int ROW_HEIGHT = 16;
+static const char* const LABEL = "2 Launchpad Pro MK3 > Digitone and Syntakt";
+
+// Keeps the timed frames from being optimised away
+volatile uint8_t frameSink;
+
+template <class Draw> static double nanosPerFrame(Adafruit_SSD1306& gfx, int frames, Draw draw) {
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < frames; n++) {
+        gfx.fillRect(0, ROW_HEIGHT, WIDTH, ROW_HEIGHT, SSD1306_WHITE);
+        draw(n % 200);
+        frameSink = gfx.getBuffer()[WIDTH + 2 * WIDTH];
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+TEST_CASE(stripBlitAgainstTextRedraw) {
+    const int frames = 20000;
+    Adafruit_SSD1306 gfx(WIDTH, 64);
+    static TextStrip strip;
+    strip.render(&FreeMonoBold9pt7b, LABEL);
+
+    double blit = nanosPerFrame(gfx, frames, [&](int offset) {
+        strip.blit(gfx.getBuffer(), WIDTH, PAGES, 4 - offset, ROW_HEIGHT, 0, ROW_HEIGHT, WIDTH, ROW_HEIGHT, true);
+    });
+    double redraw = nanosPerFrame(gfx, frames, [&](int offset) {
+        gfx.setFont(&FreeMonoBold9pt7b);
+        gfx.setTextWrap(false);
+        gfx.setTextColor(SSD1306_BLACK);
+        gfx.setCursor(4 - offset, ROW_HEIGHT + 13);
+        gfx.print(LABEL);
+    });
+
+    printf("  scroll step: strip blit %.0f ns, GFX redraw %.0f ns (%.1fx)\n", blit, redraw, redraw / blit);
+    CHECK(blit < redraw);
+}
+
+static void listRow(int index, ListItem& item, char* buf) {
+    snprintf(buf, LIST_ROW_TEXT, "%d %s", index + 1, index == 1 ? LABEL + 2 : "Digitone");
+    item.left = buf;
+}
+
+TEST_CASE(scrollFrameBusTraffic) {
+    mock::resetClock();
+    mock::resetPanel();
+    std::unique_ptr<OLEDUIDriver> oled(new OLEDUIDriver());
+    CHECK(oled->begin());
+    uint32_t fullFrame = mock::i2cBytes();
+
+    ListView list;
+    list.setRows(listRow, 8, 1);
+    oled->beginFrame(oled->damageRect(DAMAGE_LIST, list));
+    oled->drawList(list);
+    oled->endFrame();
+    for (int i = 0; i < 100; i++) oled->service();
+
+    // Scroll steps, each sent before the next is due
+    const int steps = 40;
+    mock::advance(400 * 1000000ull);
+    uint32_t before = mock::i2cBytes();
+    uint32_t transmissionsBefore = mock::i2cTransmissions();
+    for (int n = 0; n < steps; n++) {
+        mock::advance(25 * 1000000ull);
+        oled->beginFrame(oled->damageRect(DAMAGE_SCROLL, list));
+        oled->drawList(list);
+        oled->endFrame();
+        for (int i = 0; i < 100; i++) oled->service();
+    }
+    double bytesPerStep = (double)(mock::i2cBytes() - before) / steps;
+    double transfersPerStep = (double)(mock::i2cTransmissions() - transmissionsBefore) / steps;
+
+    printf("  full display(): %u bytes; scroll step: %.0f bytes in %.1f transfers\n",
+           (unsigned)fullFrame, bytesPerStep, transfersPerStep);
+    // At most the row's two pages, as 16-byte chunks with their headers
+    CHECK(bytesPerStep > 0);
+    CHECK(bytesPerStep <= 2 * WIDTH + (2 * WIDTH / 16) * (1 + 8));
+    CHECK(bytesPerStep < fullFrame / 3);
+}
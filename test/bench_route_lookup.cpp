@@ -0,0 +1,111 @@
+// Per-message route lookup with every device slot populated: the compiled
+// route table routeMidi() uses now, against the scan it replaced (for
+// each other connected slot, a linear search of the routes for a matching
+// VID:PID pair). Both must pick the same destinations.
+
+#include "Check.h"
+#include "HubSim.h"
+#include <memory>
+#include <chrono>
+
+// The route list and lookup as they were before the route table
+struct LegacyRoutes {
+    struct Link {
+        uint16_t sourceVid, sourcePid, destVid, destPid;
+    };
+    Link links[MAX_ROUTES];
+    int count = 0;
+
+    int findRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) const {
+        for (int i = 0; i < count; i++) {
+            if (links[i].sourceVid == srcVid && links[i].sourcePid == srcPid &&
+                links[i].destVid == dstVid && links[i].destPid == dstPid) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool shouldRoute(uint16_t srcVid, uint16_t srcPid, uint16_t dstVid, uint16_t dstPid) const {
+        if (count == 0) return false;
+        return findRoute(srcVid, srcPid, dstVid, dstPid) >= 0;
+    }
+};
+
+// Destinations of one message from srcSlot, the old way
+static SlotMask legacyDests(const DeviceManager& devices, const LegacyRoutes& routes, int srcSlot) {
+    const MidiDeviceInfo* srcInfo = devices.getDeviceBySlot(srcSlot);
+    if (!srcInfo) return 0;
+    SlotMask dests = 0;
+    for (int dstSlot = 0; dstSlot < MAX_MIDI_DEVICES; dstSlot++) {
+        if (dstSlot == srcSlot) continue;
+        if (!devices.isConnected(dstSlot)) continue;
+        const MidiDeviceInfo* dstInfo = devices.getDeviceBySlot(dstSlot);
+        if (!dstInfo) continue;
+        if (!routes.shouldRoute(srcInfo->vid, srcInfo->pid, dstInfo->vid, dstInfo->pid)) continue;
+        dests |= (SlotMask)(1u << dstSlot);
+    }
+    return dests;
+}
+
+// Destinations of one message from srcSlot, as MidiRouter::forward() finds them
+static SlotMask tableDests(const RouteManager& routes, int srcSlot, uint8_t cable) {
+    SlotMask dests = routes.getDestMask(srcSlot, cable);
+    if (dests & routes.getFilteredMask(srcSlot, cable)) {
+        dests = routes.applyFilters(srcSlot, cable, dests, 0x90, 1, 60);
+    }
+    return dests;
+}
+
+// Keeps the timed lookups from being optimised away
+volatile uint32_t lookupSink;
+
+template <class Lookup> static double nanosPerMessage(int messages, Lookup lookup) {
+    uint32_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < messages; n++) {
+        sum += lookup(n % HOST_DEVICE_SLOTS);
+    }
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    lookupSink = sum;
+    return nanos / messages;
+}
+
+// Plug a device into every host slot and add routes from each device to
+// the next `fanout` others
+static void runCase(int fanout) {
+    std::unique_ptr<HubSim> sim(new HubSim());
+    mock::UsbDevice* devs[HOST_DEVICE_SLOTS];
+    for (int i = 0; i < HOST_DEVICE_SLOTS; i++) {
+        devs[i] = sim->plug(mock::UsbDeviceSpec((uint16_t)(0x1000 + i), 1, "Device"));
+        CHECK(sim->slotOf(devs[i]) >= 0);
+    }
+
+    LegacyRoutes legacy;
+    for (int i = 0; i < HOST_DEVICE_SLOTS; i++) {
+        for (int k = 1; k <= fanout; k++) {
+            const mock::UsbDevice* dst = devs[(i + k) % HOST_DEVICE_SLOTS];
+            CHECK(sim->addRoute(devs[i], dst));
+            legacy.links[legacy.count++] = {devs[i]->spec.vid, devs[i]->spec.pid, dst->spec.vid, dst->spec.pid};
+        }
+    }
+
+    for (int slot = 0; slot < HOST_DEVICE_SLOTS; slot++) {
+        SlotMask expected = legacyDests(sim->devices, legacy, slot);
+        CHECK_EQ(__builtin_popcount(expected), fanout);
+        CHECK_EQ(tableDests(sim->routes, slot, 0), expected);
+    }
+
+    const int messages = 200000;
+    double before = nanosPerMessage(messages, [&](int slot) { return legacyDests(sim->devices, legacy, slot); });
+    double after = nanosPerMessage(messages, [&](int slot) { return tableDests(sim->routes, slot, 0); });
+    printf("  %2d devices, %3d routes (%2d per source): before %7.1f ns/msg, after %5.1f ns/msg (%.0fx)\n",
+           HOST_DEVICE_SLOTS, legacy.count, fanout, before, after, before / after);
+}
+
+TEST_CASE(routeLookup) {
+    printf("Route lookup per message, all device slots in use:\n");
+    runCase(1);
+    runCase(4);
+    runCase(HOST_DEVICE_SLOTS - 1);
+}
@@ -0,0 +1,118 @@
+// Messages per USB frame for a dense CC sweep into one synth: the routing
+// core's batched output against the previous per-message path, where
+// routeMidi() read one message per source per pass and called the
+// library's send() for it (one transfer per packet, waiting for the bus
+// once both of the library's buffers are busy). Devices here take a set
+// number of OUT transfers per 1 ms frame.
+
+#include "Check.h"
+#include "HubSim.h"
+#include <memory>
+
+static const uint64_t MS = 1000000;
+
+struct Result {
+    size_t sent;
+    size_t delivered;
+    uint32_t transfers;
+    double framesBusy;       // Frames from the first packet to the last
+    double finishedMs;       // Last packet on the wire, from the sweep's start
+    double blockedMs;        // Time routing passes spent waiting for the bus
+    bool inOrder;
+};
+
+// A CC sweep at rate messages per second for one second
+static std::vector<uint32_t> sweep(int rate) {
+    std::vector<uint32_t> packets;
+    for (int n = 0; n < rate; n++) {
+        packets.push_back(packMidiPacket(0xB0, (uint8_t)(1 + n % 8), (uint8_t)(n & 0x7F), 1, 0));
+    }
+    return packets;
+}
+
+static Result runSweep(bool batched, int rate, int transfersPerFrame) {
+    std::unique_ptr<HubSim> sim(new HubSim());
+    mock::UsbDevice* controller = sim->plug(mock::UsbDeviceSpec(0x1111, 1, "Controller"));
+    mock::UsbDeviceSpec synthSpec(0x2222, 1, "Synth");
+    synthSpec.transfersPerFrame = transfersPerFrame;
+    mock::UsbDevice* synth = sim->plug(synthSpec);
+    CHECK(sim->addRoute(controller, synth));
+
+    std::vector<uint32_t> packets = sweep(rate);
+    uint64_t start = mock::nextFrame();
+    sim->stream(controller, packets, start, 1000000000ull / rate);
+
+    Result r = {};
+    r.sent = packets.size();
+    uint64_t limit = start + 20000 * MS;
+    if (batched) {
+        while (mock::now() < limit && synth->received.size() < packets.size()) sim->run(10 * MS);
+    } else {
+        // The old routing pass, every 100 us
+        HubMidiDevice* source = sim->devices.getMidiDevice(sim->slotOf(controller));
+        HubMidiDevice* dest = sim->devices.getMidiDevice(sim->slotOf(synth));
+        while (mock::now() < limit && synth->received.size() < packets.size()) {
+            uint64_t passStart = mock::now();
+            if (source->read()) {
+                dest->send(source->getType(), source->getData1(), source->getData2(),
+                           source->getChannel(), source->getCable());
+            }
+            r.blockedMs += (mock::now() - passStart) / 1e6;
+            mock::advanceTo(passStart + 100000);
+        }
+    }
+
+    r.delivered = synth->received.size();
+    r.inOrder = true;
+    for (size_t i = 0; i < r.delivered; i++) {
+        if (synth->received[i].packet != packets[i]) r.inOrder = false;
+    }
+    r.transfers = synth->transfers;
+    if (r.delivered) {
+        r.framesBusy = (synth->received.back().time - synth->received.front().time) / 1e6 + 1;
+        r.finishedMs = (synth->received.back().time - start) / 1e6;
+    }
+    return r;
+}
+
+static void report(const char* mode, int rate, int transfersPerFrame, const Result& r) {
+    printf("  %-9s %5d/s  %d xfer/frame  %5.2f msgs/frame  %5.2f msgs/xfer  done after %5.0f ms  "
+           "routing blocked %5.0f ms  delivered %zu/%zu\n",
+           mode, rate, transfersPerFrame, r.delivered / r.framesBusy, (double)r.delivered / r.transfers,
+           r.finishedMs, r.blockedMs, r.delivered, r.sent);
+}
+
+TEST_CASE(messagesPerFrame) {
+    printf("1 s CC sweep into one synth:\n");
+    const int rates[] = {1000, 4000, 8000, 16000};
+    const int endpoints[] = {1, 4};
+    for (int rate : rates) {
+        for (int transfersPerFrame : endpoints) {
+            Result before = runSweep(false, rate, transfersPerFrame);
+            Result after = runSweep(true, rate, transfersPerFrame);
+            report("per-msg", rate, transfersPerFrame, before);
+            report("batched", rate, transfersPerFrame, after);
+
+            // Everything arrives either way, in order
+            CHECK_EQ(before.delivered, before.sent);
+            CHECK_EQ(after.delivered, after.sent);
+            CHECK(before.inOrder && after.inOrder);
+
+            // The old path never packs more than one message per transfer
+            CHECK_EQ(before.transfers, before.delivered);
+
+            // Batched output keeps up with the sweep (done within a few
+            // frames of the last message) and never blocks routing
+            CHECK(after.finishedMs < 1000 + 5);
+            CHECK(after.blockedMs == 0);
+
+            // Once the sweep outruns one message per transfer, batching
+            // carries more per frame and finishes sooner
+            if (rate / 1000 > transfersPerFrame) {
+                CHECK(after.delivered / after.framesBusy > before.delivered / before.framesBusy);
+                CHECK(after.finishedMs < before.finishedMs);
+                CHECK(before.blockedMs > 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#include "Adafruit_GFX.h"
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h)
+    : _width(w), _height(h), cursor_x(0), cursor_y(0), textcolor(0xFFFF), textbgcolor(0xFFFF),
+      wrap(true), gfxFont(nullptr) {}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    for (int16_t i = 0; i < w; i++) drawPixel(x + i, y, color);
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    for (int16_t i = 0; i < h; i++) drawPixel(x, y + i, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    for (int16_t i = x; i < x + w; i++) drawFastVLine(i, y, h, color);
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+    if (!gfxFont) return 1;
+    if (c == '\n') {
+        cursor_x = 0;
+        cursor_y += gfxFont->yAdvance;
+    } else if (c != '\r' && c >= gfxFont->first && c <= gfxFont->last) {
+        const GFXglyph& glyph = gfxFont->glyph[c - gfxFont->first];
+        if (glyph.width > 0 && glyph.height > 0) {
+            if (wrap && cursor_x + glyph.xOffset + glyph.width > _width) {
+                cursor_x = 0;
+                cursor_y += gfxFont->yAdvance;
+            }
+            drawChar(cursor_x, cursor_y, c, textcolor);
+        }
+        cursor_x += glyph.xAdvance;
+    }
+    return 1;
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color) {
+    const GFXglyph& glyph = gfxFont->glyph[c - gfxFont->first];
+    const uint8_t* bitmap = gfxFont->bitmap + glyph.bitmapOffset;
+    uint8_t bits = 0;
+    uint8_t bit = 0;
+    for (int yy = 0; yy < glyph.height; yy++) {
+        for (int xx = 0; xx < glyph.width; xx++) {
+            if (!(bit++ & 7)) bits = *bitmap++;
+            if (bits & 0x80) drawPixel(x + glyph.xOffset + xx, y + glyph.yOffset + yy, color);
+            bits <<= 1;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef MOCK_ADAFRUIT_GFX_H
+#define MOCK_ADAFRUIT_GFX_H
+
+// Host stand-in for the parts of Adafruit GFX the OLED driver uses: the
+// GFXfont tables, rectangles, and text in a custom font, drawn pixel by
+// pixel the way the library's drawChar() draws it.
+
+#include <Arduino.h>
+
+struct GFXglyph {
+    uint16_t bitmapOffset;  // Into GFXfont.bitmap
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;       // Cursor advance
+    int8_t xOffset;         // From the cursor to the bitmap's top-left
+    int8_t yOffset;
+};
+
+struct GFXfont {
+    uint8_t* bitmap;
+    GFXglyph* glyph;
+    uint16_t first;         // First and last character codes
+    uint16_t last;
+    uint8_t yAdvance;       // Line height
+};
+
+class Adafruit_GFX : public Print {
+public:
+    Adafruit_GFX(int16_t w, int16_t h);
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+    virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+    virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+    void setFont(const GFXfont* f) { gfxFont = f; }
+    void setCursor(int16_t x, int16_t y) { cursor_x = x; cursor_y = y; }
+    void setTextColor(uint16_t c) { textcolor = textbgcolor = c; }
+    void setTextColor(uint16_t c, uint16_t bg) { textcolor = c; textbgcolor = bg; }
+    void setTextWrap(bool w) { wrap = w; }
+    int16_t getCursorX() const { return cursor_x; }
+    int16_t getCursorY() const { return cursor_y; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+    // Custom fonts only (the driver never uses the built-in 5x7 font)
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+protected:
+    int16_t _width;
+    int16_t _height;
+    int16_t cursor_x;
+    int16_t cursor_y;
+    uint16_t textcolor;
+    uint16_t textbgcolor;
+    bool wrap;
+    const GFXfont* gfxFont;
+
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color);
+};
+
+#endif
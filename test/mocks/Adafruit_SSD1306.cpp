@@ -0,0 +1,59 @@
+#include "Adafruit_SSD1306.h"
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi, int8_t, uint32_t, uint32_t)
+    : Adafruit_GFX(w, h), wire(twi), address(0x3C), buffer(new uint8_t[w * ((h + 7) / 8)]) {
+    clearDisplay();
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() {
+    delete[] buffer;
+}
+
+bool Adafruit_SSD1306::begin(uint8_t, uint8_t addr) {
+    address = addr;
+    clearDisplay();
+    static const uint8_t init[] = {0x00, SSD1306_DISPLAYOFF, SSD1306_MEMORYMODE, 0x00, SSD1306_DISPLAYON};
+    wire->beginTransmission(address);
+    wire->write(init, sizeof(init));
+    wire->endTransmission();
+    return true;
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+    memset(buffer, 0, _width * ((_height + 7) / 8));
+}
+
+void Adafruit_SSD1306::display() {
+    const uint8_t window[] = {0x00, SSD1306_PAGEADDR, 0, 0xFF, SSD1306_COLUMNADDR, 0, (uint8_t)(_width - 1)};
+    wire->beginTransmission(address);
+    wire->write(window, sizeof(window));
+    wire->endTransmission();
+
+    // The library sends the buffer in 32-byte I2C writes
+    int total = _width * ((_height + 7) / 8);
+    for (int offset = 0; offset < total; offset += 31) {
+        int length = (total - offset < 31) ? total - offset : 31;
+        wire->beginTransmission(address);
+        wire->write((uint8_t)0x40);
+        wire->write(buffer + offset, length);
+        wire->endTransmission();
+    }
+}
+
+void Adafruit_SSD1306::ssd1306_command(uint8_t c) {
+    wire->beginTransmission(address);
+    wire->write((uint8_t)0x00);
+    wire->write(c);
+    wire->endTransmission();
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (x < 0 || x >= _width || y < 0 || y >= _height) return;
+    uint8_t& b = buffer[x + (y / 8) * _width];
+    uint8_t bit = (uint8_t)(1 << (y & 7));
+    switch (color) {
+        case SSD1306_WHITE: b |= bit; break;
+        case SSD1306_BLACK: b &= (uint8_t)~bit; break;
+        case SSD1306_INVERSE: b ^= bit; break;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef MOCK_ADAFRUIT_SSD1306_H
+#define MOCK_ADAFRUIT_SSD1306_H
+
+// Host stand-in for Adafruit_SSD1306: a frame buffer in the panel's page
+// layout, drawn into through Adafruit_GFX, and display() sending it over
+// the mock I2C bus the way the library does.
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_MEMORYMODE 0x20
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+#define SSD1306_DISPLAYOFF 0xAE
+#define SSD1306_DISPLAYON 0xAF
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+    Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi = &Wire, int8_t rst = -1,
+                     uint32_t clkDuring = 400000, uint32_t clkAfter = 100000);
+    ~Adafruit_SSD1306();
+
+    // Answers at any address
+    bool begin(uint8_t vcs = SSD1306_SWITCHCAPVCC, uint8_t addr = 0x3C);
+
+    void clearDisplay();
+    void display();
+    void ssd1306_command(uint8_t c);
+    uint8_t* getBuffer() { return buffer; }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+
+private:
+    TwoWire* wire;
+    uint8_t address;
+    uint8_t* buffer;
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include <Arduino.h>
+#include <vector>
+
+uint32_t F_CPU_ACTUAL = 600000000;
+MockSerial Serial;
+
+namespace {
+
+struct Event {
+    uint64_t next;
+    uint64_t period;
+    void (*callback)(void*);
+    void* context;
+    bool active;
+};
+
+uint64_t clockNanos = 0;
+std::vector<Event> events;
+uint32_t randomState = 1;
+
+// Earliest active event due by limit, -1 if none (ties go to the lower id)
+int nextDue(uint64_t limit) {
+    int found = -1;
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event& e = events[i];
+        if (e.active && e.next <= limit && (found < 0 || e.next < events[found].next)) {
+            found = (int)i;
+        }
+    }
+    return found;
+}
+
+void fireTimer(void* context) {
+    ((void (*)())context)();
+}
+
+}  // namespace
+
+namespace mock {
+
+uint64_t now() { return clockNanos; }
+
+void advanceTo(uint64_t nanos) {
+    for (int i = nextDue(nanos); i >= 0; i = nextDue(nanos)) {
+        Event& e = events[i];
+        if (e.next > clockNanos) clockNanos = e.next;
+        if (e.period) {
+            e.next += e.period;
+        } else {
+            e.active = false;
+        }
+        // The callback may add events, so don't hold a reference across it
+        void (*callback)(void*) = e.callback;
+        callback(e.context);
+    }
+    if (nanos > clockNanos) clockNanos = nanos;
+}
+
+void advance(uint64_t nanos) { advanceTo(clockNanos + nanos); }
+
+int scheduleEvent(uint64_t first, uint64_t period, void (*callback)(void*), void* context) {
+    events.push_back(Event{first, period, callback, context, true});
+    return (int)events.size() - 1;
+}
+
+void reschedule(int id, uint64_t period) {
+    if (id >= 0 && id < (int)events.size()) events[id].period = period;
+}
+
+void cancelEvent(int id) {
+    if (id >= 0 && id < (int)events.size()) events[id].active = false;
+}
+
+void resetClock() {
+    // Keep the slots, so ids still held by timers stay harmless
+    clockNanos = 0;
+    for (Event& e : events) e.active = false;
+    randomState = 1;
+}
+
+}  // namespace mock
+
+uint32_t mockCycleCounter() {
+    return (uint32_t)(clockNanos * (F_CPU_ACTUAL / 1000000) / 1000);
+}
+
+unsigned long millis() { return (unsigned long)(clockNanos / 1000000); }
+unsigned long micros() { return (unsigned long)(clockNanos / 1000); }
+void delay(unsigned long ms) { mock::advance((uint64_t)ms * 1000000); }
+void delayMicroseconds(unsigned int us) { mock::advance((uint64_t)us * 1000); }
+void yield() {}
+
+long random(long low, long high) {
+    if (high <= low) return low;
+    randomState = randomState * 1103515245u + 12345u;
+    return low + (long)((randomState >> 8) % (uint32_t)(high - low));
+}
+
+IntervalTimer::IntervalTimer() : id(-1), prio(128) {}
+
+IntervalTimer::~IntervalTimer() { end(); }
+
+bool IntervalTimer::begin(void (*callback)(), float microseconds) {
+    end();
+    if (microseconds <= 0) return false;
+    uint64_t period = (uint64_t)llroundf(microseconds * 1000.0f);
+    id = mock::scheduleEvent(mock::now() + period, period, fireTimer, (void*)callback);
+    return true;
+}
+
+void IntervalTimer::update(float microseconds) {
+    if (id >= 0 && microseconds > 0) {
+        mock::reschedule(id, (uint64_t)llroundf(microseconds * 1000.0f));
+    }
+}
+
+void IntervalTimer::end() {
+    mock::cancelEvent(id);
+    id = -1;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+
+size_t Print::print(int n, int base) { return print((long)n, base); }
+size_t Print::print(unsigned int n, int base) { return print((unsigned long)n, base); }
+
+size_t Print::print(long n, int base) {
+    if (base == 10 && n < 0) return print('-') + print((unsigned long)-n, base);
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+    char buf[8 * sizeof(long) + 1];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    if (base < 2) base = 10;
+    do {
+        int digit = (int)(n % base);
+        *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        n /= base;
+    } while (n);
+    return print(p);
+}
+
+size_t Print::print(double n, int digits) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return print(buf);
+}
+
+size_t Print::println() { return print("\r\n"); }
+size_t Print::println(const char* s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
+
+int Print::printf(const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    print(buf);
+    return length;
+}
+
+size_t MockSerial::write(uint8_t b) {
+    if (b != '\r') fputc(b, stdout);
+    return 1;
+}
@@ -0,0 +1,145 @@
+#ifndef MOCK_ARDUINO_H
+#define MOCK_ARDUINO_H
+
+// Host stand-in for the parts of the Teensy core the routing code uses.
+// Time is simulated: millis(), micros() and the cycle counter only move
+// when a test advances the clock (mock::advance()), and IntervalTimers
+// fire from there, in time order, like interrupts between loop() passes.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define F(s) (s)
+#define FASTRUN
+#define DMAMEM
+#define EXTMEM
+#define PROGMEM
+
+#define LED_BUILTIN 13
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LOW 0
+#define HIGH 1
+#define FALLING 2
+
+// CPU clock and cycle counter (DWT_CYCCNT), derived from simulated time
+extern uint32_t F_CPU_ACTUAL;
+uint32_t mockCycleCounter();
+#define ARM_DWT_CYCCNT (mockCycleCounter())
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return HIGH; }
+inline void digitalToggle(int) {}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+
+long random(long low, long high);
+
+template <class T>
+T constrain(T value, T low, T high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+// Text output, as in the Arduino core: everything goes through write()
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char* s);
+    size_t print(char c);
+    size_t print(int n, int base = 10);
+    size_t print(unsigned int n, int base = 10);
+    size_t print(long n, int base = 10);
+    size_t print(unsigned long n, int base = 10);
+    size_t print(double n, int digits = 2);
+
+    size_t println();
+    size_t println(const char* s);
+    size_t println(char c);
+    size_t println(int n, int base = 10);
+    size_t println(unsigned int n, int base = 10);
+    size_t println(long n, int base = 10);
+    size_t println(unsigned long n, int base = 10);
+    size_t println(double n, int digits = 2);
+
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// USB serial, written to stdout
+class MockSerial : public Print {
+public:
+    void begin(long) {}
+    bool dtr() { return true; }
+    int available() { return 0; }
+    int read() { return -1; }
+    operator bool() { return true; }
+    size_t write(uint8_t b) override;
+    using Print::write;
+};
+extern MockSerial Serial;
+
+// Periodic timer interrupt, run by the simulated clock
+class IntervalTimer {
+public:
+    IntervalTimer();
+    ~IntervalTimer();
+    bool begin(void (*callback)(), float microseconds);
+    void update(float microseconds);  // Takes effect after the next fire
+    void end();
+    void priority(uint8_t level) { prio = level; }
+
+private:
+    int id;
+    uint8_t prio;
+};
+
+namespace mock {
+
+// Simulated time since start, in nanoseconds
+uint64_t now();
+
+// Move the clock forward, firing timers and bus frames that fall due
+void advance(uint64_t nanos);
+inline void advanceMicros(uint64_t us) { advance(us * 1000); }
+
+// Move the clock to an absolute time (no-op if it's already past)
+void advanceTo(uint64_t nanos);
+
+// Periodic event on the simulated clock (timers, USB frames). Returns an
+// id for cancelEvent(). period 0 fires once.
+int scheduleEvent(uint64_t first, uint64_t period, void (*callback)(void*), void* context);
+void reschedule(int id, uint64_t period);
+void cancelEvent(int id);
+
+// Back to time 0, no timers (between test cases)
+void resetClock();
+
+}  // namespace mock
+
+#endif
@@ -0,0 +1,18 @@
+#include <EEPROM.h>
+
+EEPROMClass EEPROM;
+
+namespace mock {
+
+void eraseEeprom() {
+    memset(EEPROM.bytes, 0xFF, sizeof(EEPROM.bytes));
+    EEPROM.writes = 0;
+    EEPROM.failAfter = -1;
+}
+
+// Fresh from the factory before any test runs
+static struct EraseAtStart {
+    EraseAtStart() { eraseEeprom(); }
+} eraseAtStart;
+
+}  // namespace mock
@@ -0,0 +1,53 @@
+#ifndef MOCK_EEPROM_H
+#define MOCK_EEPROM_H
+
+// Host stand-in for the Teensy 4.1 emulated EEPROM (4284 bytes, erased to
+// 0xFF). Contents survive until mock::eraseEeprom(), so a test can
+// "power cycle" by building fresh objects over the same EEPROM, and cut
+// the power part-way through a write sequence with failAfter.
+
+#include <stdint.h>
+#include <string.h>
+
+class EEPROMClass {
+public:
+    static const int SIZE = 4284;
+
+    uint8_t read(int address) { return (address >= 0 && address < SIZE) ? bytes[address] : 0xFF; }
+    void write(int address, uint8_t value) { update(address, value); }
+    void update(int address, uint8_t value) {
+        if (address < 0 || address >= SIZE || bytes[address] == value) return;
+        if (failAfter == 0) throw PowerFail();
+        if (failAfter > 0) failAfter--;
+        bytes[address] = value;
+        writes++;
+    }
+    uint16_t length() { return SIZE; }
+
+    template <class T>
+    T& get(int address, T& value) {
+        memcpy(&value, bytes + address, sizeof(T));
+        return value;
+    }
+    template <class T>
+    const T& put(int address, const T& value) {
+        const uint8_t* p = (const uint8_t*)&value;
+        for (size_t i = 0; i < sizeof(T); i++) update(address + (int)i, p[i]);
+        return value;
+    }
+
+    // Mock access: raw contents, bytes changed so far, and byte writes
+    // left before the power fails (PowerFail is thrown; -1 never)
+    struct PowerFail {};
+    uint8_t bytes[SIZE];
+    uint32_t writes;
+    int failAfter;
+};
+
+extern EEPROMClass EEPROM;
+
+namespace mock {
+void eraseEeprom();
+}
+
+#endif
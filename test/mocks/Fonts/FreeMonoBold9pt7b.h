@@ -0,0 +1,197 @@
+#ifndef MOCK_FREEMONOBOLD9PT7B_H
+#define MOCK_FREEMONOBOLD9PT7B_H
+
+// Host stand-in for Adafruit GFX's FreeMonoBold9pt7b, which the host
+// build doesn't have: a 5x8 pixel face drawn double width and stretched
+// to about the real font's metrics (11 pixel advance, 18 pixel line,
+// glyphs from 10 rows above the baseline to 2 below). Golden images in
+// test/golden are drawn with it. Generated; glyph bitmaps are packed
+// rows, MSB first, as fontconvert writes them.
+
+#include <Adafruit_GFX.h>
+
+const uint8_t FreeMonoBold9pt7bBitmaps[] PROGMEM = {
+    0xFF, 0xFC, 0xF0, 0xCF, 0x3C, 0xF3, 0x33, 0x0C, 0xC3, 0x33, 0xFF, 0x33,
+    0x0C, 0xCF, 0xFC, 0xCC, 0x33, 0x0C, 0xC0, 0x0C, 0x03, 0x03, 0xFF, 0x30,
+    0x3F, 0x0F, 0xC0, 0xCF, 0xFC, 0x0C, 0x03, 0x00, 0xF0, 0x3C, 0x0F, 0x0C,
+    0x0C, 0x0C, 0x03, 0x03, 0x03, 0x0F, 0x03, 0xC0, 0xF0, 0x3C, 0x0F, 0x0C,
+    0x33, 0x30, 0x30, 0x0C, 0x0C, 0xCF, 0x0C, 0x3C, 0xCF, 0x30, 0xFF, 0x3C,
+    0x0C, 0x33, 0x30, 0xC3, 0x0C, 0x0C, 0x0C, 0x30, 0xC3, 0x03, 0x03, 0x0C,
+    0x30, 0xCC, 0xC3, 0x00, 0x0C, 0x33, 0x33, 0xF0, 0xFC, 0xCC, 0xC3, 0x00,
+    0x0C, 0x03, 0x0F, 0xFF, 0xFF, 0x0C, 0x03, 0x00, 0xF3, 0x3C, 0xC0, 0xFF,
+    0xFF, 0xF0, 0xFF, 0xF0, 0x00, 0xC0, 0xC0, 0xC0, 0x30, 0x30, 0x30, 0x00,
+    0x3F, 0x0F, 0xCC, 0x0F, 0x0F, 0xCC, 0xF3, 0x3F, 0x0F, 0x03, 0x3F, 0x0F,
+    0xC0, 0x30, 0xCF, 0x0C, 0x30, 0xC3, 0x0C, 0xFF, 0xF0, 0x3F, 0x0F, 0xCC,
+    0x0C, 0x03, 0x03, 0x00, 0xC0, 0xC0, 0xC0, 0xFF, 0xFF, 0xF0, 0xFF, 0xFF,
+    0xF0, 0x30, 0x30, 0x03, 0x00, 0xC0, 0x0F, 0x03, 0x3F, 0x0F, 0xC0, 0x03,
+    0x00, 0xC0, 0xF0, 0xCC, 0xC3, 0x30, 0xCF, 0xFC, 0x0C, 0x03, 0x00, 0xC0,
+    0xFF, 0xFF, 0xFC, 0x03, 0xFC, 0x00, 0xC0, 0x30, 0x0F, 0x03, 0x3F, 0x0F,
+    0xC0, 0x0F, 0x03, 0xC3, 0x03, 0x00, 0xFF, 0x3F, 0xCC, 0x0F, 0x03, 0x3F,
+    0x0F, 0xC0, 0xFF, 0xFF, 0xF0, 0x0C, 0x0C, 0x0C, 0x03, 0x03, 0x00, 0xC0,
+    0x30, 0x0C, 0x00, 0x3F, 0x0F, 0xCC, 0x0F, 0x03, 0x3F, 0x0F, 0xCC, 0x0F,
+    0x03, 0x3F, 0x0F, 0xC0, 0x3F, 0x0F, 0xCC, 0x0F, 0x03, 0x3F, 0xCF, 0xF0,
+    0x0C, 0x0C, 0x3C, 0x0F, 0x00, 0xFF, 0x00, 0xFF, 0xFF, 0x00, 0x0F, 0x33,
+    0xCC, 0x03, 0x03, 0x0C, 0x30, 0xC0, 0xC0, 0x30, 0x0C, 0x03, 0x03, 0xFF,
+    0xC0, 0x00, 0x03, 0xFF, 0xC0, 0xC0, 0x30, 0x0C, 0x03, 0x03, 0x0C, 0x30,
+    0xC0, 0xC0, 0x3F, 0x0F, 0xCC, 0x0C, 0x03, 0x03, 0x00, 0xC0, 0xC0, 0x00,
+    0x0C, 0x03, 0x00, 0x3F, 0x0F, 0xCC, 0x0C, 0x03, 0x3C, 0xCF, 0x3C, 0xCF,
+    0x33, 0x3F, 0x0F, 0xC0, 0x3F, 0x0F, 0xCC, 0x0F, 0x03, 0xC0, 0xF0, 0x3F,
+    0xFF, 0x03, 0xC0, 0xF0, 0x30, 0xFF, 0x3F, 0xCC, 0x0F, 0x03, 0xFF, 0x3F,
+    0xCC, 0x0F, 0x03, 0xFF, 0x3F, 0xC0, 0x3F, 0x0F, 0xCC, 0x0F, 0x00, 0xC0,
+    0x30, 0x0C, 0x03, 0x03, 0x3F, 0x0F, 0xC0, 0xFC, 0x3F, 0x0C, 0x33, 0x03,
+    0xC0, 0xF0, 0x3C, 0x0F, 0x0C, 0xFC, 0x3F, 0x00, 0xFF, 0xFF, 0xFC, 0x03,
+    0x00, 0xFF, 0x3F, 0xCC, 0x03, 0x00, 0xFF, 0xFF, 0xF0, 0xFF, 0xFF, 0xFC,
+    0x03, 0x00, 0xFF, 0x3F, 0xCC, 0x03, 0x00, 0xC0, 0x30, 0x00, 0x3F, 0x0F,
+    0xCC, 0x0F, 0x00, 0xCF, 0xF3, 0xFC, 0x0F, 0x03, 0x3F, 0xCF, 0xF0, 0xC0,
+    0xF0, 0x3C, 0x0F, 0x03, 0xFF, 0xFF, 0xFC, 0x0F, 0x03, 0xC0, 0xF0, 0x30,
+    0xFF, 0xF3, 0x0C, 0x30, 0xC3, 0x0C, 0xFF, 0xF0, 0x0F, 0xC3, 0xF0, 0x30,
+    0x0C, 0x03, 0x00, 0xC0, 0x33, 0x0C, 0x3C, 0x0F, 0x00, 0xC0, 0xF0, 0x3C,
+    0x33, 0x30, 0xF0, 0x3C, 0x0C, 0xC3, 0x0C, 0xC0, 0xF0, 0x30, 0xC0, 0x30,
+    0x0C, 0x03, 0x00, 0xC0, 0x30, 0x0C, 0x03, 0x00, 0xFF, 0xFF, 0xF0, 0xC0,
+    0xF0, 0x3F, 0x3F, 0x33, 0xCC, 0xF3, 0x3C, 0x0F, 0x03, 0xC0, 0xF0, 0x30,
+    0xC0, 0xF0, 0x3C, 0x0F, 0xC3, 0xCC, 0xF3, 0x3C, 0x3F, 0x03, 0xC0, 0xF0,
+    0x30, 0x3F, 0x0F, 0xCC, 0x0F, 0x03, 0xC0, 0xF0, 0x3C, 0x0F, 0x03, 0x3F,
+    0x0F, 0xC0, 0xFF, 0x3F, 0xCC, 0x0F, 0x03, 0xFF, 0x3F, 0xCC, 0x03, 0x00,
+    0xC0, 0x30, 0x00, 0x3F, 0x0F, 0xCC, 0x0F, 0x03, 0xC0, 0xF0, 0x3C, 0xCF,
+    0x0C, 0x3C, 0xCF, 0x30, 0xFF, 0x3F, 0xCC, 0x0F, 0x03, 0xFF, 0x3F, 0xCC,
+    0xC3, 0x0C, 0xC0, 0xF0, 0x30, 0x3F, 0xCF, 0xFC, 0x03, 0x00, 0x3F, 0x0F,
+    0xC0, 0x0C, 0x03, 0xFF, 0x3F, 0xC0, 0xFF, 0xFF, 0xF0, 0xC0, 0x30, 0x0C,
+    0x03, 0x00, 0xC0, 0x30, 0x0C, 0x03, 0x00, 0xC0, 0xF0, 0x3C, 0x0F, 0x03,
+    0xC0, 0xF0, 0x3C, 0x0F, 0x03, 0x3F, 0x0F, 0xC0, 0xC0, 0xF0, 0x3C, 0x0F,
+    0x03, 0xC0, 0xF0, 0x3C, 0x0C, 0xCC, 0x0C, 0x03, 0x00, 0xC0, 0xF0, 0x3C,
+    0x0F, 0x03, 0xCC, 0xF3, 0x3C, 0xCF, 0x33, 0x33, 0x0C, 0xC0, 0xC0, 0xF0,
+    0x3C, 0x0C, 0xCC, 0x0C, 0x03, 0x03, 0x33, 0x03, 0xC0, 0xF0, 0x30, 0xC0,
+    0xF0, 0x3C, 0x0F, 0x03, 0x33, 0x0C, 0xC0, 0xC0, 0x30, 0x0C, 0x03, 0x00,
+    0xFF, 0xFF, 0xF0, 0x0C, 0x0C, 0x0C, 0x03, 0x03, 0x03, 0x00, 0xFF, 0xFF,
+    0xF0, 0xFF, 0xFC, 0x30, 0xC3, 0x0C, 0x30, 0xFF, 0xF0, 0xC0, 0x0C, 0x00,
+    0xC0, 0x30, 0x03, 0x00, 0x30, 0xFF, 0xF0, 0xC3, 0x0C, 0x30, 0xC3, 0xFF,
+    0xF0, 0x0C, 0x03, 0x03, 0x33, 0x03, 0xFF, 0xFF, 0xF0, 0xC3, 0x03, 0x03,
+    0x3F, 0x00, 0x30, 0x0C, 0xFF, 0xC0, 0xCF, 0xF3, 0xFC, 0xC0, 0x30, 0x0C,
+    0x03, 0x3C, 0xF0, 0xFC, 0x3C, 0x0F, 0x03, 0xFF, 0x3F, 0xC0, 0x3F, 0x30,
+    0x0C, 0x03, 0x00, 0xC0, 0xCF, 0xC3, 0xF0, 0x00, 0xC0, 0x30, 0x0C, 0xF3,
+    0xC3, 0xF0, 0xFC, 0x0F, 0x03, 0x3F, 0xCF, 0xF0, 0x3F, 0x30, 0x3C, 0x0F,
+    0xFF, 0xC0, 0x0F, 0xC3, 0xF0, 0x0F, 0x03, 0xC3, 0x0C, 0xC0, 0xFC, 0x3F,
+    0x03, 0x00, 0xC0, 0x30, 0x0C, 0x00, 0x3F, 0xF0, 0x3C, 0x0F, 0x03, 0x3F,
+    0xC0, 0x30, 0x0C, 0xFC, 0x3F, 0x00, 0xC0, 0x30, 0x0C, 0x03, 0x3C, 0xF0,
+    0xFC, 0x3C, 0x0F, 0x03, 0xC0, 0xF0, 0x30, 0x30, 0xC0, 0x3C, 0x30, 0xC3,
+    0x0C, 0xFF, 0xF0, 0x03, 0x03, 0x00, 0x0F, 0x03, 0x03, 0x03, 0x03, 0xC3,
+    0xC3, 0x3C, 0x3C, 0xC0, 0xC0, 0xC0, 0xC3, 0xCC, 0xCC, 0xF0, 0xCC, 0xC3,
+    0xC3, 0xF3, 0xC3, 0x0C, 0x30, 0xC3, 0x0C, 0xFF, 0xF0, 0xF3, 0x33, 0x3C,
+    0xCF, 0x33, 0xC0, 0xF0, 0x3C, 0x0C, 0xCF, 0x3C, 0x3F, 0x0F, 0x03, 0xC0,
+    0xF0, 0x3C, 0x0C, 0x3F, 0x30, 0x3C, 0x0F, 0x03, 0xC0, 0xCF, 0xC3, 0xF0,
+    0xFF, 0x30, 0x3C, 0x0F, 0x03, 0xFF, 0x30, 0x0C, 0x03, 0x00, 0xC0, 0x00,
+    0x3F, 0xF0, 0x3C, 0x0F, 0x03, 0x3F, 0xC0, 0x30, 0x0C, 0x03, 0x00, 0xC0,
+    0xCF, 0x3C, 0x3F, 0x0F, 0x00, 0xC0, 0x30, 0x0C, 0x00, 0x3F, 0x30, 0x0C,
+    0x00, 0xFC, 0x00, 0xFF, 0xCF, 0xF0, 0x30, 0x0C, 0x03, 0x03, 0xF0, 0x30,
+    0x0C, 0x03, 0x00, 0xC3, 0x0F, 0x03, 0xC0, 0xC0, 0xF0, 0x3C, 0x0F, 0x03,
+    0xC3, 0xCF, 0x33, 0xCC, 0xC0, 0xF0, 0x3C, 0x0F, 0x03, 0x33, 0x03, 0x00,
+    0xC0, 0xC0, 0xF0, 0x3C, 0x0F, 0x33, 0xCC, 0xCC, 0xC3, 0x30, 0xC0, 0xCC,
+    0xC3, 0x30, 0x30, 0x33, 0x30, 0x3C, 0x0C, 0xC0, 0xF0, 0x3C, 0x0F, 0x03,
+    0x3F, 0xC0, 0x30, 0x0C, 0xFC, 0x3F, 0x00, 0xFF, 0xC0, 0xC0, 0x30, 0x30,
+    0x30, 0x3F, 0xFF, 0xFC, 0x0C, 0x33, 0x0C, 0xC3, 0x03, 0x0C, 0x0C, 0x30,
+    0xFF, 0xFF, 0xF0, 0xC3, 0x03, 0x0C, 0x0C, 0x33, 0x0C, 0xC3, 0x00, 0x30,
+    0x33, 0x3C, 0xCC, 0x0C,
+};
+
+const GFXglyph FreeMonoBold9pt7bGlyphs[] PROGMEM = {
+    {   0,  0,  0, 11,  0,   1},  // 0x20 ' '
+    {   0,  2, 10, 11,  4, -10},  // 0x21 '!'
+    {   3,  6,  4, 11,  2, -10},  // 0x22 '"'
+    {   6, 10, 10, 11,  0, -10},  // 0x23 '#'
+    {  19, 10, 10, 11,  0, -10},  // 0x24 '$'
+    {  32, 10, 10, 11,  0, -10},  // 0x25 '%'
+    {  45, 10, 10, 11,  0, -10},  // 0x26 '&'
+    {  58,  4,  4, 11,  2, -10},  // 0x27 '\''
+    {  60,  6, 10, 11,  2, -10},  // 0x28 '('
+    {  68,  6, 10, 11,  2, -10},  // 0x29 ')'
+    {  76, 10,  6, 11,  0,  -8},  // 0x2A '*'
+    {  84, 10,  6, 11,  0,  -8},  // 0x2B '+'
+    {  92,  4,  5, 11,  2,  -3},  // 0x2C ','
+    {  95, 10,  2, 11,  0,  -6},  // 0x2D '-'
+    {  98,  4,  3, 11,  2,  -3},  // 0x2E '.'
+    { 100, 10,  6, 11,  0,  -8},  // 0x2F '/'
+    { 108, 10, 10, 11,  0, -10},  // 0x30 '0'
+    { 121,  6, 10, 11,  2, -10},  // 0x31 '1'
+    { 129, 10, 10, 11,  0, -10},  // 0x32 '2'
+    { 142, 10, 10, 11,  0, -10},  // 0x33 '3'
+    { 155, 10, 10, 11,  0, -10},  // 0x34 '4'
+    { 168, 10, 10, 11,  0, -10},  // 0x35 '5'
+    { 181, 10, 10, 11,  0, -10},  // 0x36 '6'
+    { 194, 10, 10, 11,  0, -10},  // 0x37 '7'
+    { 207, 10, 10, 11,  0, -10},  // 0x38 '8'
+    { 220, 10, 10, 11,  0, -10},  // 0x39 '9'
+    { 233,  4,  6, 11,  2,  -8},  // 0x3A ':'
+    { 236,  4, 10, 11,  2,  -8},  // 0x3B ';'
+    { 241,  8, 10, 11,  0, -10},  // 0x3C '<'
+    { 251, 10,  4, 11,  0,  -7},  // 0x3D '='
+    { 256,  8, 10, 11,  2, -10},  // 0x3E '>'
+    { 266, 10, 10, 11,  0, -10},  // 0x3F '?'
+    { 279, 10, 10, 11,  0, -10},  // 0x40 '@'
+    { 292, 10, 10, 11,  0, -10},  // 0x41 'A'
+    { 305, 10, 10, 11,  0, -10},  // 0x42 'B'
+    { 318, 10, 10, 11,  0, -10},  // 0x43 'C'
+    { 331, 10, 10, 11,  0, -10},  // 0x44 'D'
+    { 344, 10, 10, 11,  0, -10},  // 0x45 'E'
+    { 357, 10, 10, 11,  0, -10},  // 0x46 'F'
+    { 370, 10, 10, 11,  0, -10},  // 0x47 'G'
+    { 383, 10, 10, 11,  0, -10},  // 0x48 'H'
+    { 396,  6, 10, 11,  2, -10},  // 0x49 'I'
+    { 404, 10, 10, 11,  0, -10},  // 0x4A 'J'
+    { 417, 10, 10, 11,  0, -10},  // 0x4B 'K'
+    { 430, 10, 10, 11,  0, -10},  // 0x4C 'L'
+    { 443, 10, 10, 11,  0, -10},  // 0x4D 'M'
+    { 456, 10, 10, 11,  0, -10},  // 0x4E 'N'
+    { 469, 10, 10, 11,  0, -10},  // 0x4F 'O'
+    { 482, 10, 10, 11,  0, -10},  // 0x50 'P'
+    { 495, 10, 10, 11,  0, -10},  // 0x51 'Q'
+    { 508, 10, 10, 11,  0, -10},  // 0x52 'R'
+    { 521, 10, 10, 11,  0, -10},  // 0x53 'S'
+    { 534, 10, 10, 11,  0, -10},  // 0x54 'T'
+    { 547, 10, 10, 11,  0, -10},  // 0x55 'U'
+    { 560, 10, 10, 11,  0, -10},  // 0x56 'V'
+    { 573, 10, 10, 11,  0, -10},  // 0x57 'W'
+    { 586, 10, 10, 11,  0, -10},  // 0x58 'X'
+    { 599, 10, 10, 11,  0, -10},  // 0x59 'Y'
+    { 612, 10, 10, 11,  0, -10},  // 0x5A 'Z'
+    { 625,  6, 10, 11,  2, -10},  // 0x5B '['
+    { 633, 10,  6, 11,  0,  -8},  // 0x5C '\\'
+    { 641,  6, 10, 11,  2, -10},  // 0x5D ']'
+    { 649, 10,  4, 11,  0, -10},  // 0x5E '^'
+    { 654, 10,  2, 11,  0,   0},  // 0x5F '_'
+    { 657,  6,  4, 11,  2, -10},  // 0x60 '`'
+    { 660, 10,  7, 11,  0,  -7},  // 0x61 'a'
+    { 669, 10, 10, 11,  0, -10},  // 0x62 'b'
+    { 682, 10,  7, 11,  0,  -7},  // 0x63 'c'
+    { 691, 10, 10, 11,  0, -10},  // 0x64 'd'
+    { 704, 10,  7, 11,  0,  -7},  // 0x65 'e'
+    { 713, 10, 10, 11,  0, -10},  // 0x66 'f'
+    { 726, 10,  9, 11,  0,  -7},  // 0x67 'g'
+    { 738, 10, 10, 11,  0, -10},  // 0x68 'h'
+    { 751,  6, 10, 11,  2, -10},  // 0x69 'i'
+    { 759,  8, 12, 11,  0, -10},  // 0x6A 'j'
+    { 771,  8, 10, 11,  0, -10},  // 0x6B 'k'
+    { 781,  6, 10, 11,  2, -10},  // 0x6C 'l'
+    { 789, 10,  7, 11,  0,  -7},  // 0x6D 'm'
+    { 798, 10,  7, 11,  0,  -7},  // 0x6E 'n'
+    { 807, 10,  7, 11,  0,  -7},  // 0x6F 'o'
+    { 816, 10,  9, 11,  0,  -7},  // 0x70 'p'
+    { 828, 10,  9, 11,  0,  -7},  // 0x71 'q'
+    { 840, 10,  7, 11,  0,  -7},  // 0x72 'r'
+    { 849, 10,  7, 11,  0,  -7},  // 0x73 's'
+    { 858, 10, 10, 11,  0, -10},  // 0x74 't'
+    { 871, 10,  7, 11,  0,  -7},  // 0x75 'u'
+    { 880, 10,  7, 11,  0,  -7},  // 0x76 'v'
+    { 889, 10,  7, 11,  0,  -7},  // 0x77 'w'
+    { 898, 10,  7, 11,  0,  -7},  // 0x78 'x'
+    { 907, 10,  9, 11,  0,  -7},  // 0x79 'y'
+    { 919, 10,  7, 11,  0,  -7},  // 0x7A 'z'
+    { 928,  6, 10, 11,  2, -10},  // 0x7B '{'
+    { 936,  2, 10, 11,  4, -10},  // 0x7C '|'
+    { 939,  6, 10, 11,  2, -10},  // 0x7D '}'
+    { 947, 10,  4, 11,  0,  -7},  // 0x7E '~'
+};
+
+const GFXfont FreeMonoBold9pt7b PROGMEM = {(uint8_t*)FreeMonoBold9pt7bBitmaps,
+                                           (GFXglyph*)FreeMonoBold9pt7bGlyphs, 0x20, 0x7E, 18};
+
+#endif
@@ -0,0 +1,355 @@
+#include <USBHost_t36.h>
+#include <deque>
+#include <memory>
+
+// Lets the bus set and clear the device a driver claimed
+struct MockUsbAccess {
+    static bool offer(USBDriver* driver, Device_t* dev, int type, const uint8_t* d, uint32_t len) {
+        if (driver->device || !driver->claim(dev, type, d, len)) return false;
+        driver->device = dev;
+        return true;
+    }
+    static void release(USBDriver* driver) {
+        driver->disconnect();
+        driver->device = nullptr;
+    }
+};
+
+namespace {
+
+const uint64_t FRAME_NANOS = 1000000;
+
+struct InFlight {
+    Transfer_t transfer;
+    mock::UsbDevice* device;
+};
+
+std::vector<USBDriver*> drivers;
+std::vector<std::unique_ptr<mock::UsbDevice>> devices;
+std::vector<std::unique_ptr<Pipe_t>> pipes;
+std::deque<InFlight> inFlight;
+uint8_t nextAddress = 1;
+bool framesRunning = false;
+
+mock::UsbDevice* deviceFor(const Device_t* dev) {
+    for (auto& d : devices) {
+        if (&d->device == dev) return d.get();
+    }
+    return nullptr;
+}
+
+// One USB frame: each device takes up to its share of OUT transfers
+void frame(void*) {
+    std::vector<InFlight> done;
+    std::vector<int> taken(devices.size(), 0);
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+        size_t index = 0;
+        while (index < devices.size() && devices[index].get() != it->device) index++;
+        if (index < devices.size() && taken[index] < it->device->spec.transfersPerFrame) {
+            taken[index]++;
+            done.push_back(*it);
+            it = inFlight.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (const InFlight& t : done) {
+        const uint32_t* packets = (const uint32_t*)t.transfer.buffer;
+        for (uint32_t i = 0; i < t.transfer.length / 4; i++) {
+            t.device->received.push_back(mock::WirePacket{mock::now(), packets[i]});
+        }
+        t.device->transfers++;
+        if (t.transfer.pipe->callback_function) {
+            t.transfer.pipe->callback_function(&t.transfer);
+        }
+    }
+}
+
+void startFrames() {
+    if (framesRunning) return;
+    framesRunning = true;
+    mock::scheduleEvent(mock::nextFrame(), FRAME_NANOS, frame, nullptr);
+}
+
+// Interface, endpoint and class-specific endpoint descriptors of a USB
+// MIDI streaming interface
+uint32_t midiDescriptors(const mock::UsbDeviceSpec& spec, uint8_t* d) {
+    uint32_t n = 0;
+    const uint8_t iface[] = {9, 4, 0, 0, (uint8_t)(spec.hasOut ? 2 : 1), 1, 3, 0, 0};
+    memcpy(d + n, iface, sizeof(iface));
+    n += sizeof(iface);
+    const uint8_t header[] = {7, 0x24, 1, 0, 1, 0, 0};
+    memcpy(d + n, header, sizeof(header));
+    n += sizeof(header);
+
+    auto endpoint = [&](uint8_t address, uint8_t attributes, uint8_t cables) {
+        const uint8_t ep[] = {9, 5, address, attributes, 64, 0, 1, 0, 0};
+        memcpy(d + n, ep, sizeof(ep));
+        n += sizeof(ep);
+        d[n++] = (uint8_t)(4 + cables);
+        d[n++] = 0x25;
+        d[n++] = 1;
+        d[n++] = cables;
+        for (uint8_t i = 0; i < cables; i++) d[n++] = (uint8_t)(i + 1);
+    };
+    if (spec.hasOut) endpoint(0x02, spec.interruptOut ? 3 : 2, spec.outCables);
+    endpoint(0x81, 2, spec.inCables);
+    return n;
+}
+
+}  // namespace
+
+USBDriver::~USBDriver() {
+    for (auto it = drivers.begin(); it != drivers.end(); ++it) {
+        if (*it == this) {
+            drivers.erase(it);
+            break;
+        }
+    }
+}
+
+void USBDriver::driver_ready_for_device(USBDriver* driver) {
+    drivers.push_back(driver);
+}
+
+Pipe_t* USBDriver::new_Pipe(Device_t* dev, uint32_t type, uint32_t endpoint, uint32_t, uint32_t, uint32_t) {
+    pipes.emplace_back(new Pipe_t{nullptr, dev, type, endpoint});
+    return pipes.back().get();
+}
+
+bool USBDriver::queue_Data_Transfer(Pipe_t* pipe, void* buffer, uint32_t len, USBDriver* driver) {
+    mock::UsbDevice* dev = deviceFor(pipe->device);
+    if (!dev) return false;
+    startFrames();
+    inFlight.push_back(InFlight{Transfer_t{pipe, buffer, len, driver}, dev});
+    return true;
+}
+
+bool USBHub::claim(Device_t*, int type, const uint8_t* descriptors, uint32_t len) {
+    // Device level, bDeviceClass 9
+    return type == 0 && len >= 5 && descriptors[4] == 9;
+}
+
+MIDIDeviceBase::MIDIDeviceBase(USBHost&, uint16_t rxQueueSize, uint16_t sysexSize)
+    : rxQueueSize(min<uint16_t>(rxQueueSize, RX_QUEUE_MAX)), rxHead(0), rxCount(0),
+      sysexSize(min<uint16_t>(sysexSize, SYSEX_MAX)), sysexLength(0), sysexHandler(nullptr),
+      msgType(0), msgChannel(0), msgData1(0), msgData2(0), msgCable(0),
+      txpipe(nullptr), tx1Count(0), tx2Count(0) {
+    driver_ready_for_device(this);
+}
+
+bool MIDIDeviceBase::claim(Device_t* dev, int type, const uint8_t* descriptors, uint32_t len) {
+    // Interface level, audio class (1) MIDI streaming subclass (3)
+    if (type != 1 || len < 9 || descriptors[1] != 4 || descriptors[5] != 1 || descriptors[6] != 3) {
+        return false;
+    }
+    txpipe = nullptr;
+    for (uint32_t offset = descriptors[0]; offset + 4 <= len; offset += descriptors[offset]) {
+        const uint8_t* d = descriptors + offset;
+        if (d[0] == 0 || d[1] == 4) break;
+        if (d[1] == 5 && !(d[2] & 0x80) && !txpipe) {
+            txpipe = new_Pipe(dev, d[3] & 0x03, d[2] & 0x0F, 0, 64);
+            txpipe->callback_function = txCallback;
+        }
+    }
+    rxCount = 0;
+    sysexLength = 0;
+    tx1Count = tx2Count = 0;
+    return true;
+}
+
+void MIDIDeviceBase::disconnect() {
+    txpipe = nullptr;
+    rxCount = 0;
+}
+
+bool MIDIDeviceBase::rxPush(uint32_t packet) {
+    if (rxCount >= rxQueueSize) return false;
+    rxQueue[(rxHead + rxCount++) % rxQueueSize] = packet;
+    return true;
+}
+
+void MIDIDeviceBase::sysexByte(uint8_t b) {
+    if (sysexHandler && sysexLength >= sysexSize) {
+        // Buffer full: hand the chunk on and start over
+        sysexHandler(sysexBuffer, sysexLength, false);
+        sysexLength = 0;
+    }
+    if (sysexLength < sysexSize) {
+        sysexBuffer[sysexLength++] = b;
+    }
+}
+
+bool MIDIDeviceBase::read(uint8_t channel) {
+    if (rxCount == 0) return false;
+    uint32_t n = rxQueue[rxHead];
+    rxHead = (rxHead + 1) % rxQueueSize;
+    rxCount--;
+
+    uint8_t cin = n & 0x0F;
+    uint8_t b1 = (uint8_t)(n >> 8);
+    uint8_t b2 = (uint8_t)(n >> 16);
+    uint8_t b3 = (uint8_t)(n >> 24);
+    msgCable = (n >> 4) & 0x0F;
+
+    if (cin >= 0x08 && cin <= 0x0E) {
+        // Channel voice: the status must agree with the CIN
+        if ((b1 >> 4) != cin) return false;
+        msgType = b1 & 0xF0;
+        msgChannel = (b1 & 0x0F) + 1;
+        msgData1 = b2 & 0x7F;
+        msgData2 = b3 & 0x7F;
+        return channel == 0 || channel == msgChannel;
+    }
+    if (cin == 0x04) {
+        sysexByte(b1);
+        sysexByte(b2);
+        sysexByte(b3);
+        return false;
+    }
+    if (cin == 0x05 && sysexLength == 0 && b1 != 0xF0 && b1 != 0xF7) {
+        // Single-byte system common (tune request)
+        msgType = b1;
+        msgChannel = 0;
+        msgData1 = msgData2 = 0;
+        return true;
+    }
+    if (cin >= 0x05 && cin <= 0x07) {
+        sysexByte(b1);
+        if (cin >= 0x06) sysexByte(b2);
+        if (cin == 0x07) sysexByte(b3);
+        msgType = 0xF0;
+        msgChannel = 0;
+        msgData1 = sysexLength & 0xFF;
+        msgData2 = sysexLength >> 8;
+        if (sysexHandler) sysexHandler(sysexBuffer, sysexLength, true);
+        sysexLength = 0;
+        return true;
+    }
+    if (cin == 0x0F || cin == 0x02 || cin == 0x03) {
+        msgType = b1;
+        msgChannel = 0;
+        msgData1 = (cin >= 0x02 && cin <= 0x03) ? (b2 & 0x7F) : 0;
+        msgData2 = (cin == 0x03) ? (b3 & 0x7F) : 0;
+        return true;
+    }
+    return false;
+}
+
+void MIDIDeviceBase::send(uint8_t type, uint8_t data1, uint8_t data2, uint8_t channel, uint8_t cable) {
+    uint32_t header = (uint32_t)(cable & 0x0F) << 4;
+    if (type >= 0x80 && type < 0xF0) {
+        type &= 0xF0;
+        write_packed(header | (type >> 4) | ((uint32_t)(type | ((channel - 1) & 0x0F)) << 8) |
+                     ((uint32_t)(data1 & 0x7F) << 16) | ((uint32_t)(data2 & 0x7F) << 24));
+    } else if (type >= 0xF8) {
+        write_packed(header | 0x0F | ((uint32_t)type << 8));
+    }
+}
+
+void MIDIDeviceBase::write_packed(uint32_t data) {
+    if (!txpipe) return;
+    const uint32_t txMax = 16;
+    while (true) {
+        uint32_t tx1 = tx1Count;
+        uint32_t tx2 = tx2Count;
+        if (tx1 < txMax && (tx2 == 0 || tx2 >= txMax)) {
+            txBuffer1[tx1++] = data;
+            tx1Count = txMax;  // Sent at once, partly filled
+            queue_Data_Transfer(txpipe, txBuffer1, tx1 * 4, this);
+            return;
+        }
+        if (tx2 < txMax) {
+            txBuffer2[tx2++] = data;
+            tx2Count = txMax;
+            queue_Data_Transfer(txpipe, txBuffer2, tx2 * 4, this);
+            return;
+        }
+        mock::waitForBus();
+        if (!txpipe) return;
+    }
+}
+
+void MIDIDeviceBase::txCallback(const Transfer_t* transfer) {
+    MIDIDeviceBase* dev = (MIDIDeviceBase*)transfer->driver;
+    if (transfer->buffer == dev->txBuffer1) {
+        dev->tx1Count = 0;
+    } else {
+        dev->tx2Count = 0;
+    }
+}
+
+namespace mock {
+
+UsbDevice* plug(const UsbDeviceSpec& spec) {
+    devices.emplace_back(new UsbDevice());
+    UsbDevice* dev = devices.back().get();
+    dev->spec = spec;
+    dev->driver = nullptr;
+    dev->transfers = 0;
+    dev->device = Device_t{nextAddress++, spec.hubAddress, spec.hubPort, spec.vid, spec.pid,
+                           "Mock", spec.product, spec.serial};
+
+    // Device level first (hubs), then the MIDI interface
+    uint8_t deviceDescriptor[18] = {18, 1, 0, 2, (uint8_t)(spec.hub ? 9 : 0)};
+    uint8_t interfaces[256];
+    uint32_t length = midiDescriptors(spec, interfaces);
+    std::vector<USBDriver*> order = drivers;
+    for (USBDriver* driver : order) {
+        if (MockUsbAccess::offer(driver, &dev->device, 0, deviceDescriptor, sizeof(deviceDescriptor))) {
+            dev->driver = driver;
+            return dev;
+        }
+    }
+    if (spec.hub) return dev;
+    for (USBDriver* driver : order) {
+        if (MockUsbAccess::offer(driver, &dev->device, 1, interfaces, length)) {
+            dev->driver = driver;
+            break;
+        }
+    }
+    return dev;
+}
+
+void unplug(UsbDevice* dev) {
+    // The host drops the device's transfers and pipes without callbacks
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+        it = (it->device == dev) ? inFlight.erase(it) : it + 1;
+    }
+    if (dev->driver) MockUsbAccess::release(dev->driver);
+    dev->driver = nullptr;
+    for (auto& p : pipes) {
+        if (p->device == &dev->device) p->device = nullptr;
+    }
+}
+
+bool sendToHost(UsbDevice* dev, uint32_t packet) {
+    MIDIDeviceBase* midi = dynamic_cast<MIDIDeviceBase*>(dev->driver);
+    return midi && midi->rxPush(packet);
+}
+
+uint64_t nextFrame() {
+    return (now() / FRAME_NANOS + 1) * FRAME_NANOS;
+}
+
+void waitForBus() {
+    startFrames();
+    advanceTo(nextFrame());
+}
+
+int transfersInFlight() { return (int)inFlight.size(); }
+
+void reset() {
+    // Drivers built in place (UsbDriverPool) are never destroyed, so drop
+    // the old ones here; the next set registers after this
+    resetClock();
+    drivers.clear();
+    framesRunning = false;
+    inFlight.clear();
+    devices.clear();
+    pipes.clear();
+    nextAddress = 1;
+}
+
+}  // namespace mock
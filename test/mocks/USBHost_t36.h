@@ -0,0 +1,211 @@
+#ifndef MOCK_USBHOST_T36_H
+#define MOCK_USBHOST_T36_H
+
+// Host stand-in for USBHost_t36: drivers claim scripted devices plugged in
+// with mock::plug(), MIDI input is injected into a driver's receive queue
+// with mock::sendToHost(), and OUT transfers complete at 1 ms USB frames
+// on the simulated clock, a set number per device per frame (a device
+// that polls its endpoint slowly takes fewer). MIDIDeviceBase follows the
+// library's read() decoding, SysEx chunking and double-buffered
+// write_packed(), which waits for the bus when both buffers are busy.
+
+#include <Arduino.h>
+#include <vector>
+
+class USBDriver;
+struct Transfer_t;
+
+struct Device_t {
+    uint8_t address;
+    uint8_t hub_address;  // 0 = root port
+    uint8_t hub_port;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    const char* manufacturer;
+    const char* product;
+    const char* serialNumber;
+};
+
+struct Pipe_t {
+    void (*callback_function)(const Transfer_t*);
+    Device_t* device;
+    uint32_t type;      // 2 = bulk, 3 = interrupt
+    uint32_t endpoint;
+};
+
+struct Transfer_t {
+    Pipe_t* pipe;
+    void* buffer;
+    uint32_t length;
+    USBDriver* driver;
+};
+
+class USBHost {
+public:
+    void begin() {}
+    void Task() {}
+};
+
+class USBDriver {
+public:
+    virtual ~USBDriver();
+    operator bool() { return device != nullptr; }
+    uint16_t idVendor() { return device ? device->idVendor : 0; }
+    uint16_t idProduct() { return device ? device->idProduct : 0; }
+    const uint8_t* manufacturer() { return device ? (const uint8_t*)device->manufacturer : nullptr; }
+    const uint8_t* product() { return device ? (const uint8_t*)device->product : nullptr; }
+    const uint8_t* serialNumber() { return device ? (const uint8_t*)device->serialNumber : nullptr; }
+
+protected:
+    USBDriver() : device(nullptr) {}
+
+    // type 0 offers the whole device, type 1 one interface
+    virtual bool claim(Device_t* dev, int type, const uint8_t* descriptors, uint32_t len) = 0;
+    virtual void disconnect() {}
+
+    static void driver_ready_for_device(USBDriver* driver);
+    static Pipe_t* new_Pipe(Device_t* dev, uint32_t type, uint32_t endpoint, uint32_t direction,
+                            uint32_t maxlen, uint32_t interval = 0);
+    static bool queue_Data_Transfer(Pipe_t* pipe, void* buffer, uint32_t len, USBDriver* driver);
+    static void contribute_Pipes(Pipe_t*, uint32_t) {}
+    static void contribute_Transfers(Transfer_t*, uint32_t) {}
+
+    Device_t* device;
+
+    friend struct MockUsbAccess;
+};
+
+class USBHub : public USBDriver {
+public:
+    USBHub(USBHost&) { driver_ready_for_device(this); }
+
+protected:
+    bool claim(Device_t* dev, int type, const uint8_t* descriptors, uint32_t len) override;
+};
+
+class MIDIDeviceBase : public USBDriver {
+public:
+    MIDIDeviceBase(USBHost& host, uint16_t rxQueueSize, uint16_t sysexSize);
+
+    bool read(uint8_t channel = 0);
+    uint8_t getType() { return msgType; }
+    uint8_t getChannel() { return msgChannel; }
+    uint8_t getData1() { return msgData1; }
+    uint8_t getData2() { return msgData2; }
+    uint8_t getCable() { return msgCable; }
+    uint8_t* getSysExArray() { return sysexBuffer; }
+    uint16_t getSysExArrayLength() { return (uint16_t)(msgData1 | (msgData2 << 8)); }
+
+    // The library's write path: one transfer per call while the bus is
+    // idle, waiting while both of its buffers are on the wire
+    void send(uint8_t type, uint8_t data1, uint8_t data2, uint8_t channel, uint8_t cable);
+    void send_now() {}
+
+    void setHandleSystemExclusive(void (*fptr)(const uint8_t* data, uint16_t length, bool complete)) {
+        sysexHandler = fptr;
+    }
+
+    // Packets waiting in the receive queue, and whether it has room
+    int rxQueued() const { return rxCount; }
+    bool rxPush(uint32_t packet);
+
+    // Largest receive queue and SysEx buffer a driver can have
+    static const int RX_QUEUE_MAX = 400;
+    static const int SYSEX_MAX = 290;
+
+protected:
+    bool claim(Device_t* dev, int type, const uint8_t* descriptors, uint32_t len) override;
+    void disconnect() override;
+    void write_packed(uint32_t data);
+
+private:
+    // Fixed storage like the library's (drivers built in place by
+    // UsbDriverPool are never destroyed)
+    uint32_t rxQueue[RX_QUEUE_MAX];
+    uint16_t rxQueueSize;
+    uint16_t rxHead;
+    uint16_t rxCount;
+    uint8_t sysexBuffer[SYSEX_MAX];
+    uint16_t sysexSize;
+    uint16_t sysexLength;
+    void (*sysexHandler)(const uint8_t* data, uint16_t length, bool complete);
+    uint8_t msgType, msgChannel, msgData1, msgData2, msgCable;
+
+    Pipe_t* txpipe;
+    uint32_t txBuffer1[16];
+    uint32_t txBuffer2[16];
+    volatile uint32_t tx1Count;
+    volatile uint32_t tx2Count;
+    static void txCallback(const Transfer_t* transfer);
+
+    void sysexByte(uint8_t b);
+};
+
+// Receive queue and SysEx buffer sizes of the library's big-buffer driver
+class MIDIDevice_BigBuffer : public MIDIDeviceBase {
+public:
+    MIDIDevice_BigBuffer(USBHost& host) : MIDIDeviceBase(host, 400, 290) {}
+};
+
+namespace mock {
+
+// A device to plug in
+struct UsbDeviceSpec {
+    uint16_t vid;
+    uint16_t pid;
+    const char* product;
+    const char* serial;      // nullptr for none
+    uint8_t hubAddress;      // Hub it's plugged into (0 = root port)
+    uint8_t hubPort;
+    bool hub;                // A hub instead of a MIDI device
+    uint8_t inCables;        // Jacks on the MIDI IN endpoint (device to host)
+    uint8_t outCables;       // Jacks on the MIDI OUT endpoint
+    bool hasOut;             // Has an OUT endpoint at all
+    bool interruptOut;       // OUT endpoint is interrupt rather than bulk
+    int transfersPerFrame;   // OUT transfers the device takes per 1 ms frame
+
+    UsbDeviceSpec(uint16_t vid = 0x1234, uint16_t pid = 0x5678, const char* product = "Synth")
+        : vid(vid), pid(pid), product(product), serial(nullptr), hubAddress(0), hubPort(0),
+          hub(false), inCables(1), outCables(1), hasOut(true), interruptOut(false),
+          transfersPerFrame(1) {}
+};
+
+// A packet as the device received it
+struct WirePacket {
+    uint64_t time;  // Frame it completed in (ns)
+    uint32_t packet;
+};
+
+struct UsbDevice {
+    Device_t device;
+    UsbDeviceSpec spec;
+    USBDriver* driver;                // Claimed by, nullptr if nothing did
+    std::vector<WirePacket> received;  // Packets sent to the device
+    uint32_t transfers;                // OUT transfers completed
+};
+
+// Plug a device into the bus; drivers get to claim it in construction order
+UsbDevice* plug(const UsbDeviceSpec& spec);
+void unplug(UsbDevice* dev);
+
+// Put a USB-MIDI packet in the claiming driver's receive queue, as if the
+// device sent it. False if the queue is full (the host would NAK).
+bool sendToHost(UsbDevice* dev, uint32_t packet);
+
+// Time of the next 1 ms USB frame
+uint64_t nextFrame();
+
+// Run the clock to the next frame (what the library's write does while
+// both its buffers are busy)
+void waitForBus();
+
+// OUT transfers queued and not yet completed
+int transfersInFlight();
+
+// Fresh clock and bus, nothing plugged in and no drivers (call before
+// building the next set)
+void reset();
+
+}  // namespace mock
+
+#endif
@@ -0,0 +1,103 @@
+#include "Wire.h"
+#include <vector>
+
+TwoWire Wire;
+
+namespace {
+
+const int COLUMNS = 128;
+const int PAGES = 8;
+
+uint8_t ram[COLUMNS * PAGES];
+uint8_t colStart = 0, colEnd = COLUMNS - 1, pageStart = 0, pageEnd = PAGES - 1;
+uint8_t col = 0, page = 0;
+std::vector<uint8_t> pending;
+uint32_t bytes = 0;
+uint32_t transmissions = 0;
+
+// SSD1306 commands followed by one argument byte
+bool takesOneArgument(uint8_t command) {
+    switch (command) {
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+        case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void runCommands(const uint8_t* p, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t command = p[i];
+        if ((command == 0x21 || command == 0x22) && i + 2 < length) {
+            if (command == 0x21) {
+                colStart = p[i + 1] % COLUMNS;
+                colEnd = p[i + 2] % COLUMNS;
+                col = colStart;
+            } else {
+                pageStart = p[i + 1] % PAGES;
+                pageEnd = p[i + 2] % PAGES;
+                page = pageStart;
+            }
+            i += 2;
+        } else if (takesOneArgument(command)) {
+            i++;
+        }
+    }
+}
+
+// Horizontal addressing: along the column window, then the next page
+void writeData(const uint8_t* p, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        ram[page * COLUMNS + col] = p[i];
+        if (col++ == colEnd) {
+            col = colStart;
+            page = (page == pageEnd) ? pageStart : page + 1;
+        }
+    }
+}
+
+}  // namespace
+
+void TwoWire::beginTransmission(uint8_t) {
+    pending.clear();
+}
+
+size_t TwoWire::write(uint8_t b) {
+    pending.push_back(b);
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t length) {
+    pending.insert(pending.end(), data, data + length);
+    return length;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+    transmissions++;
+    bytes += pending.size();
+    if (pending.empty()) return 0;
+    if (pending[0] == 0x00) {
+        runCommands(pending.data() + 1, pending.size() - 1);
+    } else if (pending[0] == 0x40) {
+        writeData(pending.data() + 1, pending.size() - 1);
+    }
+    return 0;
+}
+
+namespace mock {
+
+const uint8_t* panelRam() { return ram; }
+uint32_t i2cBytes() { return bytes; }
+uint32_t i2cTransmissions() { return transmissions; }
+
+void resetPanel() {
+    memset(ram, 0, sizeof(ram));
+    colStart = col = 0;
+    colEnd = COLUMNS - 1;
+    pageStart = page = 0;
+    pageEnd = PAGES - 1;
+    bytes = transmissions = 0;
+}
+
+}  // namespace mock
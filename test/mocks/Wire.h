@@ -0,0 +1,37 @@
+#ifndef MOCK_WIRE_H
+#define MOCK_WIRE_H
+
+// Host stand-in for the I2C bus with an SSD1306 panel on it. The panel
+// follows the command stream's column and page address windows and keeps
+// the display RAM written through the data stream, so tests see what the
+// panel shows rather than what the driver meant to send.
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    void begin() {}
+    void setClock(uint32_t) {}
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* data, size_t length);
+    uint8_t endTransmission(bool stop = true);
+};
+extern TwoWire Wire;
+
+namespace mock {
+
+// Display RAM of the panel, 128 columns by 8 pages, as the SSD1306 frame
+// buffer lays it out
+const uint8_t* panelRam();
+
+// Bytes and transmissions sent on the bus since the last reset
+uint32_t i2cBytes();
+uint32_t i2cTransmissions();
+
+// Blank panel, counters cleared
+void resetPanel();
+
+}  // namespace mock
+
+#endif
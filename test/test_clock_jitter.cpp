@@ -0,0 +1,190 @@
+// Clock regeneration on the simulated bus: a sequencer sends 120 BPM clock
+// with up to 2 ms of random timing error, optionally while a keyboard keeps
+// the router and the synths' endpoints busy, and loop() routes once a
+// millisecond. Tick intervals as the synths receive them (in whole 1 ms USB
+// frames) are compared between CLOCK_THRU and CLOCK_REGENERATE. The
+// internal clock keeps its tick count while the router is held.
+
+#include "Check.h"
+#include "HubSim.h"
+#include <memory>
+#include <random>
+#include <cmath>
+
+static const uint64_t MS = 1000000;
+static const uint32_t CLOCK = 0x0000F80F;
+static const double PERIOD_NS = 60e9 / (120 * 24);
+
+struct Tick {
+    mock::UsbDevice* dev;
+};
+
+static void sendTick(void* context) {
+    mock::sendToHost(((Tick*)context)->dev, CLOCK);
+}
+
+struct JitterResult {
+    size_t ticksIn;
+    size_t ticksOut;
+    int runningLead;  // Ticks out minus ticks in, just before the source stops
+    double rmsUs;   // Deviation of received intervals from the nominal period
+    double worstUs;
+    float bpm;
+    uint32_t inAvgUs, inMaxUs, outAvgUs, outMaxUs;
+};
+
+static JitterResult runClock(ClockMode mode, bool load, int seconds = 20) {
+    std::unique_ptr<HubSim> sim(new HubSim());
+    mock::UsbDevice* seq = sim->plug(mock::UsbDeviceSpec(0x1111, 1, "Sequencer"));
+    mock::UsbDevice* keys = sim->plug(mock::UsbDeviceSpec(0x2222, 1, "Keys"));
+    mock::UsbDevice* synths[2];
+    for (int i = 0; i < 2; i++) {
+        synths[i] = sim->plug(mock::UsbDeviceSpec((uint16_t)(0x3333 + i), 1, "Synth"));
+        CHECK(sim->addRoute(seq, synths[i]));
+        CHECK(sim->addRoute(keys, synths[i]));
+    }
+    sim->clock.setMode(mode);
+
+    // Jittered clock, one scheduled event per tick
+    std::mt19937 rng(16);
+    std::uniform_real_distribution<double> jitter(-2e6, 2e6);
+    Tick tick = {seq};
+    uint64_t start = mock::now() + 10 * MS;
+    size_t ticksIn = (size_t)(seconds * 1e9 / PERIOD_NS);
+    std::vector<uint64_t> sent;
+    for (size_t n = 0; n < ticksIn; n++) {
+        sent.push_back(start + (uint64_t)(n * PERIOD_NS + 2e6 + jitter(rng)));
+        mock::scheduleEvent(sent.back(), 0, sendTick, &tick);
+    }
+
+    // Note load: 2000 messages a second to both synths
+    if (load) {
+        std::vector<uint32_t> notes;
+        for (int n = 0; n < seconds * 2000; n++) {
+            notes.push_back(packMidiPacket((n & 1) ? 0x80 : 0x90, (uint8_t)(36 + (n / 2) % 48), 100, 1, 0));
+        }
+        sim->stream(keys, notes, start, 500000);
+    }
+
+    // Tempo, stats and tick count while the clock is still running, half a
+    // period after an input tick
+    JitterResult r = {};
+    r.ticksIn = ticksIn;
+    uint64_t sample = sent[ticksIn - 10] + (uint64_t)(PERIOD_NS / 2);
+    sim->run(sample - mock::now(), 1000);
+    r.bpm = sim->clock.getBpm();
+    r.inAvgUs = sim->stats.getClockInJitterAvgMicros();
+    r.inMaxUs = sim->stats.getClockInJitterMaxMicros();
+    r.outAvgUs = sim->stats.getClockOutJitterAvgMicros();
+    r.outMaxUs = sim->stats.getClockOutJitterMaxMicros();
+    int out = 0;
+    for (const mock::WirePacket& w : synths[0]->received) {
+        if (w.packet == CLOCK) out++;
+    }
+    r.runningLead = out - (int)(ticksIn - 9);
+
+    sim->run(500 * MS, 1000);
+
+    // Intervals after the first two seconds (PLL settled)
+    std::vector<uint64_t> times;
+    for (const mock::WirePacket& w : synths[0]->received) {
+        if (w.packet == CLOCK) times.push_back(w.time);
+    }
+    r.ticksOut = times.size();
+    double sumSquares = 0;
+    size_t intervals = 0;
+    for (size_t i = 96; i < times.size(); i++) {
+        double deviation = ((double)(times[i] - times[i - 1]) - PERIOD_NS) / 1000.0;
+        sumSquares += deviation * deviation;
+        r.worstUs = std::max(r.worstUs, std::fabs(deviation));
+        intervals++;
+    }
+    r.rmsUs = intervals ? std::sqrt(sumSquares / intervals) : 0;
+
+    // Both synths got the same ticks
+    size_t other = 0;
+    for (const mock::WirePacket& w : synths[1]->received) {
+        if (w.packet == CLOCK) other++;
+    }
+    CHECK_EQ(other, r.ticksOut);
+    return r;
+}
+
+static void report(const char* mode, const JitterResult& r) {
+    printf("  %-10s ticks %zu/%zu  interval error rms %6.0f us, worst %6.0f us  (stats: in %u/%u us, out %u/%u us, %.1f BPM)\n",
+           mode, r.ticksOut, r.ticksIn, r.rmsUs, r.worstUs, r.inAvgUs, r.inMaxUs, r.outAvgUs, r.outMaxUs, r.bpm);
+}
+
+TEST_CASE(regeneratedClockIsSteadier) {
+    printf("120 BPM clock, +/-2 ms source jitter, loop() every 1 ms:\n");
+    JitterResult thru = runClock(ClockMode::THRU, true);
+    JitterResult regen = runClock(ClockMode::REGENERATE, true);
+    JitterResult idle = runClock(ClockMode::REGENERATE, false);
+    report("thru", thru);
+    report("regenerate", regen);
+    report("(no load)", idle);
+
+    // Passed through, every tick arrives, with the source's jitter plus
+    // polling delay
+    CHECK_EQ(thru.ticksOut, thru.ticksIn);
+
+    // Regenerated, the count keeps step with the source while it runs.
+    // The output sends on the predicted beat, so when the source goes
+    // quiet without a Stop, one tick past its last may already be out.
+    CHECK(regen.runningLead >= -1 && regen.runningLead <= 1);
+    CHECK(regen.ticksOut == regen.ticksIn || regen.ticksOut == regen.ticksIn + 1);
+
+    // Received intervals are whole frames, 20 or 21 ms for a 20.8 ms
+    // period; the PLL's phase corrections can stretch one to 22. A tick
+    // that just misses the transfer in flight with the note load could
+    // cost one frame more. The source's jitter, passed through, costs up
+    // to four.
+    CHECK(idle.worstUs < 1500);
+    CHECK(regen.worstUs < 2000);
+    CHECK(regen.rmsUs * 2 < thru.rmsUs);
+    CHECK(regen.worstUs * 2 < thru.worstUs);
+
+    // Stats: the tempo is tracked (to within the filtered jitter),
+    // incoming jitter is measured, and the timer sends on schedule
+    // (loop() passes take no simulated time, so it's never held off)
+    CHECK(std::fabs(regen.bpm - 120.0f) < 2.0f);
+    CHECK(regen.inAvgUs > 500);
+    CHECK(regen.inMaxUs >= regen.inAvgUs);
+    CHECK_EQ(regen.outMaxUs, 0);
+    CHECK_EQ(thru.inMaxUs, 0);
+}
+
+// Internal clock while loop() holds the router for a long stretch now and
+// then (USB enumeration, menu input): ticks that fall due meanwhile go out
+// once it lets go, so none are lost.
+static int internalTicks(bool longLocks) {
+    std::unique_ptr<HubSim> sim(new HubSim());
+    mock::UsbDevice* synth = sim->plug(mock::UsbDeviceSpec(0x3333, 1, "Synth"));
+    sim->clock.setBpm(120);
+    sim->clock.setMode(ClockMode::INTERNAL);
+    for (int n = 0; n < 40; n++) {
+        if (longLocks) {
+            // Three periods or so under the lock
+            sim->router.lock();
+            mock::advance(70 * MS);
+            sim->router.unlock();
+        }
+        sim->run(longLocks ? 30 * MS : 100 * MS, 1000);
+    }
+    sim->clock.setMode(ClockMode::THRU);
+    sim->run(10 * MS, 1000);
+
+    int ticks = 0;
+    for (const mock::WirePacket& w : synth->received) {
+        if (w.packet == CLOCK) ticks++;
+    }
+    return ticks;
+}
+
+TEST_CASE(internalClockKeepsTicksWhileLocked) {
+    int steady = internalTicks(false);
+    int locked = internalTicks(true);
+    printf("internal clock over 4 s: %d ticks, %d with the router held 70 ms at a time\n", steady, locked);
+    CHECK(steady >= 191 && steady <= 193);
+    CHECK(locked >= steady - 1 && locked <= steady + 1);
+}
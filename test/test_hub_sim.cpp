@@ -0,0 +1,173 @@
+// The routing core driven like the sketch: devices plugged and unplugged
+// on the mock bus, messages streamed in, packets checked on the wire.
+
+#include "Check.h"
+#include "HubSim.h"
+
+static const uint64_t MS = 1000000;
+
+static mock::UsbDeviceSpec device(uint16_t vid, const char* name, const char* serial = nullptr) {
+    mock::UsbDeviceSpec spec(vid, 0x0001, name);
+    spec.serial = serial;
+    return spec;
+}
+
+static uint32_t note(uint8_t number, uint8_t velocity = 100, uint8_t channel = 1, uint8_t cable = 0) {
+    return packMidiPacket(0x90, number, velocity, channel, cable);
+}
+
+TEST_CASE(routesBetweenPluggedDevices) {
+    HubSim sim;
+    mock::UsbDevice* keys = sim.plug(device(0x1111, "Keys"));
+    mock::UsbDevice* synth = sim.plug(device(0x2222, "Synth"));
+    CHECK_EQ(sim.slotOf(keys), 0);
+    CHECK_EQ(sim.slotOf(synth), 1);
+    CHECK(strcmp(sim.devices.getDeviceBySlot(1)->name, "synth") == 0);
+
+    CHECK(sim.addRoute(keys, synth));
+    sim.stream(keys, {note(60), note(62), note(64)}, mock::now(), 100000);
+    sim.run(5 * MS);
+
+    CHECK_EQ(synth->received.size(), 3);
+    if (synth->received.size() == 3) {
+        CHECK_EQ(synth->received[0].packet, note(60));
+        CHECK_EQ(synth->received[2].packet, note(64));
+    }
+    CHECK(keys->received.empty());
+    CHECK_EQ(sim.stats.getRouteMessages(0, 1), 3);
+}
+
+TEST_CASE(unplugAndReplugRestoresRoute) {
+    HubSim sim;
+    mock::UsbDevice* keys = sim.plug(device(0x1111, "Keys"));
+    mock::UsbDevice* synth = sim.plug(device(0x2222, "Synth"));
+    CHECK(sim.addRoute(keys, synth));
+    CHECK(sim.routes.isRouteConnected(0));
+
+    sim.unplug(synth);
+    CHECK(!sim.routes.isRouteConnected(0));
+    CHECK_EQ(sim.routes.getDestMask(0, 0), 0);
+    sim.stream(keys, {note(60)}, mock::now(), 100000);
+    sim.run(2 * MS);
+    CHECK_EQ(sim.stats.getSlot(0).dropped, 1);
+
+    // Same device back in another slot: the route follows it there
+    mock::UsbDevice* other = sim.plug(device(0x3333, "Other"));
+    mock::UsbDevice* again = sim.plug(device(0x2222, "Synth"));
+    CHECK_EQ(sim.slotOf(other), 1);
+    CHECK_EQ(sim.slotOf(again), 2);
+    CHECK(sim.routes.isRouteConnected(0));
+    sim.stream(keys, {note(61)}, mock::now(), 100000);
+    sim.run(2 * MS);
+    CHECK_EQ(again->received.size(), 1);
+    CHECK(other->received.empty());
+}
+
+TEST_CASE(duplicateDevicesBindBySerial) {
+    HubSim sim;
+    mock::UsbDevice* keys = sim.plug(device(0x1111, "Keys"));
+    mock::UsbDevice* a = sim.plug(device(0x2222, "Synth", "SN0001"));
+
+    // Alone, the synth binds as any unit with its VID:PID
+    CHECK_EQ(sim.devices.getBindingTag(sim.slotOf(a)), DEVICE_TAG_ANY);
+
+    mock::UsbDevice* b = sim.plug(device(0x2222, "Synth", "SN0002"));
+    CHECK(sim.devices.hasDuplicate(sim.slotOf(a)));
+    CHECK(sim.addRoute(keys, b));
+
+    sim.stream(keys, {note(60)}, mock::now(), 100000);
+    sim.run(2 * MS);
+    CHECK(a->received.empty());
+    CHECK_EQ(b->received.size(), 1);
+}
+
+TEST_CASE(sameSerialDuplicatesBindByPort) {
+    HubSim sim;
+    mock::UsbDevice* keys = sim.plug(device(0x1111, "Keys"));
+    mock::UsbDeviceSpec hubSpec(0x0451, 0x2046, "Hub");
+    hubSpec.hub = true;
+    mock::UsbDevice* hub = sim.plug(hubSpec);
+
+    // Two units reporting the same placeholder serial, on hub ports 2 and 3
+    mock::UsbDeviceSpec spec = device(0x2222, "Synth", "0000");
+    spec.hubAddress = hub->device.address;
+    spec.hubPort = 2;
+    mock::UsbDevice* a = sim.plug(spec);
+    spec.hubPort = 3;
+    mock::UsbDevice* b = sim.plug(spec);
+    int slotA = sim.slotOf(a);
+    int slotB = sim.slotOf(b);
+
+    CHECK_EQ(sim.devices.getBindingTag(slotA), sim.devices.getDeviceBySlot(slotA)->portTag);
+    CHECK_EQ(sim.devices.getBindingTag(slotB), sim.devices.getDeviceBySlot(slotB)->portTag);
+    CHECK(sim.devices.getBindingTag(slotA) != sim.devices.getBindingTag(slotB));
+    CHECK(strcmp(sim.devices.getDeviceBySlot(slotA)->idLabel, "2") == 0);
+    CHECK(strcmp(sim.devices.getDeviceBySlot(slotB)->idLabel, "3") == 0);
+
+    CHECK(sim.addRoute(keys, b));
+    sim.stream(keys, {note(60)}, mock::now(), 100000);
+    sim.run(2 * MS);
+    CHECK(a->received.empty());
+    CHECK_EQ(b->received.size(), 1);
+
+    // Alone again, the unit shows its serial
+    sim.unplug(a);
+    CHECK(strcmp(sim.devices.getDeviceBySlot(slotB)->idLabel, "0000") == 0);
+}
+
+TEST_CASE(dispatchTimerRoutesWithoutLoop) {
+    HubSim sim(MIDI_DISPATCH_US);
+    CHECK(sim.router.isDispatching());
+    mock::UsbDevice* keys = sim.plug(device(0x1111, "Keys"));
+    mock::UsbDevice* synth = sim.plug(device(0x2222, "Synth"));
+    CHECK(sim.addRoute(keys, synth));
+
+    // No loop() passes at all: the timer interrupt reads and sends
+    CHECK(mock::sendToHost(keys, note(60)));
+    mock::advance(2 * MS);
+    CHECK_EQ(synth->received.size(), 1);
+
+    // Within a dispatch period plus the frame the transfer waits for
+    uint64_t sent = mock::now();
+    CHECK(mock::sendToHost(keys, note(61)));
+    mock::advance(3 * MS);
+    CHECK_EQ(synth->received.size(), 2);
+    if (synth->received.size() == 2) {
+        CHECK(synth->received[1].time - sent <= MIDI_DISPATCH_US * 1000 + MS);
+    }
+}
+
+TEST_CASE(routesSurvivePowerCycle) {
+    {
+        HubSim sim;
+        mock::UsbDevice* keys = sim.plug(device(0x1111, "Keys"));
+        mock::UsbDevice* synth = sim.plug(device(0x2222, "Synth"));
+        CHECK(sim.addRoute(keys, synth, 0, 3));
+    }
+
+    HubSim sim(0, true);
+    CHECK_EQ(sim.routes.getRouteCount(), 1);
+    mock::UsbDevice* synth = sim.plug(device(0x2222, "Synth"));
+    mock::UsbDevice* keys = sim.plug(device(0x1111, "Keys"));
+    sim.stream(keys, {note(60)}, mock::now(), 100000);
+    sim.run(2 * MS);
+    CHECK_EQ(synth->received.size(), 1);
+    if (!synth->received.empty()) {
+        CHECK_EQ(synth->received[0].packet, note(60, 100, 1, 3));
+    }
+}
+
+TEST_CASE(deviceWithoutOutEndpointTakesNoOutput) {
+    HubSim sim;
+    mock::UsbDeviceSpec spec = device(0x2222, "Pads");
+    spec.hasOut = false;
+    mock::UsbDevice* keys = sim.plug(device(0x1111, "Keys"));
+    mock::UsbDevice* pads = sim.plug(spec);
+    CHECK_EQ(sim.devices.getOutputSlots(), 1u << sim.slotOf(keys));
+
+    CHECK(sim.addRoute(keys, pads));
+    sim.stream(keys, {note(60)}, mock::now(), 100000);
+    sim.run(2 * MS);
+    CHECK(pads->received.empty());
+    CHECK_EQ(mock::transfersInFlight(), 0);
+}
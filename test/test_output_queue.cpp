@@ -0,0 +1,166 @@
+// OutputQueue: realtime first, per-source fairness, drop policies, and
+// SysEx runs that are never cut into.
+
+#include "Check.h"
+#include <memory>
+#include "OutputQueue.h"
+#include "HubMidiDevice.h"
+
+static uint32_t note(uint8_t number) { return packMidiPacket(0x90, number, 100, 1, 0); }
+static const uint32_t CLOCK = 0x0000F80F;
+
+static uint32_t sysexPacket(uint8_t fill) {
+    uint8_t bytes[3] = {fill, fill, fill};
+    return packSysExPacket(bytes, 3, false, 0);
+}
+
+TEST_CASE(realtimeGoesFirst) {
+    std::unique_ptr<OutputQueue> q(new OutputQueue());
+    CHECK(q->push(0, note(60), 0, OutputDropPolicy::DROP_NEWEST) == OutputPush::QUEUED);
+    CHECK(q->push(0, CLOCK, 0, OutputDropPolicy::DROP_NEWEST) == OutputPush::QUEUED);
+
+    int src;
+    uint32_t packet, cycles;
+    CHECK(q->pop(src, packet, cycles));
+    CHECK_EQ(packet, CLOCK);
+    CHECK(q->pop(src, packet, cycles));
+    CHECK_EQ(packet, note(60));
+    CHECK(!q->pop(src, packet, cycles));
+    CHECK(q->isEmpty());
+}
+
+TEST_CASE(sourcesTakeTurns) {
+    std::unique_ptr<OutputQueue> q(new OutputQueue());
+    for (int i = 0; i < 10; i++) q->push(1, note((uint8_t)i), 0, OutputDropPolicy::DROP_NEWEST);
+    q->push(2, note(100), 0, OutputDropPolicy::DROP_NEWEST);
+    q->push(2, note(101), 0, OutputDropPolicy::DROP_NEWEST);
+
+    // Source 2's packets come out within the first few, in order
+    int src;
+    uint32_t packet, cycles;
+    int seen2 = 0;
+    for (int n = 0; n < 4 && q->pop(src, packet, cycles); n++) {
+        if (src == 2) CHECK_EQ(packet, note((uint8_t)(100 + seen2++)));
+    }
+    CHECK_EQ(seen2, 2);
+}
+
+TEST_CASE(fullQueuePolicies) {
+    std::unique_ptr<OutputQueue> q(new OutputQueue());
+    for (int i = 0; i < OUTPUT_QUEUE_PACKETS; i++) {
+        CHECK(q->push(1, note((uint8_t)(i & 0x7F)), 0, OutputDropPolicy::DROP_NEWEST) == OutputPush::QUEUED);
+    }
+    CHECK_EQ(q->space(), 0);
+    CHECK(q->push(2, note(1), 0, OutputDropPolicy::DROP_NEWEST) == OutputPush::DROPPED_NEWEST);
+    CHECK(q->push(2, note(1), 0, OutputDropPolicy::DROP_OLDEST) == OutputPush::DROPPED_OLDEST);
+    CHECK_EQ(q->depth(), OUTPUT_QUEUE_PACKETS);
+
+    // Realtime has its own room
+    CHECK(q->push(1, CLOCK, 0, OutputDropPolicy::DROP_NEWEST) == OutputPush::QUEUED);
+}
+
+TEST_CASE(sysexRunsAreWholeOrNothing) {
+    std::unique_ptr<OutputQueue> q(new OutputQueue());
+    uint32_t run[100];
+    for (int i = 0; i < 100; i++) run[i] = sysexPacket(0x11);
+    CHECK(q->pushRun(1, run, 100, 0, 0));
+    CHECK(!q->hasOtherSysEx(1));
+    CHECK(q->hasOtherSysEx(2));
+
+    // One packet stays free to end the open dump
+    int notes = OUTPUT_QUEUE_PACKETS - 100 - 1;
+    for (int i = 0; i < notes; i++) {
+        CHECK(q->push(2, note((uint8_t)i), 0, OutputDropPolicy::DROP_OLDEST) == OutputPush::QUEUED);
+    }
+    CHECK(!q->pushRun(3, run, 1, 0, 0));
+    CHECK_EQ(q->space(), 0);
+    CHECK_EQ(q->depth(), OUTPUT_QUEUE_PACKETS - 1);
+
+    // Making room takes notes, never the SysEx
+    CHECK_EQ(q->makeRoom(10), 10);
+    int src;
+    uint32_t packet, cycles;
+    int sysex = 0;
+    while (q->pop(src, packet, cycles)) {
+        if (src == 1) {
+            CHECK(OutputQueue::isSysEx(packet));
+            sysex++;
+        }
+    }
+    CHECK_EQ(sysex, 100);
+    CHECK(!q->hasOtherSysEx(2));
+
+    // Only SysEx left at the heads: nothing to evict, the newest drops
+    CHECK(q->pushRun(1, run, 100, 0, 0));
+    for (int i = 0; i < notes; i++) q->push(1, note(0), 0, OutputDropPolicy::DROP_OLDEST);
+    CHECK_EQ(q->makeRoom(1), 0);
+    CHECK(q->push(2, note(0), 0, OutputDropPolicy::DROP_OLDEST) == OutputPush::DROPPED_NEWEST);
+}
+
+TEST_CASE(runMovesOntoCable) {
+    std::unique_ptr<OutputQueue> q(new OutputQueue());
+    uint32_t run[2] = {sysexPacket(1), sysexPacket(2)};
+    CHECK(q->pushRun(0, run, 2, 5, 0));
+    int src;
+    uint32_t packet, cycles;
+    CHECK(q->pop(src, packet, cycles));
+    CHECK_EQ(packet, setPacketCable(run[0], 5));
+}
+
+TEST_CASE(sysexIsNotInterleaved) {
+    std::unique_ptr<OutputQueue> q(new OutputQueue());
+    uint8_t start[3] = {0xF0, 0x7D, 0x01};
+    uint8_t end[2] = {0x02, 0xF7};
+    uint32_t head[3] = {packSysExPacket(start, 3, false, 0), sysexPacket(0x10), sysexPacket(0x11)};
+    uint32_t tail[2] = {sysexPacket(0x12), packSysExPacket(end, 2, true, 0)};
+
+    // Source 2's note arrives while the dump is partway out, and the rest
+    // of the dump after it; a note on another cable needn't wait
+    CHECK(q->pushRun(1, head, 3, 0, 0));
+    int src;
+    uint32_t packet, cycles;
+    CHECK(q->pop(src, packet, cycles));
+    CHECK_EQ(packet, head[0]);
+    q->push(2, note(60), 0, OutputDropPolicy::DROP_NEWEST);
+    q->push(3, setPacketCable(note(61), 1), 0, OutputDropPolicy::DROP_NEWEST);
+    q->push(2, CLOCK, 0, OutputDropPolicy::DROP_NEWEST);
+
+    uint32_t out[8];
+    int n = 0;
+    while (n < 8 && q->pop(src, packet, cycles)) {
+        out[n++] = packet;
+        if (n == 4) CHECK(q->pushRun(1, tail, 2, 0, 0));
+    }
+    CHECK_EQ(n, 7);
+    const uint32_t expected[7] = {CLOCK, head[1], head[2], setPacketCable(note(61), 1), tail[0], tail[1], note(60)};
+    for (int i = 0; i < n && i < 7; i++) CHECK_EQ(out[i], expected[i]);
+
+    // With the rest of the dump not yet queued, the cable stays held
+    CHECK(q->isEmpty());
+    CHECK(q->pushRun(1, head, 3, 0, 0));
+    CHECK(q->pop(src, packet, cycles));
+    CHECK(q->pop(src, packet, cycles));
+    CHECK(q->pop(src, packet, cycles));
+    q->push(2, note(62), 0, OutputDropPolicy::DROP_NEWEST);
+    CHECK(!q->pop(src, packet, cycles));
+}
+
+TEST_CASE(openSysExCanAlwaysBeEnded) {
+    std::unique_ptr<OutputQueue> q(new OutputQueue());
+    uint32_t run[1] = {sysexPacket(0x20)};
+    while (q->pushRun(1, run, 1, 2, 0)) {}
+    CHECK_EQ(q->depth(), OUTPUT_QUEUE_PACKETS - 1);
+    CHECK(q->push(2, note(1), 0, OutputDropPolicy::DROP_NEWEST) == OutputPush::DROPPED_NEWEST);
+
+    // The held-back packet closes the message, on its cable
+    q->endSysEx(1, 0);
+    CHECK_EQ(q->depth(), OUTPUT_QUEUE_PACKETS);
+    int src;
+    uint32_t packet = 0, cycles;
+    while (q->pop(src, packet, cycles)) {}
+    CHECK_EQ(packet, 0x0000F725u);
+
+    // Nothing open: nothing to end
+    q->endSysEx(1, 0);
+    CHECK(q->isEmpty());
+}
@@ -0,0 +1,233 @@
+// RouteManager and RouteStore against the mock EEPROM: persistence,
+// saving deferred to savePending(), conversion from the old flat layout,
+// duplicate links, RAM-only routes past the saved capacity, and power
+// failing part-way through a journal write.
+
+#include "Check.h"
+#include <EEPROM.h>
+#include <memory>
+#include "RouteManager.h"
+
+static Route link(uint16_t src, uint8_t srcCable, uint16_t dst, uint8_t dstCable) {
+    Route route = {};
+    route.sourceVid = src;
+    route.sourcePid = 1;
+    route.destVid = dst;
+    route.destPid = 1;
+    route.sourceCable = srcCable;
+    route.destCable = dstCable;
+    snprintf(route.sourceName, sizeof(route.sourceName), "src %u", src);
+    snprintf(route.destName, sizeof(route.destName), "dst %u", dst);
+    return route;
+}
+
+// A RouteManager freshly loaded from the EEPROM (a power cycle)
+static std::unique_ptr<RouteManager> reload() {
+    std::unique_ptr<RouteManager> routes(new RouteManager());
+    routes->load();
+    return routes;
+}
+
+static bool sameRoute(const Route& a, const Route& b) {
+    return a.sourceVid == b.sourceVid && a.destVid == b.destVid && a.sourceTag == b.sourceTag &&
+           a.destTag == b.destTag && a.sourceCable == b.sourceCable && a.destCable == b.destCable &&
+           strcmp(a.sourceName, b.sourceName) == 0 && a.filter.channelMask == b.filter.channelMask &&
+           a.thin.intervalMs == b.thin.intervalMs &&
+           memcmp(&a.transform, &b.transform, sizeof(RouteTransform)) == 0;
+}
+
+// The saved part of routes matches what loads back
+static bool savedMatches(const RouteManager& routes, const RouteManager& loaded) {
+    int saved = min(routes.getRouteCount(), routes.getSavedCapacity());
+    if (loaded.getRouteCount() != saved) return false;
+    for (int i = 0; i < saved; i++) {
+        if (!sameRoute(*routes.getRoute(i), *loaded.getRoute(i))) return false;
+    }
+    return true;
+}
+
+TEST_CASE(emptyEepromLoadsNoRoutes) {
+    mock::eraseEeprom();
+    auto routes = reload();
+    CHECK_EQ(routes->getRouteCount(), 0);
+    CHECK_EQ(routes->getCapacity(), MAX_ROUTES);
+    CHECK(routes->getSavedCapacity() > 0);
+}
+
+TEST_CASE(changesPersist) {
+    mock::eraseEeprom();
+    auto routes = reload();
+    CHECK(routes->addRoute(link(1, CABLE_ANY, 2, CABLE_ANY)));
+    routes->savePending();
+    CHECK(routes->addRoute(link(2, 0, 3, 5)));
+    routes->savePending();
+    CHECK(routes->addRoute(link(3, 1, 1, 0)));
+    routes->savePending();
+    CHECK(routes->removeRouteByIndex(0));
+    routes->savePending();
+    RouteFilter filter;
+    filter.channelMask = 0x00F0;
+    CHECK(routes->setRouteFilter(1, filter));
+    routes->savePending();
+    RouteTransform transform;
+    transform.transpose = -12;
+    CHECK(routes->setRouteTransform(0, transform));
+    routes->savePending();
+
+    auto loaded = reload();
+    CHECK_EQ(loaded->getRouteCount(), 2);
+    CHECK(savedMatches(*routes, *loaded));
+    CHECK_EQ(loaded->getRoute(0)->destCable, 5);
+}
+
+TEST_CASE(convertsFlatV2Layout) {
+    // Two routes as the original firmware saved them
+    mock::eraseEeprom();
+    uint8_t* p = EEPROM.bytes;
+    p[0] = EEPROM_MAGIC & 0xFF;
+    p[1] = EEPROM_MAGIC >> 8;
+    p[2] = 2;
+    p[3] = 2;
+    for (int i = 0; i < 2; i++) {
+        uint8_t* route = p + 4 + i * 56;
+        memset(route, 0, 56);
+        route[0] = (uint8_t)(1 + i);
+        route[2] = 1;
+        route[4] = (uint8_t)(5 + i);
+        route[6] = 1;
+        snprintf((char*)route + 8, 24, "src %d", 1 + i);
+        snprintf((char*)route + 32, 24, "dst %d", 5 + i);
+    }
+
+    auto routes = reload();
+    CHECK_EQ(routes->getRouteCount(), 2);
+    Route expected = link(2, CABLE_ANY, 6, CABLE_ANY);
+    expected.sourceTag = DEVICE_TAG_ANY;
+    expected.destTag = DEVICE_TAG_ANY;
+    CHECK(sameRoute(*routes->getRoute(1), expected));
+    CHECK(routes->getRoute(1)->filter.passesAll());
+
+    // Converted once: loads from the journal from then on
+    CHECK(savedMatches(*routes, *reload()));
+}
+
+TEST_CASE(changesWaitForSavePending) {
+    mock::eraseEeprom();
+    auto routes = reload();
+    uint32_t writes = EEPROM.writes;
+
+    // Nothing is written while the change is made (under the router lock)
+    CHECK(routes->addRoute(link(1, CABLE_ANY, 2, CABLE_ANY)));
+    CHECK_EQ(EEPROM.writes, writes);
+    routes->savePending();
+    CHECK(EEPROM.writes > writes);
+
+    // Several changes before saving are saved together
+    CHECK(routes->addRoute(link(2, CABLE_ANY, 3, CABLE_ANY)));
+    CHECK(routes->removeRouteByIndex(0));
+    RouteFilter filter;
+    filter.channelMask = 0x0001;
+    CHECK(routes->setRouteFilter(0, filter));
+    writes = EEPROM.writes;
+    routes->savePending();
+    CHECK(EEPROM.writes > writes);
+    writes = EEPROM.writes;
+    routes->savePending();
+    CHECK_EQ(EEPROM.writes, writes);
+    CHECK(savedMatches(*routes, *reload()));
+}
+
+TEST_CASE(oneLinkPerSourceCable) {
+    mock::eraseEeprom();
+    auto routes = reload();
+    CHECK(routes->addRoute(link(1, 1, 2, 2)));
+    CHECK(!routes->addRoute(link(1, 1, 2, 2)));
+    CHECK(!routes->addRoute(link(1, 1, 2, 3)));
+    CHECK(!routes->addRoute(link(1, 1, 2, CABLE_ANY)));
+    CHECK(routes->addRoute(link(1, 2, 2, 3)));
+    CHECK(routes->addRoute(link(1, CABLE_ANY, 2, 3)));
+    CHECK(!routes->addRoute(link(1, CABLE_ANY, 2, 0)));
+    CHECK(routes->addRoute(link(1, 0, 2, 0)));
+    CHECK(!routes->addRoute(link(1, 0, 2, CABLE_ANY)));
+    CHECK(routes->addRoute(link(1, 1, 3, 3)));
+    CHECK_EQ(routes->getRouteCount(), 5);
+}
+
+TEST_CASE(routesPastSavedCapacityAreRamOnly) {
+    mock::eraseEeprom();
+    auto routes = reload();
+    int saved = routes->getSavedCapacity();
+    int total = saved + 5;
+    for (int i = 0; i < total; i++) {
+        CHECK(routes->addRoute(link((uint16_t)(100 + i), CABLE_ANY, 1, CABLE_ANY)));
+        routes->savePending();
+    }
+    CHECK_EQ(routes->getRouteCount(), total);
+    CHECK(routes->isRouteSaved(saved - 1));
+    CHECK(!routes->isRouteSaved(saved));
+    CHECK(savedMatches(*routes, *reload()));
+
+    // Removing saved routes moves the next ones into range
+    CHECK(routes->removeRouteByIndex(0));
+    routes->savePending();
+    CHECK(routes->removeRouteByIndex(3));
+    routes->savePending();
+    auto loaded = reload();
+    CHECK_EQ(loaded->getRouteCount(), saved);
+    CHECK(savedMatches(*routes, *loaded));
+    CHECK_EQ(loaded->getRoute(saved - 1)->sourceVid, 100 + saved + 1);
+}
+
+TEST_CASE(powerFailLeavesOldOrNewRoutes) {
+    mock::eraseEeprom();
+    srand(1);
+    auto routes = reload();
+    for (int iter = 0; iter < 3000; iter++) {
+        std::unique_ptr<RouteManager> before(new RouteManager(*routes));
+        int count = routes->getRouteCount();
+        int op = rand() % 4;
+
+        // One change in ten loses power part-way through
+        EEPROM.failAfter = (rand() % 10 == 0) ? rand() % 200 : -1;
+        bool torn = false;
+        try {
+            if (op <= 1 || count == 0) {
+                Route route = link((uint16_t)(rand() % 9), (uint8_t)(rand() % 3 ? rand() % 2 : CABLE_ANY),
+                                   (uint16_t)(rand() % 9), (uint8_t)(rand() % 3 ? rand() % 2 : CABLE_ANY));
+                route.sourceTag = rand() % 2 ? DEVICE_TAG_ANY : (DEVICE_TAG_SERIAL | (rand() % 3));
+                routes->addRoute(route);
+            } else if (op == 2) {
+                routes->removeRouteByIndex(rand() % count);
+            } else {
+                RouteFilter filter;
+                filter.channelMask = (uint16_t)rand();
+                routes->setRouteFilter(rand() % count, filter);
+            }
+            routes->savePending();
+        } catch (EEPROMClass::PowerFail&) {
+            torn = true;
+        }
+        EEPROM.failAfter = -1;
+
+        auto loaded = reload();
+        if (!torn) {
+            CHECK(savedMatches(*routes, *loaded));
+            continue;
+        }
+
+        // Torn: the routes as they were or as they became. A removal
+        // that shifted a RAM-only route into range may also end up
+        // short of that route (its put record was the one cut off).
+        bool ok = savedMatches(*before, *loaded) || savedMatches(*routes, *loaded);
+        if (!ok && op == 2) {
+            int saved = min(routes->getRouteCount(), routes->getSavedCapacity());
+            ok = loaded->getRouteCount() == saved - 1;
+            for (int i = 0; ok && i < saved - 1; i++) {
+                ok = sameRoute(*routes->getRoute(i), *loaded->getRoute(i));
+            }
+        }
+        CHECK(ok);
+        if (!ok) return;
+        routes = std::move(loaded);
+    }
+}
@@ -0,0 +1,214 @@
+// RouteTransform stage by stage (channel, transpose and clamp, velocity
+// curves and their lookup tables, CC remap), and transforms applied per
+// destination by the router.
+
+#include "Check.h"
+#include "HubSim.h"
+#include "RouteTransform.h"
+
+static const uint64_t MS = 1000000;
+
+static uint32_t message(uint8_t type, uint8_t data1, uint8_t data2, uint8_t channel = 1, uint8_t cable = 0) {
+    return packMidiPacket(type, data1, data2, channel, cable);
+}
+
+static uint8_t statusOf(uint32_t packet) { return (uint8_t)(packet >> 8); }
+static uint8_t data1Of(uint32_t packet) { return (packet >> 16) & 0x7F; }
+static uint8_t data2Of(uint32_t packet) { return (packet >> 24) & 0x7F; }
+
+TEST_CASE(defaultChangesNothing) {
+    RouteTransform t;
+    CHECK(t.isIdentity());
+    CHECK(!t.hasCurve());
+    const uint32_t packets[] = {
+        message(0x90, 60, 100), message(0x80, 60, 40), message(0xA0, 60, 10), message(0xB0, 1, 64),
+        message(0xC0, 5, 0), message(0xD0, 80, 0), message(0xE0, 0, 64, 16, 3),
+    };
+    for (uint32_t p : packets) CHECK_EQ(t.apply(p, nullptr), p);
+}
+
+TEST_CASE(systemMessagesPassUntouched) {
+    RouteTransform t;
+    t.channel = 10;
+    t.transpose = 12;
+    t.ccFrom = 1;
+    t.ccTo = 2;
+    uint8_t sysex[3] = {0xF0, 0x7D, 0x01};
+    const uint32_t packets[] = {
+        0x0000F80F, 0x0000FA0F, message(0xF2, 0x10, 0x20), packSysExPacket(sysex, 3, false, 0),
+    };
+    for (uint32_t p : packets) CHECK_EQ(t.apply(p, nullptr), p);
+}
+
+TEST_CASE(channelRemap) {
+    RouteTransform t;
+    t.channel = 10;
+    CHECK(!t.isIdentity());
+    CHECK_EQ(t.apply(message(0x90, 60, 100, 1), nullptr), message(0x90, 60, 100, 10));
+    CHECK_EQ(t.apply(message(0xE0, 0x12, 0x34, 16, 5), nullptr), message(0xE0, 0x12, 0x34, 10, 5));
+    CHECK_EQ(t.apply(message(0xC0, 7, 0, 3), nullptr), message(0xC0, 7, 0, 10));
+}
+
+TEST_CASE(transposeAndClamp) {
+    RouteTransform t;
+    t.transpose = 12;
+    CHECK_EQ(t.apply(message(0x90, 60, 100), nullptr), message(0x90, 72, 100));
+    CHECK_EQ(t.apply(message(0x80, 60, 0), nullptr), message(0x80, 72, 0));
+    CHECK_EQ(t.apply(message(0xA0, 60, 30), nullptr), message(0xA0, 72, 30));
+    CHECK_EQ(t.apply(message(0x90, 120, 100), nullptr), message(0x90, 127, 100));
+
+    // Controllers and the rest aren't notes
+    CHECK_EQ(t.apply(message(0xB0, 60, 1), nullptr), message(0xB0, 60, 1));
+    CHECK_EQ(t.apply(message(0xC0, 60, 0), nullptr), message(0xC0, 60, 0));
+
+    // Into a range, from both sides
+    t.transpose = -24;
+    t.noteLow = 36;
+    t.noteHigh = 84;
+    CHECK_EQ(data1Of(t.apply(message(0x90, 50, 100), nullptr)), 36);
+    CHECK_EQ(data1Of(t.apply(message(0x90, 70, 100), nullptr)), 46);
+    CHECK_EQ(data1Of(t.apply(message(0x90, 127, 100), nullptr)), 84);
+    CHECK_EQ(data1Of(t.apply(message(0x90, 0, 100), nullptr)), 36);
+
+    // A clamp alone is a transform too
+    RouteTransform range;
+    range.noteHigh = 100;
+    CHECK(!range.isIdentity());
+    CHECK_EQ(data1Of(range.apply(message(0x90, 110, 100), nullptr)), 100);
+}
+
+TEST_CASE(velocityCurves) {
+    RouteTransform fixed;
+    fixed.velocityCurve = VELOCITY_FIXED;
+    fixed.velocityAmount = 90;
+    CHECK(fixed.hasCurve());
+    for (int v = 1; v < 128; v++) CHECK_EQ(fixed.velocity((uint8_t)v), 90);
+    CHECK_EQ(fixed.velocity(0), 0);
+
+    // Soft lifts low velocities, hard lowers them; both keep the ends,
+    // never turn a note on into a note off, and never reverse order
+    RouteTransform soft, hard;
+    soft.velocityCurve = VELOCITY_SOFT;
+    hard.velocityCurve = VELOCITY_HARD;
+    soft.velocityAmount = hard.velocityAmount = 64;
+    CHECK(soft.velocity(32) > 32);
+    CHECK(hard.velocity(32) < 32);
+    CHECK_EQ(soft.velocity(127), 127);
+    CHECK_EQ(hard.velocity(127), 127);
+    CHECK_EQ(hard.velocity(1), 1);
+    CHECK_EQ(soft.velocity(0), 0);
+    for (int v = 2; v < 128; v++) {
+        CHECK(soft.velocity((uint8_t)v) >= soft.velocity((uint8_t)(v - 1)));
+        CHECK(hard.velocity((uint8_t)v) >= hard.velocity((uint8_t)(v - 1)));
+    }
+
+    // A bent curve with no strength is no curve
+    RouteTransform flat;
+    flat.velocityCurve = VELOCITY_SOFT;
+    CHECK(!flat.hasCurve());
+    CHECK(flat.isIdentity());
+    CHECK_EQ(flat.velocity(50), 50);
+}
+
+TEST_CASE(velocityOnlyTouchesNoteOn) {
+    RouteTransform t;
+    t.velocityCurve = VELOCITY_FIXED;
+    t.velocityAmount = 90;
+    CHECK_EQ(t.apply(message(0x90, 60, 10), nullptr), message(0x90, 60, 90));
+    CHECK_EQ(t.apply(message(0x90, 60, 0), nullptr), message(0x90, 60, 0));
+    CHECK_EQ(t.apply(message(0x80, 60, 10), nullptr), message(0x80, 60, 10));
+    CHECK_EQ(t.apply(message(0xA0, 60, 10), nullptr), message(0xA0, 60, 10));
+    CHECK_EQ(t.apply(message(0xB0, 7, 10), nullptr), message(0xB0, 7, 10));
+}
+
+TEST_CASE(velocityTableMatchesCurve) {
+    for (uint8_t curve : {VELOCITY_SOFT, VELOCITY_HARD, VELOCITY_FIXED}) {
+        for (uint8_t amount : {1, 40, 127}) {
+            RouteTransform t;
+            t.velocityCurve = curve;
+            t.velocityAmount = amount;
+            uint8_t table[128];
+            t.buildVelocityTable(table);
+            for (int v = 0; v < 128; v++) {
+                uint32_t p = message(0x90, 60, (uint8_t)v);
+                CHECK_EQ(t.apply(p, table), t.apply(p, nullptr));
+            }
+        }
+    }
+}
+
+TEST_CASE(ccRemap) {
+    RouteTransform t;
+    t.ccFrom = 1;
+    t.ccTo = 11;
+    CHECK(!t.isIdentity());
+    CHECK_EQ(t.apply(message(0xB0, 1, 64), nullptr), message(0xB0, 11, 64));
+    CHECK_EQ(t.apply(message(0xB0, 2, 64), nullptr), message(0xB0, 2, 64));
+
+    // Only controllers: a note with the same number stays put
+    CHECK_EQ(t.apply(message(0x90, 1, 64), nullptr), message(0x90, 1, 64));
+
+    RouteTransform same;
+    same.ccFrom = same.ccTo = 7;
+    CHECK(same.isIdentity());
+}
+
+TEST_CASE(stagesCombine) {
+    RouteTransform t;
+    t.channel = 2;
+    t.transpose = -12;
+    t.velocityCurve = VELOCITY_FIXED;
+    t.velocityAmount = 100;
+    t.ccFrom = 74;
+    t.ccTo = 71;
+    uint32_t note = t.apply(message(0x90, 64, 20, 1, 4), nullptr);
+    CHECK_EQ(statusOf(note), 0x91);
+    CHECK_EQ(data1Of(note), 52);
+    CHECK_EQ(data2Of(note), 100);
+    CHECK_EQ(note & 0xFF, 0x49);  // Cable 4, CIN 9 unchanged
+    CHECK_EQ(t.apply(message(0xB0, 74, 5, 1), nullptr), message(0xB0, 71, 5, 2));
+}
+
+TEST_CASE(routerTransformsPerDestination) {
+    HubSim sim;
+    mock::UsbDevice* keys = sim.plug(mock::UsbDeviceSpec(0x1111, 1, "Keys"));
+    mock::UsbDeviceSpec drumSpec(0x2222, 1, "Drums");
+    drumSpec.outCables = 4;
+    mock::UsbDevice* drums = sim.plug(drumSpec);
+    mock::UsbDevice* synth = sim.plug(mock::UsbDeviceSpec(0x3333, 1, "Synth"));
+    CHECK(sim.addRoute(keys, drums, CABLE_ANY, 2));
+    CHECK(sim.addRoute(keys, synth));
+
+    RouteTransform t;
+    t.channel = 10;
+    t.transpose = -12;
+    t.velocityCurve = VELOCITY_HARD;
+    t.velocityAmount = 64;
+    CHECK(sim.routes.setRouteTransform(0, t));
+
+    // Only the transformed link is looked at per message
+    int src = sim.slotOf(keys);
+    CHECK_EQ(sim.routes.getTransformedMask(src, 0), 1u << sim.slotOf(drums));
+
+    sim.stream(keys, {message(0x90, 60, 64), message(0x80, 60, 0), 0x0000F80F}, mock::now(), 100000);
+    sim.run(5 * MS);
+
+    // Moved onto cable 2, then transformed; clock passes as is
+    CHECK_EQ(drums->received.size(), 3);
+    if (drums->received.size() == 3) {
+        CHECK_EQ(drums->received[0].packet, message(0x90, 48, t.velocity(64), 10, 2));
+        CHECK_EQ(drums->received[1].packet, message(0x80, 48, 0, 10, 2));
+        CHECK_EQ(drums->received[2].packet, setPacketCable(0x0000F80F, 2));
+    }
+
+    // The other destination gets the message as it came
+    CHECK_EQ(synth->received.size(), 3);
+    if (synth->received.size() == 3) {
+        CHECK_EQ(synth->received[0].packet, message(0x90, 60, 64));
+        CHECK_EQ(synth->received[1].packet, message(0x80, 60, 0));
+    }
+
+    // Back to no transform: off the per-message path again
+    CHECK(sim.routes.setRouteTransform(0, RouteTransform()));
+    CHECK_EQ(sim.routes.getTransformedMask(src, 0), 0);
+}
@@ -0,0 +1,178 @@
+// Streamed SysEx: a 64 KB dump forwarded whole with clock running through
+// it, a second source kept from splicing into a dump, and a destination
+// that stops taking data getting the dump cut short and properly ended
+// rather than garbled.
+
+#include "Check.h"
+#include "HubSim.h"
+#include <algorithm>
+
+static const uint64_t MS = 1000000;
+static const uint32_t CLOCK = 0x0000F80F;
+
+// F0 7D (non-commercial ID), length - 3 data bytes, F7
+static std::vector<uint8_t> makeDump(size_t length, uint8_t seed) {
+    std::vector<uint8_t> dump(length);
+    dump[0] = 0xF0;
+    dump[1] = 0x7D;
+    for (size_t i = 2; i < length - 1; i++) dump[i] = (uint8_t)((i * 31 + seed) & 0x7F);
+    dump[length - 1] = 0xF7;
+    return dump;
+}
+
+// USB-MIDI packets for a SysEx message, with a clock tick after every
+// clockEvery packets (0 for none)
+static std::vector<uint32_t> sysexPackets(const std::vector<uint8_t>& bytes, int clockEvery = 0) {
+    std::vector<uint32_t> packets;
+    for (size_t i = 0; i < bytes.size(); i += 3) {
+        uint8_t count = (uint8_t)std::min<size_t>(3, bytes.size() - i);
+        packets.push_back(packSysExPacket(&bytes[i], count, i + count == bytes.size(), 0));
+        if (clockEvery && packets.size() % (clockEvery + 1) == (size_t)clockEvery) packets.push_back(CLOCK);
+    }
+    return packets;
+}
+
+// SysEx a device received, split into messages at each F0
+static std::vector<std::vector<uint8_t>> receivedSysEx(const mock::UsbDevice* dev) {
+    std::vector<std::vector<uint8_t>> messages;
+    for (const mock::WirePacket& w : dev->received) {
+        uint8_t cin = w.packet & 0x0F;
+        if (cin < 0x04 || cin > 0x07) continue;
+        int count = (cin == 0x04 || cin == 0x07) ? 3 : cin - 0x04;
+        for (int i = 0; i < count; i++) {
+            uint8_t b = (uint8_t)(w.packet >> (8 * (i + 1)));
+            if (b == 0xF0 || messages.empty()) messages.emplace_back();
+            messages.back().push_back(b);
+        }
+    }
+    return messages;
+}
+
+static void runUntilSent(HubSim& sim) {
+    while (!sim.streamsDone()) sim.run(100 * MS);
+    sim.run(50 * MS);
+}
+
+TEST_CASE(dump64kArrivesWholeWithClock) {
+    HubSim sim;
+    mock::UsbDevice* editor = sim.plug(mock::UsbDeviceSpec(0x1111, 1, "Editor"));
+    mock::UsbDevice* synth = sim.plug(mock::UsbDeviceSpec(0x2222, 1, "Synth"));
+    CHECK(sim.addRoute(editor, synth));
+
+    // Clock at 120 BPM is about one tick per 20 ms; here one rides along
+    // every 48 packets (under 10 ms) to keep the check tight
+    std::vector<uint8_t> dump = makeDump(65536, 1);
+    std::vector<uint32_t> packets = sysexPackets(dump, 48);
+    sim.stream(editor, packets, mock::now(), 200000);
+    runUntilSent(sim);
+
+    std::vector<std::vector<uint8_t>> messages = receivedSysEx(synth);
+    CHECK_EQ(messages.size(), 1);
+    CHECK(!messages.empty() && messages[0] == dump);
+
+    // Every tick arrived within a few frames, not queued behind the
+    // dump (which takes four and a half seconds)
+    std::vector<uint64_t> clockSent;
+    for (size_t i = 0; i < packets.size(); i++) {
+        if (packets[i] == CLOCK) clockSent.push_back(sim.sentTimes(0)[i]);
+    }
+    size_t ticks = 0;
+    uint64_t worst = 0;
+    for (const mock::WirePacket& w : synth->received) {
+        if (w.packet != CLOCK) continue;
+        if (ticks < clockSent.size()) worst = std::max(worst, w.time - clockSent[ticks]);
+        ticks++;
+    }
+    CHECK_EQ(ticks, clockSent.size());
+    CHECK(worst <= 5 * MS);
+
+    CHECK_EQ(sim.stats.getSlot(0).sysexCount, 1);
+    CHECK_EQ(sim.stats.getSlot(1).outputDropped, 0);
+}
+
+TEST_CASE(secondSourceDoesNotSplice) {
+    HubSim sim;
+    mock::UsbDevice* a = sim.plug(mock::UsbDeviceSpec(0x1111, 1, "A"));
+    mock::UsbDevice* b = sim.plug(mock::UsbDeviceSpec(0x2222, 1, "B"));
+    mock::UsbDevice* synth = sim.plug(mock::UsbDeviceSpec(0x3333, 1, "Synth"));
+    CHECK(sim.addRoute(a, synth));
+    CHECK(sim.addRoute(b, synth));
+
+    // B's first dump lands in the middle of A's (about 400 ms long), its
+    // second after A's has finished
+    std::vector<uint8_t> dumpA = makeDump(6000, 2);
+    std::vector<uint8_t> dumpB1 = makeDump(300, 3);
+    std::vector<uint8_t> dumpB2 = makeDump(300, 4);
+    uint64_t start = mock::now();
+    sim.stream(a, sysexPackets(dumpA), start, 200000);
+    sim.stream(b, sysexPackets(dumpB1), start + 50 * MS, 200000);
+    sim.stream(b, sysexPackets(dumpB2), start + 600 * MS, 200000);
+    runUntilSent(sim);
+
+    std::vector<std::vector<uint8_t>> messages = receivedSysEx(synth);
+    CHECK_EQ(messages.size(), 2);
+    if (messages.size() == 2) {
+        CHECK(messages[0] == dumpA);
+        CHECK(messages[1] == dumpB2);
+    }
+    CHECK_EQ(sim.stats.getSlot(2).sysexBlocked, 1);
+    CHECK_EQ(sim.stats.getSlot(1).sysexCount, 2);
+}
+
+// A destination that stops taking transfers part-way through a dump,
+// while another keeps up
+static void stallDuringDump(OutputDropPolicy policy, std::vector<std::vector<uint8_t>>& slowMessages,
+                            std::vector<std::vector<uint8_t>>& fastMessages, uint32_t& dropped) {
+    HubSim sim;
+    mock::UsbDevice* editor = sim.plug(mock::UsbDeviceSpec(0x1111, 1, "Editor"));
+    mock::UsbDevice* fast = sim.plug(mock::UsbDeviceSpec(0x2222, 1, "Fast"));
+    mock::UsbDevice* slow = sim.plug(mock::UsbDeviceSpec(0x3333, 1, "Slow"));
+    CHECK(sim.addRoute(editor, fast));
+    CHECK(sim.addRoute(editor, slow));
+    sim.router.setDropPolicy(sim.slotOf(slow), policy);
+
+    std::vector<uint8_t> dump = makeDump(6000, 5);
+    sim.stream(editor, sysexPackets(dump), mock::now(), 200000);
+    sim.run(20 * MS);
+    slow->spec.transfersPerFrame = 0;
+    sim.run(200 * MS);
+    slow->spec.transfersPerFrame = 1;
+    runUntilSent(sim);
+
+    // Then a short one, which should get through to both
+    sim.stream(editor, sysexPackets(makeDump(300, 6)), mock::now(), 200000);
+    runUntilSent(sim);
+
+    slowMessages = receivedSysEx(slow);
+    fastMessages = receivedSysEx(fast);
+    dropped = sim.stats.getSlot(sim.slotOf(slow)).outputDropped;
+}
+
+TEST_CASE(stalledDestinationDropsRatherThanGarbles) {
+    std::vector<uint8_t> dump = makeDump(6000, 5);
+    std::vector<uint8_t> next = makeDump(300, 6);
+    std::vector<std::vector<uint8_t>> slow, fast;
+    uint32_t dropped;
+
+    // Dropping: the stalled destination gets the start of the dump, ended
+    // there with an F7, never bytes out of place; the other one isn't
+    // affected
+    stallDuringDump(OutputDropPolicy::DROP_OLDEST, slow, fast, dropped);
+    CHECK(dropped > 0);
+    CHECK_EQ(fast.size(), 2);
+    CHECK(fast.size() == 2 && fast[0] == dump && fast[1] == next);
+    CHECK_EQ(slow.size(), 2);
+    if (slow.size() == 2) {
+        CHECK(slow[0].size() > 1 && slow[0].size() < dump.size());
+        CHECK_EQ(slow[0].back(), 0xF7);
+        CHECK_EQ(std::count(slow[0].begin(), slow[0].end(), 0xF7), 1);
+        CHECK(std::equal(slow[0].begin(), slow[0].end() - 1, dump.begin()));
+        CHECK(slow[1] == next);
+    }
+
+    // Holding: nothing is lost, everything waits for the stalled device
+    stallDuringDump(OutputDropPolicy::HOLD_SOURCE, slow, fast, dropped);
+    CHECK_EQ(dropped, 0);
+    CHECK(fast.size() == 2 && fast[0] == dump && fast[1] == next);
+    CHECK(slow.size() == 2 && slow[0] == dump && slow[1] == next);
+}
@@ -0,0 +1,236 @@
+// TextStrip against Adafruit GFX text drawing (widths, blits at any
+// offset, inverted and clipped), and the OLED driver's frames as the panel
+// shows them, compared with the golden images in test/golden. Set
+// UPDATE_GOLDEN=1 to rewrite the images after an intended change.
+
+#include "Check.h"
+#include "OLEDUIDriver.h"
+#include <memory>
+#include <string>
+
+static const int WIDTH = 128;
+static const int HEIGHT = 64;
+static const int PAGES = HEIGHT / 8;
+static const int FRAME_BYTES = WIDTH * PAGES;
+static const GFXfont* const FONT = &FreeMonoBold9pt7b;
+
+static const char* const LABELS[] = {
+    "MIDI Hub", "Launchpad Pro MK3 > Digitone", "gx/|_{}", "0123456789ABCDEF", "",
+};
+
+static bool pixel(const uint8_t* frame, int x, int y) {
+    return frame[x + (y / 8) * WIDTH] & (1 << (y & 7));
+}
+
+// What GFX draws for text with its baseline at x, y
+static void printText(Adafruit_SSD1306& gfx, const char* text, int x, int y, uint16_t color) {
+    gfx.setFont(FONT);
+    gfx.setTextWrap(false);
+    gfx.setTextColor(color);
+    gfx.setCursor(x, y);
+    gfx.print(text);
+}
+
+TEST_CASE(widthMatchesCursorAdvance) {
+    Adafruit_SSD1306 gfx(WIDTH, HEIGHT);
+    for (const char* text : LABELS) {
+        printText(gfx, text, 0, 20, SSD1306_WHITE);
+        CHECK_EQ(TextStrip::textWidth(FONT, text), gfx.getCursorX());
+        TextStrip strip;
+        strip.render(FONT, text);
+        CHECK_EQ(strip.getWidth(), gfx.getCursorX());
+    }
+}
+
+TEST_CASE(blitMatchesPrintAtAnyOffset) {
+    static const int xs[] = {-45, -1, 0, 4, 37, 120};
+    static const int ys[] = {0, 3, 13, 29, 44};
+    Adafruit_SSD1306 gfx(WIDTH, HEIGHT);
+    static TextStrip strip;
+    for (const char* text : LABELS) {
+        strip.render(FONT, text);
+        for (int x : xs) {
+            for (int y : ys) {
+                uint8_t frame[FRAME_BYTES] = {};
+                strip.blit(frame, WIDTH, PAGES, x, y, 0, 0, WIDTH, HEIGHT, false);
+                gfx.clearDisplay();
+                printText(gfx, text, x, y + TextStrip::BASELINE, SSD1306_WHITE);
+                CHECK(memcmp(frame, gfx.getBuffer(), FRAME_BYTES) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE(invertedBlitMatchesDarkText) {
+    // The selected list row: dark text on a filled row
+    Adafruit_SSD1306 gfx(WIDTH, HEIGHT);
+    static TextStrip strip;
+    strip.render(FONT, LABELS[1]);
+    for (int row = 0; row < 4; row++) {
+        int top = row * 16;
+        gfx.clearDisplay();
+        gfx.fillRect(0, top, WIDTH, 16, SSD1306_WHITE);
+        uint8_t frame[FRAME_BYTES];
+        memcpy(frame, gfx.getBuffer(), FRAME_BYTES);
+
+        strip.blit(frame, WIDTH, PAGES, 4 - 9 * row, top, 0, top, WIDTH, 16, true);
+        printText(gfx, LABELS[1], 4 - 9 * row, top + TextStrip::BASELINE, SSD1306_BLACK);
+        CHECK(memcmp(frame, gfx.getBuffer(), FRAME_BYTES) == 0);
+    }
+}
+
+TEST_CASE(blitStaysInsideClip) {
+    Adafruit_SSD1306 gfx(WIDTH, HEIGHT);
+    static TextStrip strip;
+    strip.render(FONT, LABELS[3]);
+    const int clipX = 11, clipY = 23, clipW = 90, clipH = 11;
+
+    uint8_t frame[FRAME_BYTES] = {};
+    strip.blit(frame, WIDTH, PAGES, -7, 19, clipX, clipY, clipW, clipH, false);
+    printText(gfx, LABELS[3], -7, 19 + TextStrip::BASELINE, SSD1306_WHITE);
+
+    int outside = 0;
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            bool inClip = x >= clipX && x < clipX + clipW && y >= clipY && y < clipY + clipH;
+            if (inClip) {
+                CHECK_EQ(pixel(frame, x, y), pixel(gfx.getBuffer(), x, y));
+            } else if (pixel(frame, x, y)) {
+                outside++;
+            }
+        }
+    }
+    CHECK_EQ(outside, 0);
+}
+
+// --- Golden images of the OLED driver's frames, as the panel shows them ---
+
+static void listRow(int index, ListItem& item, char* buf) {
+    static const char* const names[] = {
+        "Keystep", "Launchpad Pro MK3 > Digitone and Syntakt", "Digitone", "Syntakt", "Computer",
+    };
+    snprintf(buf, LIST_ROW_TEXT, "%d %s", index + 1, names[index % 5]);
+    item.left = buf;
+}
+
+static void drawFrame(OLEDUIDriver& oled, const ListView& list, uint8_t damage,
+                      const char* toast = nullptr, bool confirm = false) {
+    oled.beginFrame(oled.damageRect(damage, list));
+    oled.drawList(list);
+    if (confirm) oled.drawConfirmation("Delete?", "Yes", "No", false);
+    if (toast) oled.drawToast(toast);
+    oled.endFrame();
+    // Each pass sends one chunk; the frame is 64 chunks
+    for (int i = 0; i < 100; i++) oled.service();
+}
+
+static std::string goldenPath(const char* name) {
+    return std::string(GOLDEN_DIR) + "/" + name + ".pbm";
+}
+
+// Plain PBM (P1), one row as two 64-character lines, so image changes
+// show up in a diff
+static void writeGolden(const char* name, const uint8_t* frame) {
+    FILE* f = fopen(goldenPath(name).c_str(), "w");
+    if (!f) return;
+    fprintf(f, "P1\n# %s\n%d %d\n", name, WIDTH, HEIGHT);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            fputc(pixel(frame, x, y) ? '1' : '0', f);
+            if (x % 64 == 63) fputc('\n', f);
+        }
+    }
+    fclose(f);
+}
+
+static bool readGolden(const char* name, uint8_t* frame) {
+    FILE* f = fopen(goldenPath(name).c_str(), "r");
+    if (!f) return false;
+    char line[160];
+    int width = 0, height = 0;
+    bool ok = fgets(line, sizeof(line), f) && strncmp(line, "P1", 2) == 0;
+    while (ok && fgets(line, sizeof(line), f) && line[0] == '#') {}
+    ok = ok && sscanf(line, "%d %d", &width, &height) == 2 && width == WIDTH && height == HEIGHT;
+
+    memset(frame, 0, FRAME_BYTES);
+    int n = 0;
+    for (int c; ok && n < WIDTH * HEIGHT && (c = fgetc(f)) != EOF;) {
+        if (c != '0' && c != '1') continue;
+        int x = n % WIDTH, y = n / WIDTH;
+        if (c == '1') frame[x + (y / 8) * WIDTH] |= (uint8_t)(1 << (y & 7));
+        n++;
+    }
+    fclose(f);
+    return ok && n == WIDTH * HEIGHT;
+}
+
+static void checkGolden(const char* name) {
+    const uint8_t* panel = mock::panelRam();
+    if (getenv("UPDATE_GOLDEN")) {
+        writeGolden(name, panel);
+        return;
+    }
+    uint8_t expected[FRAME_BYTES];
+    bool found = readGolden(name, expected);
+    CHECK(found);
+    if (!found) return;
+    int wrong = 0;
+    for (int i = 0; i < FRAME_BYTES; i++) {
+        if (panel[i] != expected[i]) wrong++;
+    }
+    if (wrong) printf("  %s: %d bytes differ\n", name, wrong);
+    CHECK_EQ(wrong, 0);
+}
+
+// A driver showing an 8-row list with the long second row selected
+static std::unique_ptr<OLEDUIDriver> startList(ListView& list) {
+    mock::resetClock();
+    mock::resetPanel();
+    std::unique_ptr<OLEDUIDriver> oled(new OLEDUIDriver());
+    CHECK(oled->begin());
+    list.setRows(listRow, 8, 1);
+    drawFrame(*oled, list, DAMAGE_LIST);
+    return oled;
+}
+
+TEST_CASE(goldenList) {
+    ListView list;
+    auto oled = startList(list);
+    checkGolden("list");
+}
+
+TEST_CASE(goldenListScrolled) {
+    ListView list;
+    auto oled = startList(list);
+
+    // Past the initial pause, then scroll steps redrawing only the row
+    mock::advance(400 * 1000000ull);
+    for (int i = 0; i < 12; i++) {
+        mock::advance(25 * 1000000ull);
+        CHECK(oled->pendingDamage() & DAMAGE_SCROLL);
+        drawFrame(*oled, list, DAMAGE_SCROLL);
+    }
+    checkGolden("list_scrolled");
+}
+
+TEST_CASE(goldenSelectionMoved) {
+    ListView list;
+    auto oled = startList(list);
+    list.select(5);
+    drawFrame(*oled, list, DAMAGE_SELECTION);
+    checkGolden("list_window_moved");
+}
+
+TEST_CASE(goldenToast) {
+    ListView list;
+    auto oled = startList(list);
+    drawFrame(*oled, list, DAMAGE_TOAST, "Route saved");
+    checkGolden("toast");
+}
+
+TEST_CASE(goldenConfirmation) {
+    ListView list;
+    auto oled = startList(list);
+    drawFrame(*oled, list, DAMAGE_CONFIRM, nullptr, true);
+    checkGolden("confirm");
+}